@@ -1,8 +1,6 @@
 #ifndef CAMP_AIS_CONTACT_H
 #define CAMP_AIS_CONTACT_H
 
-#include <QObject>
-#include "ship_track.h"
 #include "project11_msgs/Contact.h"
 #include "marine_ais_msgs/AISContact.h"
 #include "locationposition.h"
@@ -32,47 +30,17 @@ struct AISContactState
   float sog;
 };
 
-struct AISReport: public QObject, AISContactDetails, AISContactState
+// Everything from one message, as plain data that can be queued across
+// threads.
+struct AISReport: AISContactDetails, AISContactState
 {
-  Q_OBJECT
-public:
-  AISReport(QObject *parent = nullptr);
-  AISReport(const project11_msgs::Contact::ConstPtr& message, QObject *parent = nullptr);
-  AISReport(const marine_ais_msgs::AISContact::ConstPtr& message, QObject *parent = nullptr);
+  AISReport();
+  AISReport(const project11_msgs::Contact::ConstPtr& message);
+  AISReport(const marine_ais_msgs::AISContact::ConstPtr& message);
 };
 
-
-class AISContact: public QObject, public ShipTrack, AISContactDetails
-{
-  Q_OBJECT
-
-public:
-  AISContact(QObject* parent = nullptr, QGraphicsItem *parentItem = nullptr);
-  AISContact(AISReport* report, QObject* parent = nullptr, QGraphicsItem *parentItem = nullptr);
-  ~AISContact();
-
-  int type() const override {return AISContactType;}
-
-  QRectF boundingRect() const override;
-  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
-  QPainterPath shape() const override;
-  QPainterPath predictionShape() const;
-
-  void newReport(AISReport* report);
-
-public slots:
-  void updateProjectedPoints();
-  void updateView();
-
-protected:
-  void hoverEnterEvent(QGraphicsSceneHoverEvent * event) override;
-  void hoverLeaveEvent(QGraphicsSceneHoverEvent * event) override;
-
-private:
-  void updateLabel();
-  
-  std::map<ros::Time, AISContactState> m_states;
-  ros::Time m_displayTime;
-};
+// True if seconds since 1970 fit in a ros::Time, whose constructor throws
+// for negative, NaN or out of range values. For times read from files.
+bool isValidReportTime(double seconds);
 
 #endif
\ No newline at end of file
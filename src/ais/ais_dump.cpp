@@ -0,0 +1,85 @@
+#include "ais_dump.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <cmath>
+#include <cstring>
+
+const char ais_dump_magic[8] = {'C','A','M','P','A','I','S','1'};
+
+AISDumpRecord::AISDumpRecord(const AISReport& report):
+  time(report.timestamp.toSec()),
+  latitude(report.location.location.latitude()),
+  longitude(report.location.location.longitude()),
+  mmsi(report.mmsi),
+  sog(report.sog),
+  cog(report.cog),
+  heading(report.heading),
+  to_bow(report.dimension_to_bow),
+  to_stern(report.dimension_to_stern),
+  to_port(report.dimension_to_port),
+  to_stbd(report.dimension_to_stbd)
+{
+}
+
+AISReport AISDumpRecord::report() const
+{
+  AISReport ret;
+  ret.mmsi = mmsi;
+  ret.dimension_to_bow = to_bow;
+  ret.dimension_to_stern = to_stern;
+  ret.dimension_to_port = to_port;
+  ret.dimension_to_stbd = to_stbd;
+  ret.timestamp = ros::Time(time);
+  ret.location.location = QGeoCoordinate(latitude, longitude);
+  ret.sog = sog;
+  ret.cog = cog;
+  ret.heading = heading;
+  return ret;
+}
+
+bool AISDumpRecord::valid() const
+{
+  return isValidReportTime(time);
+}
+
+AISDumpWriter::~AISDumpWriter()
+{
+  close();
+}
+
+bool AISDumpWriter::open(const QString& path)
+{
+  close();
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  file_.setFileName(path);
+  if(!file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    qWarning() << "Unable to open AIS dump" << path << file_.errorString();
+    return false;
+  }
+  return file_.write(ais_dump_magic, sizeof(ais_dump_magic)) == sizeof(ais_dump_magic);
+}
+
+void AISDumpWriter::close()
+{
+  if(file_.isOpen())
+    file_.close();
+}
+
+bool AISDumpWriter::append(const AISReport& report)
+{
+  if(!file_.isOpen())
+    return false;
+  AISDumpRecord record(report);
+  return file_.write(reinterpret_cast<const char*>(&record), sizeof(record)) == sizeof(record);
+}
+
+bool isAISDump(const QString& path)
+{
+  QFile file(path);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+  char magic[sizeof(ais_dump_magic)];
+  return file.read(magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, ais_dump_magic, sizeof(magic)) == 0;
+}
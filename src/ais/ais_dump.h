@@ -0,0 +1,55 @@
+#ifndef CAMP_AIS_DUMP_H
+#define CAMP_AIS_DUMP_H
+
+#include "ais_contact.h"
+#include <QFile>
+
+// Compact binary AIS recording: an 8 byte magic followed by fixed size
+// little endian records in time order. Names aren't kept.
+struct AISDumpRecord
+{
+  // Seconds since 1970.
+  double time;
+  double latitude;
+  double longitude;
+  uint32_t mmsi;
+  // m/s and degrees, NaN when not available.
+  float sog;
+  float cog;
+  float heading;
+  // Meters from the reference point.
+  uint16_t to_bow;
+  uint16_t to_stern;
+  uint16_t to_port;
+  uint16_t to_stbd;
+
+  AISDumpRecord() = default;
+  AISDumpRecord(const AISReport& report);
+  AISReport report() const;
+
+  // False for records of corrupt files, whose time doesn't fit a ros::Time.
+  bool valid() const;
+};
+
+static_assert(sizeof(AISDumpRecord) == 48, "AIS dump records are 48 bytes");
+
+class AISDumpWriter
+{
+public:
+  ~AISDumpWriter();
+
+  // Truncates an existing file.
+  bool open(const QString& path);
+  void close();
+  bool append(const AISReport& report);
+
+private:
+  QFile file_;
+};
+
+// Returns true if the file at path starts with the dump magic.
+bool isAISDump(const QString& path);
+
+extern const char ais_dump_magic[8];
+
+#endif
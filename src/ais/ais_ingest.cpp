@@ -0,0 +1,175 @@
+#include "ais_ingest.h"
+
+namespace
+{
+
+// Reports merged before the batch is handed over, so a steady flood still
+// reaches the GUI.
+const std::size_t max_drain = 4096;
+
+// Drops the oldest states past AISBatch::max_states.
+void trimStates(std::vector<AISContactState>& states)
+{
+  if(states.size() > AISBatch::max_states)
+    states.erase(states.begin(), states.end()-AISBatch::max_states);
+}
+
+} // namespace
+
+constexpr std::size_t AISBatch::max_states;
+
+void AISBatch::add(const AISReport& report)
+{
+  reports++;
+  auto existing = indexes.find(report.mmsi);
+  if(existing == indexes.end())
+  {
+    indexes[report.mmsi] = contacts.size();
+    contacts.emplace_back();
+    contacts.back().details = report;
+    contacts.back().states.push_back(report);
+    return;
+  }
+
+  auto& contact = contacts[existing->second];
+  // Keeps a known name over reports without one.
+  std::string name = std::move(contact.details.name);
+  contact.details = report;
+  if(contact.details.name.empty())
+    contact.details.name = std::move(name);
+  contact.states.push_back(report);
+  trimStates(contact.states);
+}
+
+void AISBatch::merge(AISBatch&& other)
+{
+  reports += other.reports;
+  for(auto& update: other.contacts)
+  {
+    auto existing = indexes.find(update.details.mmsi);
+    if(existing == indexes.end())
+    {
+      indexes[update.details.mmsi] = contacts.size();
+      contacts.push_back(std::move(update));
+      continue;
+    }
+
+    auto& contact = contacts[existing->second];
+    std::string name = std::move(contact.details.name);
+    contact.details = std::move(update.details);
+    if(contact.details.name.empty())
+      contact.details.name = std::move(name);
+    contact.states.insert(contact.states.end(), update.states.begin(), update.states.end());
+    trimStates(contact.states);
+  }
+  other.contacts.clear();
+  other.indexes.clear();
+  other.reports = 0;
+}
+
+bool AISBatch::empty() const
+{
+  return contacts.empty();
+}
+
+std::size_t AISBatch::reportCount() const
+{
+  return reports;
+}
+
+AISIngest::AISIngest(std::size_t queue_capacity, int producer_count)
+{
+  for(int i = 0; i < producer_count; i++)
+    queues_.emplace_back(new SPSCQueue<AISReport>(queue_capacity));
+  worker_ = std::thread(&AISIngest::run, this);
+}
+
+AISIngest::~AISIngest()
+{
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  worker_.join();
+}
+
+bool AISIngest::push(AISReport report, int producer)
+{
+  received_.fetch_add(1, std::memory_order_relaxed);
+  if(enqueue(std::move(report), producer))
+    return true;
+  dropped_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool AISIngest::tryPush(AISReport report, int producer)
+{
+  if(!enqueue(std::move(report), producer))
+    return false;
+  received_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool AISIngest::enqueue(AISReport&& report, int producer)
+{
+  if(!queues_[producer]->push(std::move(report)))
+    return false;
+  // Pairs with the fence in run, so either the worker sees the report or
+  // this sees it waiting.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if(waiting_.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_.notify_one();
+  }
+  return true;
+}
+
+bool AISIngest::take(AISBatch& batch)
+{
+  return batches_.take(batch);
+}
+
+uint64_t AISIngest::received() const
+{
+  return received_.load(std::memory_order_relaxed);
+}
+
+uint64_t AISIngest::dropped() const
+{
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+void AISIngest::run()
+{
+  AISReport report;
+  while(!stopping_)
+  {
+    AISBatch batch;
+    for(auto& queue: queues_)
+      for(std::size_t i = 0; i < max_drain && queue->pop(report); i++)
+        batch.add(report);
+    if(batch.empty())
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      waiting_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      wake_.wait(lock, [this]{return stopping_ || !queuesEmpty();});
+      waiting_.store(false, std::memory_order_relaxed);
+      continue;
+    }
+    batches_.put(std::move(batch), [](AISBatch& unread, AISBatch&& batch)
+    {
+      unread.merge(std::move(batch));
+    });
+  }
+}
+
+bool AISIngest::queuesEmpty() const
+{
+  for(const auto& queue: queues_)
+    if(!queue->empty())
+      return false;
+  return true;
+}
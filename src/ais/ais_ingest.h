@@ -0,0 +1,94 @@
+#ifndef CAMP_AIS_INGEST_H
+#define CAMP_AIS_INGEST_H
+
+#include "ais_contact.h"
+#include "latest_mailbox.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A contact's latest details and its states in arrival order.
+struct AISContactUpdate
+{
+  AISContactDetails details;
+  std::vector<AISContactState> states;
+};
+
+// Reports merged per MMSI.
+//
+// Only the newest max_states states of a contact are kept, so a batch the
+// GUI is slow to take stays bounded by the number of contacts.
+struct AISBatch
+{
+  static constexpr std::size_t max_states = 64;
+
+  void add(const AISReport& report);
+  void merge(AISBatch&& other);
+  bool empty() const;
+  // Reports merged in, including states since trimmed.
+  std::size_t reportCount() const;
+
+  std::vector<AISContactUpdate> contacts;
+  std::unordered_map<uint32_t, std::size_t> indexes;
+  std::size_t reports = 0;
+};
+
+// Moves AIS reports from a ROS callback thread to the GUI thread.
+//
+// The callback pushes plain reports into a lock-free queue and returns.
+// Each producer, such as the ROS spinner or a replay, has its own queue. A
+// worker, asleep while they are empty, drains the queues, merging the
+// reports per MMSI, and hands the merged batch to the GUI thread through a
+// mailbox, merging into the previous batch if that one wasn't taken yet.
+// The GUI thread then applies everything received since its last frame at
+// once, however bursty the feed.
+class AISIngest
+{
+public:
+  explicit AISIngest(std::size_t queue_capacity = 8192, int producer_count = 1);
+  ~AISIngest();
+
+  // Only from one thread at a time for each producer. Returns false, the
+  // report not being queued, if the producer's queue is full.
+  bool push(AISReport report, int producer = 0);
+
+  // For producers that offer a refused report again later, such as a
+  // replay, so a refusal counts as neither received nor dropped.
+  bool tryPush(AISReport report, int producer = 0);
+
+  // Moves the reports merged since the last call to batch. Returns false if
+  // there were none.
+  bool take(AISBatch& batch);
+
+  uint64_t received() const;
+  // Reports refused by a full queue, not counting tryPush.
+  uint64_t dropped() const;
+
+private:
+  void run();
+  bool queuesEmpty() const;
+  // Queues the report, waking the worker if it's waiting.
+  bool enqueue(AISReport&& report, int producer);
+
+  std::vector<std::unique_ptr<SPSCQueue<AISReport> > > queues_;
+  LatestMailbox<AISBatch> batches_;
+
+  std::atomic<uint64_t> received_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+  // The worker waits on wake_ when the queues are empty. Producers only
+  // take the mutex to notify it when waiting_ is set.
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> waiting_{false};
+
+  std::atomic<bool> stopping_{false};
+  std::thread worker_;
+};
+
+#endif
@@ -0,0 +1,551 @@
+#include "ais_layer.h"
+#include "backgroundraster.h"
+#include <QGraphicsSceneHoverEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+using StateHistory = RingBuffer<AISContactState>;
+
+// Index of the first state at or after time.
+std::size_t lowerBound(const StateHistory& states, const ros::Time& time)
+{
+  std::size_t first = 0;
+  std::size_t count = states.size();
+  while(count > 0)
+  {
+    std::size_t step = count/2;
+    if(states[first+step].timestamp < time)
+    {
+      first += step+1;
+      count -= step+1;
+    }
+    else
+      count = step;
+  }
+  return first;
+}
+
+// Index of the first state after time.
+std::size_t upperBound(const StateHistory& states, const ros::Time& time)
+{
+  std::size_t first = 0;
+  std::size_t count = states.size();
+  while(count > 0)
+  {
+    std::size_t step = count/2;
+    if(states[first+step].timestamp <= time)
+    {
+      first += step+1;
+      count -= step+1;
+    }
+    else
+      count = step;
+  }
+  return first;
+}
+
+// Drops the states before start, in seconds.
+void trimStates(StateHistory& states, double start)
+{
+  while(!states.empty() && states.front().timestamp.toSec() < start)
+    states.pop_front();
+}
+
+template<typename T> void swapRemove(std::vector<T>& values, std::size_t i)
+{
+  if(i+1 != values.size())
+    values[i] = std::move(values.back());
+  values.pop_back();
+}
+
+} // namespace
+
+AISLayer::AISLayer(QObject *parent, QGraphicsItem *parentItem):QObject(parent), ShipTrack(parentItem)
+{
+  setAcceptHoverEvents(true);
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+  reap_timer_ = new QTimer(this);
+  connect(reap_timer_, &QTimer::timeout, this, &AISLayer::reap);
+  reap_timer_->start(1000);
+}
+
+std::size_t AISLayer::contactCount() const
+{
+  return mmsis_.size();
+}
+
+void AISLayer::setAging(double stale_time, double lost_time, double removed_time)
+{
+  stale_time_ = ros::Duration(stale_time);
+  lost_time_ = ros::Duration(lost_time);
+  removed_time_ = ros::Duration(removed_time);
+}
+
+bool AISLayer::addContact(const AISContactDetails& details, const std::vector<AISContactState>& states)
+{
+  if(states.empty())
+    return false;
+  bool added = false;
+  std::size_t contact;
+  auto existing = contact_indexes_.find(details.mmsi);
+  if(existing == contact_indexes_.end())
+  {
+    contact = mmsis_.size();
+    contact_indexes_[details.mmsi] = contact;
+    mmsis_.push_back(details.mmsi);
+    names_.emplace_back();
+    dimensions_.emplace_back();
+    ages_.push_back(Age::Active);
+    states_.emplace_back(initial_history_size_);
+    tracks_.emplace_back();
+    track_times_.emplace_back();
+    current_times_.emplace_back();
+    locations_.emplace_back();
+    positions_.emplace_back();
+    headings_.push_back(std::nan(""));
+    sogs_.push_back(0.0);
+    cogs_.push_back(0.0);
+    prediction_ends_.emplace_back();
+    predictions_.emplace_back();
+    bounds_.emplace_back();
+    added = true;
+  }
+  else
+    contact = existing->second;
+
+  if(!details.name.empty())
+    names_[contact] = details.name;
+  dimensions_[contact].to_bow = details.dimension_to_bow;
+  dimensions_[contact].to_port = details.dimension_to_port;
+  dimensions_[contact].to_stbd = details.dimension_to_stbd;
+  dimensions_[contact].to_stern = details.dimension_to_stern;
+
+  if(ages_[contact] == Age::Lost)
+    states_[contact].setCapacity(initial_history_size_);
+  ages_[contact] = Age::Active;
+
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  bool late = false;
+  for(auto state: states)
+  {
+    if(bg)
+      state.location.pos = geoToPixel(state.location.location, bg);
+    addState(contact, state);
+    late = late || (!track_times_[contact].empty() && state.timestamp <= track_times_[contact].back());
+  }
+
+  // A late report lands inside the track instead of at its end.
+  if(late)
+    updateTrack(contact, true);
+  return added;
+}
+
+void AISLayer::addState(std::size_t contact, const AISContactState& state)
+{
+  auto& states = states_[contact];
+  auto next = upperBound(states, state.timestamp);
+  if(next > 0 && states[next-1].timestamp == state.timestamp)
+  {
+    states[next-1] = state;
+    return;
+  }
+
+  double start = state.timestamp.toSec() - history_duration_.toSec();
+  if(!states.empty())
+    start = std::max(start, states.back().timestamp.toSec() - history_duration_.toSec());
+  if(state.timestamp.toSec() < start)
+    return;
+  trimStates(states, start);
+  if(states.full() && states.capacity() < max_history_size_)
+    states.setCapacity(std::min(2*states.capacity(), max_history_size_));
+
+  // Late reports are moved back from the end, they rarely go far.
+  states.push_back(state);
+  for(auto i = states.size()-1; i > 0 && states[i].timestamp < states[i-1].timestamp; i--)
+    std::swap(states[i], states[i-1]);
+}
+
+void AISLayer::updateView()
+{
+  display_time_ = ros::Time::now();
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  for(std::size_t contact = 0; contact < mmsis_.size(); contact++)
+    if(ages_[contact] != Age::Lost)
+    {
+      updateTrack(contact);
+      updateContact(contact, bg);
+    }
+  prepareGeometryChange();
+  layer_bounds_dirty_ = true;
+}
+
+void AISLayer::updateProjectedPoints()
+{
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  for(std::size_t contact = 0; contact < mmsis_.size(); contact++)
+  {
+    auto& states = states_[contact];
+    if(bg)
+      for(std::size_t i = 0; i < states.size(); i++)
+        states[i].location.pos = geoToPixel(states[i].location.location, bg);
+    // Forces the prediction to be projected again.
+    current_times_[contact] = ros::Time();
+    if(ages_[contact] != Age::Lost)
+      updateTrack(contact, true);
+    updateContact(contact, bg);
+  }
+  prepareGeometryChange();
+  layer_bounds_dirty_ = true;
+}
+
+void AISLayer::updateTrack(std::size_t contact, bool rebuild)
+{
+  auto& track = tracks_[contact];
+  auto& track_times = track_times_[contact];
+  const auto& states = states_[contact];
+
+  ros::Time historyStartTime = display_time_ - history_duration_;
+  if(display_time_.isZero() || (!track_times.empty() && track_times.back() > display_time_))
+    rebuild = true;
+  if(rebuild)
+  {
+    track.clear();
+    track_times.clear();
+  }
+  if(display_time_.isZero())
+    return;
+
+  while(!track_times.empty() && track_times.front() < historyStartTime)
+  {
+    track_times.pop_front();
+    track.popFront();
+  }
+
+  auto i = track_times.empty() ? lowerBound(states, historyStartTime) : upperBound(states, track_times.back());
+  for(; i < states.size() && states[i].timestamp <= display_time_; i++)
+  {
+    track.append(states[i].location.pos);
+    track_times.push_back(states[i].timestamp);
+  }
+}
+
+void AISLayer::updateContact(std::size_t contact, BackgroundRaster* bg)
+{
+  const auto& states = states_[contact];
+  auto next = upperBound(states, display_time_);
+  if(display_time_.isZero() || next == 0)
+  {
+    current_times_[contact] = ros::Time();
+    bounds_[contact] = QRectF();
+    index_.remove(contact);
+    return;
+  }
+  const auto& state = states[next-1];
+
+  if(state.timestamp != current_times_[contact])
+  {
+    current_times_[contact] = state.timestamp;
+    locations_[contact] = state.location.location;
+    positions_[contact] = state.location.pos;
+    headings_[contact] = state.heading;
+    sogs_[contact] = state.sog;
+    cogs_[contact] = state.cog;
+    prediction_ends_[contact] = positions_[contact];
+    if(bg && ages_[contact] != Age::Lost && state.sog > 0.0 && !std::isnan(state.cog))
+      prediction_ends_[contact] = geoToPixel(locations_[contact].atDistanceAndAzimuth(state.sog*prediction_duration_, state.cog), bg);
+  }
+
+  double elapsed = (display_time_ - state.timestamp).toSec();
+  const QPointF& position = positions_[contact];
+  predictions_[contact] = position + (prediction_ends_[contact] - position)*(elapsed/prediction_duration_);
+
+  const QPointF& end = prediction_ends_[contact];
+  const QPointF& prediction = predictions_[contact];
+  QPointF top_left(std::min({position.x(), end.x(), prediction.x()}), std::min({position.y(), end.y(), prediction.y()}));
+  QPointF bottom_right(std::max({position.x(), end.x(), prediction.x()}), std::max({position.y(), end.y(), prediction.y()}));
+  double radius = symbolRadius(contact, bg);
+  QRectF bounds = QRectF(top_left, bottom_right).marginsAdded(QMarginsF(radius, radius, radius, radius));
+  if(!tracks_[contact].empty())
+    bounds |= tracks_[contact].boundingRect().marginsAdded(QMarginsF(2, 2, 2, 2));
+  if(bounds != bounds_[contact])
+  {
+    bounds_[contact] = bounds;
+    index_.insert(contact, bounds);
+  }
+}
+
+void AISLayer::reap()
+{
+  if(mmsis_.empty())
+    return;
+  ros::Time now = ros::Time::now();
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  bool changed = false;
+  std::vector<std::size_t> removed;
+  std::size_t count = std::min(reap_batch_size_, mmsis_.size());
+  for(std::size_t i = 0; i < count; i++, reap_next_++)
+  {
+    if(reap_next_ >= mmsis_.size())
+      reap_next_ = 0;
+    std::size_t contact = reap_next_;
+    auto& states = states_[contact];
+    ros::Duration silence = now - states.back().timestamp;
+    if(silence > removed_time_)
+    {
+      removed.push_back(contact);
+      continue;
+    }
+    if(silence > lost_time_)
+    {
+      if(ages_[contact] != Age::Lost)
+      {
+        setLost(contact, bg);
+        changed = true;
+      }
+      continue;
+    }
+    Age age = silence > stale_time_ ? Age::Stale : Age::Active;
+    if(age != ages_[contact])
+    {
+      ages_[contact] = age;
+      changed = true;
+    }
+
+    trimStates(states, states.back().timestamp.toSec() - history_duration_.toSec());
+    if(states.capacity() > initial_history_size_ && states.size() <= states.capacity()/4)
+      states.setCapacity(std::max(initial_history_size_, states.capacity()/2));
+  }
+
+  // Removing moves the last contact, so go from the back.
+  std::sort(removed.rbegin(), removed.rend());
+  for(auto contact: removed)
+    removeContact(contact);
+
+  if(changed || !removed.empty())
+  {
+    prepareGeometryChange();
+    layer_bounds_dirty_ = true;
+  }
+}
+
+void AISLayer::setLost(std::size_t contact, BackgroundRaster* bg)
+{
+  ages_[contact] = Age::Lost;
+  states_[contact].setCapacity(1);
+  tracks_[contact].clear();
+  track_times_[contact].clear();
+  prediction_ends_[contact] = positions_[contact];
+  updateContact(contact, bg);
+}
+
+void AISLayer::removeContact(std::size_t contact)
+{
+  uint32_t mmsi = mmsis_[contact];
+  std::size_t last = mmsis_.size()-1;
+  index_.remove(contact);
+  index_.remove(last);
+
+  swapRemove(mmsis_, contact);
+  swapRemove(names_, contact);
+  swapRemove(dimensions_, contact);
+  swapRemove(ages_, contact);
+  swapRemove(states_, contact);
+  swapRemove(tracks_, contact);
+  swapRemove(track_times_, contact);
+  swapRemove(current_times_, contact);
+  swapRemove(locations_, contact);
+  swapRemove(positions_, contact);
+  swapRemove(headings_, contact);
+  swapRemove(sogs_, contact);
+  swapRemove(cogs_, contact);
+  swapRemove(prediction_ends_, contact);
+  swapRemove(predictions_, contact);
+  swapRemove(bounds_, contact);
+
+  contact_indexes_.erase(mmsi);
+  if(contact != last)
+  {
+    contact_indexes_[mmsis_[contact]] = contact;
+    if(!bounds_[contact].isNull())
+      index_.insert(contact, bounds_[contact]);
+  }
+
+  if(hovered_contact_ == int(contact))
+  {
+    hovered_contact_ = -1;
+    setShowLabelFlag(false);
+  }
+  else if(hovered_contact_ == int(last))
+    hovered_contact_ = contact;
+
+  emit contactRemoved(mmsi);
+}
+
+double AISLayer::symbolRadius(std::size_t contact, BackgroundRaster* bg) const
+{
+  if(!bg || bg->pixelSize() <= 0.0)
+    return 2.0;
+  // Triangles are 15m at the scaled pixel size, circles without a heading
+  // at least 15m.
+  const auto& d = dimensions_[contact];
+  double meters = std::max({15.0, 15.0*bg->scaledPixelSize(), double(d.to_bow), double(d.to_stern), double(d.to_port), double(d.to_stbd)});
+  return meters/bg->pixelSize() + 2.0;
+}
+
+QRectF AISLayer::boundingRect() const
+{
+  if(layer_bounds_dirty_)
+  {
+    layer_bounds_ = QRectF();
+    for(const auto& bounds: bounds_)
+      layer_bounds_ |= bounds;
+    layer_bounds_dirty_ = false;
+  }
+  return layer_bounds_;
+}
+
+void AISLayer::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  if(!bg)
+    return;
+
+  const QRectF& exposed = option->exposedRect;
+  std::vector<std::size_t> visible;
+  if(exposed.contains(boundingRect()))
+  {
+    // Cheaper than visiting the grid cells of a large exposed area.
+    for(std::size_t contact = 0; contact < bounds_.size(); contact++)
+      if(!current_times_[contact].isZero())
+        visible.push_back(contact);
+  }
+  else
+    index_.query(exposed, [&](std::size_t contact)
+    {
+      if(bounds_[contact].intersects(exposed))
+        visible.push_back(contact);
+    });
+  if(visible.empty())
+    return;
+
+  // One frame serves all the contacts, they are close compared to the
+  // projection's scale changes.
+  updateFrame(bg, locations_[visible.front()]);
+  qreal pixel_size = bg->scaledPixelSize();
+
+  QPainterPath symbols;
+  QPainterPath stale_symbols;
+  QPainterPath predicted_symbols;
+  QVector<QLineF> prediction_lines;
+  prediction_lines.reserve(visible.size());
+  for(auto contact: visible)
+  {
+    auto& contact_symbols = ages_[contact] == Age::Active ? symbols : stale_symbols;
+    bool predicted = ages_[contact] != Age::Lost;
+    const auto& d = dimensions_[contact];
+    float length = d.to_bow + d.to_stern;
+    float width = d.to_port + d.to_stbd;
+    if(length == 0 || width == 0 || pixel_size > std::max(length, width)/10.0)
+    {
+      drawTriangle(contact_symbols, positions_[contact], headings_[contact], pixel_size);
+      if(predicted)
+        drawTriangle(predicted_symbols, predictions_[contact], headings_[contact], pixel_size);
+    }
+    else
+    {
+      drawShipOutline(contact_symbols, positions_[contact], headings_[contact], d.to_bow, d.to_port, d.to_stbd, d.to_stern);
+      if(predicted)
+        drawShipOutline(predicted_symbols, predictions_[contact], headings_[contact], d.to_bow, d.to_port, d.to_stbd, d.to_stern);
+    }
+    if(predicted && prediction_ends_[contact] != positions_[contact])
+      prediction_lines.append(QLineF(positions_[contact], prediction_ends_[contact]));
+  }
+
+  painter->save();
+
+  QPen p;
+  p.setCosmetic(true);
+  p.setColor(QColor(.2*255,.2*255,255,.7*255));
+  p.setWidth(2);
+  painter->setPen(p);
+  for(auto contact: visible)
+    if(ages_[contact] == Age::Active)
+      tracks_[contact].draw(painter, exposed);
+  painter->drawPath(symbols);
+
+  p.setColor(QColor(.2*255,.2*255,255,.3*255));
+  painter->setPen(p);
+  for(auto contact: visible)
+    if(ages_[contact] == Age::Stale)
+      tracks_[contact].draw(painter, exposed);
+  painter->drawPath(stale_symbols);
+
+  p.setColor(QColor(128, 128, 128, 128));
+  painter->setPen(p);
+  painter->drawLines(prediction_lines);
+  painter->drawPath(predicted_symbols);
+
+  painter->restore();
+}
+
+int AISLayer::contactAt(const QPointF& position) const
+{
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  int nearest = -1;
+  double nearest_distance = 0.0;
+  index_.query(QRectF(position, QSizeF(1, 1)), [&](std::size_t contact)
+  {
+    if(current_times_[contact].isZero())
+      return;
+    QPointF offset = positions_[contact] - position;
+    double distance = std::sqrt(offset.x()*offset.x() + offset.y()*offset.y());
+    if(distance <= symbolRadius(contact, bg) && (nearest == -1 || distance < nearest_distance))
+    {
+      nearest = contact;
+      nearest_distance = distance;
+    }
+  });
+  return nearest;
+}
+
+bool AISLayer::contains(const QPointF& point) const
+{
+  return contactAt(point) != -1;
+}
+
+void AISLayer::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
+{
+  int contact = contactAt(event->pos());
+  if(contact == hovered_contact_)
+    return;
+  hovered_contact_ = contact;
+  if(contact == -1)
+  {
+    setShowLabelFlag(false);
+    return;
+  }
+
+  QString label;
+  if(!names_[contact].empty())
+    label = names_[contact].c_str();
+  else
+    label = QString::number(mmsis_[contact]);
+  label += "\nsog: " + QString::number(int(sogs_[contact]*10)/10.0) + " m/s";
+  label += "\ncog: " + QString::number(int(cogs_[contact]));
+  setLabel(label);
+  setLabelPosition(positions_[contact]);
+  setShowLabelFlag(true);
+}
+
+void AISLayer::hoverLeaveEvent(QGraphicsSceneHoverEvent* event)
+{
+  hovered_contact_ = -1;
+  setShowLabelFlag(false);
+}
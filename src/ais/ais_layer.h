@@ -0,0 +1,172 @@
+#ifndef CAMP_AIS_LAYER_H
+#define CAMP_AIS_LAYER_H
+
+#include <QObject>
+#include "ship_track.h"
+#include "ais_contact.h"
+#include "ring_buffer.h"
+#include "track_path.h"
+#include "uniform_grid_index.h"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class QTimer;
+
+// Draws all AIS contacts as a single item.
+//
+// Contacts are stored as parallel arrays indexed by contact, with the
+// fields needed each frame kept apart from the report history. Each
+// contact's bounds, covering its track, symbol and prediction vector, are
+// kept in a uniform grid so paint only visits contacts near the exposed
+// area. The visible tracks, symbols and prediction vectors are then each
+// drawn with one pen and as few calls as possible.
+//
+// The predicted position is interpolated in pixels along the projected
+// prediction vector, which is straight enough over its 5 minutes, so
+// updating the view needs no geodesic math.
+//
+// Each contact keeps the reports within the history duration of its latest
+// one in a ring that grows as needed and is shrunk back by the reaper. The
+// reaper visits a batch of contacts each second, marking them stale or lost
+// as they go silent and removing them once silent for the removed time.
+// Lost contacts are compacted to their last report and skipped by
+// updateView.
+class AISLayer: public QObject, public ShipTrack
+{
+  Q_OBJECT
+  Q_INTERFACES(QGraphicsItem)
+public:
+  AISLayer(QObject* parent = nullptr, QGraphicsItem *parentItem = nullptr);
+
+  int type() const override {return AISLayerType;}
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  // Only true near a contact's symbol, so the layer doesn't hide the items
+  // under it from the mouse.
+  bool contains(const QPointF &point) const override;
+
+  // Adds the states of a contact, in any order. Returns true if the contact
+  // is new.
+  bool addContact(const AISContactDetails& details, const std::vector<AISContactState>& states);
+
+  std::size_t contactCount() const;
+
+  // Seconds of silence after which a contact is faded, drawn without its
+  // track and prediction, then removed.
+  void setAging(double stale_time, double lost_time, double removed_time);
+
+signals:
+  void contactRemoved(uint32_t mmsi);
+
+public slots:
+  void updateProjectedPoints();
+
+  // Advances the display time to now.
+  void updateView();
+
+  // Ages, trims and removes the next batch of contacts.
+  void reap();
+
+protected:
+  void hoverMoveEvent(QGraphicsSceneHoverEvent * event) override;
+  void hoverLeaveEvent(QGraphicsSceneHoverEvent * event) override;
+
+private:
+  struct Dimensions
+  {
+    float to_bow = 0.0;
+    float to_port = 0.0;
+    float to_stbd = 0.0;
+    float to_stern = 0.0;
+  };
+
+  enum class Age
+  {
+    Active,
+    Stale,
+    Lost
+  };
+
+  // Inserts state in time order, dropping it if already out of the history.
+  void addState(std::size_t contact, const AISContactState& state);
+
+  // Keeps only the last report and a still prediction.
+  void setLost(std::size_t contact, BackgroundRaster* bg);
+
+  // Moves the last contact into contact's place.
+  void removeContact(std::size_t contact);
+
+  // Brings the track of contact to the states in the history window ending
+  // at the display time, appending and dropping at the ends unless rebuild
+  // is set.
+  void updateTrack(std::size_t contact, bool rebuild = false);
+
+  // Updates the contact's current state, prediction and bounds for the
+  // display time.
+  void updateContact(std::size_t contact, BackgroundRaster* bg);
+
+  // Radius of the contact's symbols in pixels.
+  double symbolRadius(std::size_t contact, BackgroundRaster* bg) const;
+
+  // Contact nearest position within its symbol radius, or -1.
+  int contactAt(const QPointF& position) const;
+
+  ros::Time display_time_;
+  ros::Duration history_duration_ = ros::Duration(300);
+  // Length of the prediction vectors.
+  double prediction_duration_ = 300.0;
+
+  ros::Duration stale_time_ = ros::Duration(180);
+  ros::Duration lost_time_ = ros::Duration(600);
+  ros::Duration removed_time_ = ros::Duration(3600);
+
+  // History ring sizes, doubled while full of reports within the history.
+  static constexpr std::size_t initial_history_size_ = 8;
+  static constexpr std::size_t max_history_size_ = 4096;
+
+  QTimer* reap_timer_;
+  std::size_t reap_batch_size_ = 500;
+  // Next contact for the reaper.
+  std::size_t reap_next_ = 0;
+
+  std::unordered_map<uint32_t, std::size_t> contact_indexes_;
+
+  // Contact details.
+  std::vector<uint32_t> mmsis_;
+  std::vector<std::string> names_;
+  std::vector<Dimensions> dimensions_;
+  std::vector<Age> ages_;
+
+  // Report history in time order and the track drawn from it, with the
+  // time of each track point.
+  std::vector<RingBuffer<AISContactState> > states_;
+  std::vector<TrackPath> tracks_;
+  std::vector<std::deque<ros::Time> > track_times_;
+
+  // Last state at or before the display time, zero time if none.
+  std::vector<ros::Time> current_times_;
+  std::vector<QGeoCoordinate> locations_;
+  std::vector<QPointF> positions_;
+  std::vector<float> headings_;
+  std::vector<float> sogs_;
+  std::vector<float> cogs_;
+  // End of the prediction vector and the predicted position at the
+  // display time.
+  std::vector<QPointF> prediction_ends_;
+  std::vector<QPointF> predictions_;
+  std::vector<QRectF> bounds_;
+
+  UniformGridIndex<std::size_t> index_;
+
+  // Union of the contact bounds, computed when next needed.
+  mutable QRectF layer_bounds_;
+  mutable bool layer_bounds_dirty_ = true;
+
+  // Contact whose label is shown, -1 if none.
+  int hovered_contact_ = -1;
+};
+
+#endif
@@ -1,32 +1,86 @@
 #include "ais_manager.h"
 #include "ui_ais_manager.h"
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QTimer>
+#include <QTreeWidgetItem>
+#include <algorithm>
+#include <cmath>
 #include "backgroundraster.h"
+#include "ais_layer.h"
+#include "ais_replay.h"
+
+namespace
+{
+
+enum Column
+{
+  ContactColumn,
+  RangeColumn,
+  BearingColumn,
+  CPAColumn,
+  TCPAColumn,
+  RiskColumn,
+  ColumnCount
+};
+
+} // namespace
 
 AISManager::AISManager(QWidget* parent):
   QWidget(parent),
-  m_ui(new Ui::AISManager)
+  m_ui(new Ui::AISManager),
+  m_ingest(8192, ProducerCount)
 {
   m_ui->setupUi(this);
 
-  connect(this, &AISManager::newAisReport, this, &AISManager::addAisReport, Qt::QueuedConnection);
+  m_spinner = std::make_shared<ros::AsyncSpinner>(1, &m_ros_queue);
+  m_spinner->start();
 
   m_scan_timer = new QTimer(this);
   connect(m_scan_timer, &QTimer::timeout, this, &AISManager::scanForSources);
   m_scan_timer->start(1000);
 
+  m_layer = new AISLayer(this, m_background);
+  connect(m_layer, &AISLayer::contactRemoved, this, &AISManager::removeContact);
+
+  ros::NodeHandle nh;
+  double stale_time = 180.0;
+  double lost_time = 600.0;
+  double removed_time = 3600.0;
+  nh.param("ais/stale_time", stale_time, stale_time);
+  nh.param("ais/lost_time", lost_time, lost_time);
+  nh.param("ais/removed_time", removed_time, removed_time);
+  m_layer->setAging(stale_time, lost_time, removed_time);
+
+  double cpa_limit = 1000.0;
+  double tcpa_limit = 900.0;
+  nh.param("ais/cpa_limit", cpa_limit, cpa_limit);
+  nh.param("ais/tcpa_limit", tcpa_limit, tcpa_limit);
+  // Lost contacts aren't evaluated.
+  m_collision_risk.setLimits(cpa_limit, tcpa_limit, lost_time);
+
+  m_ui->contactTreeWidget->sortByColumn(RiskColumn, Qt::DescendingOrder);
+
+  m_risk_timer = new QTimer(this);
+  connect(m_risk_timer, &QTimer::timeout, this, &AISManager::updateRisk);
+  m_risk_timer->start(1000);
+
   m_update_timer = new QTimer(this);
+  connect(m_update_timer, &QTimer::timeout, this, &AISManager::updateView);
   m_update_timer->start(200);
 }
 
 AISManager::~AISManager()
 {
+  m_spinner->stop();
+  m_sources.clear();
   delete m_ui;
 }
 
 void AISManager::scanForSources()
 {
   ros::NodeHandle nh;
+  nh.setCallbackQueue(&m_ros_queue);
 
   ros::master::V_TopicInfo topic_info;
   ros::master::getTopics(topic_info);
@@ -49,9 +103,7 @@ void AISManager::contactCallback(const project11_msgs::Contact::ConstPtr& messag
     if(message->position.latitude > 90 || message->position.longitude > 180)
         return;
 
-    AISReport* r = new AISReport(message);
-    emit newAisReport(r);
-    r->deleteLater();
+    m_ingest.push(AISReport(message), ROSProducer);
 }
 
 void AISManager::aisContactCallback(const marine_ais_msgs::AISContact::ConstPtr& message)
@@ -59,32 +111,148 @@ void AISManager::aisContactCallback(const marine_ais_msgs::AISContact::ConstPtr&
   if(isnan(message->pose.position.latitude) || isnan(message->pose.position.longitude))
     return;
 
-  AISReport* r = new AISReport(message);
-    emit newAisReport(r);
-    r->deleteLater();
+  m_ingest.push(AISReport(message), ROSProducer);
+}
+
+void AISManager::replay(QString path, double speed)
+{
+  if(!m_replay)
+  {
+    m_replay = new AISReplay(this);
+    // Waits for room in the queue rather than dropping reports.
+    m_replay->setSink([this](const AISReport& report)
+    {
+      return m_ingest.tryPush(report, ReplayProducer);
+    });
+    connect(m_replay, &AISReplay::finished, this, [this]()
+    {
+      m_ui->replayLabel->setText(QString("Replayed %1 reports, %2 errors").arg(m_replay->sent()).arg(m_replay->errors()));
+    });
+  }
+  if(!m_replay->open(path))
+  {
+    m_ui->replayLabel->setText("Unable to open " + QFileInfo(path).fileName());
+    return;
+  }
+  m_replay->setSpeed(speed);
+  m_replay->start();
+  m_ui->replayLabel->setText("Replaying " + QFileInfo(path).fileName());
 }
 
+void AISManager::on_replayButton_clicked()
+{
+  QString path = QFileDialog::getOpenFileName(this, tr("Replay AIS"), QString(), tr("AIS recordings (*.nmea *.txt *.log *.aisdump);;All files (*)"));
+  if(!path.isEmpty())
+    replay(path, m_ui->replaySpeedSpinBox->value());
+}
 
-void AISManager::addAisReport(AISReport* report)
+void AISManager::updateView()
 {
-  if(m_contacts.find(report->mmsi) == m_contacts.end())
+  AISBatch batch;
+  if(m_ingest.take(batch))
   {
-    m_contacts[report->mmsi] = new AISContact(report, this, m_background);
-    connect(m_update_timer, &QTimer::timeout, m_contacts[report->mmsi], &AISContact::updateView);
-    m_ui->contactListWidget->addItem(QString::number(report->mmsi));
+    // Sorted once at the end instead of after each change.
+    m_ui->contactTreeWidget->setSortingEnabled(false);
+    for(const auto& update: batch.contacts)
+      addContact(update);
+    m_ui->contactTreeWidget->setSortingEnabled(true);
   }
-  m_contacts[report->mmsi]->newReport(report);
+  m_layer->updateView();
 }
 
-void AISManager::updateBackground(BackgroundRaster * bg)
+void AISManager::addContact(const AISContactUpdate& update)
 {
-  m_background = bg;
-  for(auto c: m_contacts)
+  if(update.states.empty())
+    return;
+  m_layer->addContact(update.details, update.states);
+
+  auto latest = std::max_element(update.states.begin(), update.states.end(), [](const AISContactState& a, const AISContactState& b)
+  {
+    return a.timestamp < b.timestamp;
+  });
+  m_collision_risk.updateContact(update.details.mmsi, latest->location.location.latitude(), latest->location.location.longitude(), latest->sog, latest->cog, latest->timestamp.toSec());
+
+  auto& item = m_contact_items[update.details.mmsi];
+  if(!item)
+  {
+    item = new QTreeWidgetItem();
+    item->setText(ContactColumn, QString::number(update.details.mmsi));
+    m_ui->contactTreeWidget->addTopLevelItem(item);
+  }
+  if(!update.details.name.empty())
+    item->setText(ContactColumn, update.details.name.c_str());
+}
+
+void AISManager::removeContact(uint32_t mmsi)
+{
+  m_collision_risk.removeContact(mmsi);
+  auto item = m_contact_items.find(mmsi);
+  if(item != m_contact_items.end())
+  {
+    delete item->second;
+    m_contact_items.erase(item);
+  }
+}
+
+void AISManager::updateOwnShip(QGeoCoordinate position, double sog, double cog)
+{
+  m_collision_risk.setOwnShip(position.latitude(), position.longitude(), sog, cog, ros::Time::now().toSec());
+}
+
+void AISManager::updateRisk()
+{
+  if(!m_collision_risk.hasOwnShip())
+    return;
+  const auto& results = m_collision_risk.evaluate(ros::Time::now().toSec());
+
+  // Sorted once at the end instead of after each change.
+  auto tree = m_ui->contactTreeWidget;
+  tree->setSortingEnabled(false);
+
+  for(auto mmsi: m_evaluated_contacts)
+  {
+    auto item = m_contact_items.find(mmsi);
+    if(item == m_contact_items.end())
+      continue;
+    for(int column = ContactColumn; column < ColumnCount; column++)
+    {
+      if(column != ContactColumn)
+        item->second->setData(column, Qt::DisplayRole, QVariant());
+      item->second->setData(column, Qt::BackgroundRole, QVariant());
+    }
+  }
+  m_evaluated_contacts.clear();
+
+  for(const auto& result: results)
   {
-    c.second->setParentItem(bg);
-    c.second->updateProjectedPoints();
+    auto item = m_contact_items.find(result.mmsi);
+    if(item == m_contact_items.end())
+      continue;
+    m_evaluated_contacts.push_back(result.mmsi);
+    auto i = item->second;
+    // Numbers rather than text so the columns sort by value.
+    i->setData(RangeColumn, Qt::DisplayRole, int(std::round(result.range)));
+    i->setData(BearingColumn, Qt::DisplayRole, int(std::round(result.bearing))%360);
+    i->setData(CPAColumn, Qt::DisplayRole, int(std::round(result.cpa)));
+    i->setData(TCPAColumn, Qt::DisplayRole, int(std::round(result.tcpa)));
+    i->setData(RiskColumn, Qt::DisplayRole, std::round(result.risk*100.0)/100.0);
+    if(result.risk > 0.0)
+    {
+      QColor color = result.risk >= 0.5 ? QColor(255, 128, 128) : QColor(255, 220, 128);
+      for(int column = ContactColumn; column < ColumnCount; column++)
+        i->setData(column, Qt::BackgroundRole, color);
+    }
   }
 
+  tree->setSortingEnabled(true);
+}
+
+void AISManager::updateBackground(BackgroundRaster * bg)
+{
+  m_background = bg;
+  m_layer->setParentItem(bg);
+  m_layer->updateProjectedPoints();
+
 }
 
 void AISManager::updateViewport(QPointF ll, QPointF ur)
@@ -3,9 +3,17 @@
 
 #include <QWidget>
 #include "ros/ros.h"
+#include <ros/callback_queue.h>
 #include "project11_msgs/Contact.h"
 #include "marine_ais_msgs/AISContact.h"
 #include "ais_contact.h"
+#include "collision_risk.h"
+#include "ais_ingest.h"
+#include <QGeoCoordinate>
+
+class AISLayer;
+class AISReplay;
+class QTreeWidgetItem;
 
 namespace Ui
 {
@@ -22,26 +30,54 @@ public:
   explicit AISManager(QWidget *parent =0);
   ~AISManager();
 
-signals:
-  void newAisReport(AISReport *report);
-
 public slots:
   void updateBackground(BackgroundRaster * bg);
   void updateViewport(QPointF ll, QPointF ur);
+  void updateOwnShip(QGeoCoordinate position, double sog, double cog);
+
+  // Plays an NMEA or AIS dump recording at speed times real time, 0 for as
+  // fast as possible.
+  void replay(QString path, double speed);
 
 private slots:
   void scanForSources();
-  void addAisReport(AISReport *report);
+  // Applies the reports merged since the last frame and redraws.
+  void updateView();
+  void removeContact(uint32_t mmsi);
+  void updateRisk();
+  void on_replayButton_clicked();
 
 private:
   void contactCallback(const project11_msgs::Contact::ConstPtr& message);
   void aisContactCallback(const marine_ais_msgs::AISContact::ConstPtr& message);
+  void addContact(const AISContactUpdate& update);
+
+  enum Producer
+  {
+    ROSProducer,
+    ReplayProducer,
+    ProducerCount
+  };
 
   Ui::AISManager* m_ui;
   std::map<std::string, ros::Subscriber> m_sources;
+
+  // The sources are spun by a single thread, the only producer for the
+  // ingest queue.
+  ros::CallbackQueue m_ros_queue;
+  std::shared_ptr<ros::AsyncSpinner> m_spinner;
+  AISIngest m_ingest;
+  AISReplay* m_replay = nullptr;
+
   QTimer* m_scan_timer;
   QTimer* m_update_timer;
-  std::map<uint32_t, AISContact*> m_contacts;
+  AISLayer* m_layer;
+
+  CollisionRisk m_collision_risk;
+  QTimer* m_risk_timer;
+  std::map<uint32_t, QTreeWidgetItem*> m_contact_items;
+  // Contacts showing risk metrics from the last evaluation.
+  std::vector<uint32_t> m_evaluated_contacts;
 
   BackgroundRaster* m_background = nullptr;
 };
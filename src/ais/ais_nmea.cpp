@@ -0,0 +1,304 @@
+#include "ais_nmea.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+const double knots_to_meters_per_second = 1852.0/3600.0;
+
+std::vector<std::string> split(const std::string& s, char separator)
+{
+  std::vector<std::string> ret;
+  std::size_t start = 0;
+  while(true)
+  {
+    auto end = s.find(separator, start);
+    ret.push_back(s.substr(start, end == std::string::npos ? std::string::npos : end-start));
+    if(end == std::string::npos)
+      return ret;
+    start = end+1;
+  }
+}
+
+// Seconds, or milliseconds from recorders that log those.
+double epochSeconds(double value)
+{
+  return value > 1.0e11 ? value/1000.0 : value;
+}
+
+} // namespace
+
+AISNmeaDecoder::Bits::Bits(const std::string& payload, int fill_bits)
+{
+  bits_.reserve(payload.size()*6);
+  for(auto c: payload)
+  {
+    int value = c - 48;
+    if(value > 40)
+      value -= 8;
+    for(int bit = 5; bit >= 0; bit--)
+      bits_.push_back((value >> bit) & 1);
+  }
+  if(fill_bits > 0 && std::size_t(fill_bits) <= bits_.size())
+    bits_.resize(bits_.size()-fill_bits);
+}
+
+uint32_t AISNmeaDecoder::Bits::unsignedValue(std::size_t start, std::size_t length) const
+{
+  uint32_t value = 0;
+  for(std::size_t i = start; i < start+length; i++)
+    value = (value << 1) | (i < bits_.size() && bits_[i]);
+  return value;
+}
+
+int32_t AISNmeaDecoder::Bits::signedValue(std::size_t start, std::size_t length) const
+{
+  uint32_t value = unsignedValue(start, length);
+  if(length < 32 && (value & (1u << (length-1))))
+    value |= ~0u << length;
+  return int32_t(value);
+}
+
+std::string AISNmeaDecoder::Bits::text(std::size_t start, std::size_t characters) const
+{
+  static const char table[] = "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_ !\"#$%&'()*+,-./0123456789:;<=>?";
+  std::string ret;
+  for(std::size_t i = 0; i < characters && start+6*i+6 <= bits_.size(); i++)
+  {
+    char c = table[unsignedValue(start+6*i, 6)];
+    // @ ends the text
+    if(c == '@')
+      break;
+    ret.push_back(c);
+  }
+  while(!ret.empty() && ret.back() == ' ')
+    ret.pop_back();
+  return ret;
+}
+
+void AISNmeaDecoder::clear()
+{
+  time_ = 0.0;
+  errors_ = 0;
+  fragments_.clear();
+  details_.clear();
+}
+
+bool AISNmeaDecoder::decode(const std::string& line, AISReport& report)
+{
+  std::size_t start = 0;
+  if(!line.empty() && line[0] == '\\')
+  {
+    auto end = line.find('\\', 1);
+    if(end == std::string::npos)
+    {
+      errors_++;
+      return false;
+    }
+    auto tags = line.substr(1, end-1);
+    tags.resize(std::min(tags.size(), tags.find('*')));
+    for(const auto& tag: split(tags, ','))
+      if(tag.size() > 2 && tag.compare(0, 2, "c:") == 0)
+      {
+        char* end;
+        double time = epochSeconds(std::strtod(tag.c_str()+2, &end));
+        if(end == tag.c_str()+2 || !isValidReportTime(time))
+        {
+          errors_++;
+          return false;
+        }
+        time_ = time;
+      }
+    start = end+1;
+  }
+  else if(!line.empty() && std::isdigit(static_cast<unsigned char>(line[0])))
+  {
+    char* end;
+    double time = epochSeconds(std::strtod(line.c_str(), &end));
+    if(!isValidReportTime(time))
+    {
+      errors_++;
+      return false;
+    }
+    time_ = time;
+  }
+
+  start = line.find('!', start);
+  if(start == std::string::npos || line.size() < start+6 || line.compare(start+3, 3, "VDM") != 0)
+    return false;
+
+  auto star = line.find('*', start);
+  if(star == std::string::npos || star+3 > line.size())
+  {
+    errors_++;
+    return false;
+  }
+  int checksum = 0;
+  for(auto i = start+1; i < star; i++)
+    checksum ^= line[i];
+  if(checksum != std::strtol(line.substr(star+1, 2).c_str(), nullptr, 16))
+  {
+    errors_++;
+    return false;
+  }
+
+  auto fields = split(line.substr(start, star-start), ',');
+  if(fields.size() < 7)
+  {
+    errors_++;
+    return false;
+  }
+  int count = std::atoi(fields[1].c_str());
+  int number = std::atoi(fields[2].c_str());
+  int fill_bits = std::atoi(fields[6].c_str());
+  if(count == 1)
+    return decodePayload(fields[5], fill_bits, report);
+
+  auto key = std::make_pair(std::atoi(fields[3].c_str()), fields[4].empty() ? ' ' : fields[4][0]);
+  auto& fragments = fragments_[key];
+  // A first part, or a part out of order, starts over.
+  if(number == 1 || fragments.count != count || fragments.received != number-1)
+  {
+    fragments = Fragments();
+    if(number != 1)
+    {
+      fragments_.erase(key);
+      errors_++;
+      return false;
+    }
+    fragments.count = count;
+  }
+  fragments.payload += fields[5];
+  fragments.received = number;
+  if(number < count)
+    return false;
+  std::string payload = std::move(fragments.payload);
+  fragments_.erase(key);
+  return decodePayload(payload, fill_bits, report);
+}
+
+AISContactDetails& AISNmeaDecoder::details(uint32_t mmsi)
+{
+  auto existing = details_.find(mmsi);
+  if(existing != details_.end())
+    return existing->second;
+  auto& ret = details_[mmsi];
+  ret.mmsi = mmsi;
+  ret.dimension_to_bow = 0.0;
+  ret.dimension_to_port = 0.0;
+  ret.dimension_to_stbd = 0.0;
+  ret.dimension_to_stern = 0.0;
+  return ret;
+}
+
+bool AISNmeaDecoder::decodePayload(const std::string& payload, int fill_bits, AISReport& report)
+{
+  Bits bits(payload, fill_bits);
+  if(bits.size() < 38)
+  {
+    errors_++;
+    return false;
+  }
+  int type = bits.unsignedValue(0, 6);
+  uint32_t mmsi = bits.unsignedValue(8, 30);
+  switch(type)
+  {
+    case 1:
+    case 2:
+    case 3:
+      if(bits.size() < 137)
+        break;
+      decodePosition(bits, mmsi, 50, report);
+      return !std::isnan(report.location.location.latitude());
+    case 5:
+    {
+      if(bits.size() < 270)
+        break;
+      auto& d = details(mmsi);
+      d.name = bits.text(112, 20);
+      d.dimension_to_bow = bits.unsignedValue(240, 9);
+      d.dimension_to_stern = bits.unsignedValue(249, 9);
+      d.dimension_to_port = bits.unsignedValue(258, 6);
+      d.dimension_to_stbd = bits.unsignedValue(264, 6);
+      return false;
+    }
+    case 18:
+    case 19:
+      if(bits.size() < 133)
+        break;
+      if(type == 19)
+      {
+        if(bits.size() < 301)
+          break;
+        auto& d = details(mmsi);
+        d.name = bits.text(143, 20);
+        d.dimension_to_bow = bits.unsignedValue(271, 9);
+        d.dimension_to_stern = bits.unsignedValue(280, 9);
+        d.dimension_to_port = bits.unsignedValue(289, 6);
+        d.dimension_to_stbd = bits.unsignedValue(295, 6);
+      }
+      decodePosition(bits, mmsi, 46, report);
+      return !std::isnan(report.location.location.latitude());
+    case 24:
+    {
+      if(bits.size() < 40)
+        break;
+      auto& d = details(mmsi);
+      if(bits.unsignedValue(38, 2) == 0)
+      {
+        if(bits.size() < 160)
+          break;
+        d.name = bits.text(40, 20);
+      }
+      else
+      {
+        if(bits.size() < 162)
+          break;
+        d.dimension_to_bow = bits.unsignedValue(132, 9);
+        d.dimension_to_stern = bits.unsignedValue(141, 9);
+        d.dimension_to_port = bits.unsignedValue(150, 6);
+        d.dimension_to_stbd = bits.unsignedValue(156, 6);
+      }
+      return false;
+    }
+    default:
+      // Not needed for the display.
+      return false;
+  }
+  errors_++;
+  return false;
+}
+
+void AISNmeaDecoder::decodePosition(const Bits& bits, uint32_t mmsi, int sog_start, AISReport& report)
+{
+  static_cast<AISContactDetails&>(report) = details(mmsi);
+  report.timestamp = ros::Time(time_);
+
+  // 1/10000 minutes, 181 and 91 degrees when not available.
+  double longitude = bits.signedValue(sog_start+11, 28)/600000.0;
+  double latitude = bits.signedValue(sog_start+39, 27)/600000.0;
+  if(std::abs(longitude) > 180.0 || std::abs(latitude) > 90.0)
+  {
+    report.location.location = QGeoCoordinate();
+    return;
+  }
+  report.location.location = QGeoCoordinate(latitude, longitude);
+
+  // 1/10 knots, 1023 when not available.
+  uint32_t sog = bits.unsignedValue(sog_start, 10);
+  report.sog = sog == 1023 ? std::nan("") : sog/10.0*knots_to_meters_per_second;
+  // 1/10 degrees, 3600 when not available.
+  uint32_t cog = bits.unsignedValue(sog_start+66, 12);
+  report.cog = cog >= 3600 ? std::nan("") : cog/10.0;
+  // 511 when not available.
+  uint32_t heading = bits.unsignedValue(sog_start+78, 9);
+  if(heading < 360)
+    report.heading = heading;
+  else if(report.sog > 0.25)
+    report.heading = report.cog;
+  else
+    report.heading = std::nan("");
+}
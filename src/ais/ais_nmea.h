@@ -0,0 +1,65 @@
+#ifndef CAMP_AIS_NMEA_H
+#define CAMP_AIS_NMEA_H
+
+#include "ais_contact.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Decodes !AIVDM sentences into AISReports.
+//
+// Handles the position reports of class A (types 1, 2 and 3) and class B
+// (types 18 and 19) stations, and the static data of types 5, 19 and 24,
+// which is remembered per MMSI and added to that station's later position
+// reports. Multi sentence messages are assembled per sequence id and
+// channel.
+//
+// Sentences carry no date, so the time comes from an NMEA 4 tag block's
+// c: field or from seconds since 1970 at the start of the line, as logged
+// by most recorders. Lines without either get the last time seen.
+class AISNmeaDecoder
+{
+public:
+  // Returns true if line completed a position report.
+  bool decode(const std::string& line, AISReport& report);
+
+  // Lines with a bad checksum or that couldn't be decoded.
+  uint64_t errors() const {return errors_;}
+
+  void clear();
+
+private:
+  struct Fragments
+  {
+    int count = 0;
+    int received = 0;
+    std::string payload;
+  };
+
+  // Payload bits, most significant first.
+  class Bits
+  {
+  public:
+    Bits(const std::string& payload, int fill_bits);
+    std::size_t size() const {return bits_.size();}
+    uint32_t unsignedValue(std::size_t start, std::size_t length) const;
+    int32_t signedValue(std::size_t start, std::size_t length) const;
+    std::string text(std::size_t start, std::size_t characters) const;
+  private:
+    std::vector<bool> bits_;
+  };
+
+  bool decodePayload(const std::string& payload, int fill_bits, AISReport& report);
+  void decodePosition(const Bits& bits, uint32_t mmsi, int sog_start, AISReport& report);
+  AISContactDetails& details(uint32_t mmsi);
+
+  double time_ = 0.0;
+  uint64_t errors_ = 0;
+
+  // By sequence id and channel.
+  std::map<std::pair<int, char>, Fragments> fragments_;
+  std::unordered_map<uint32_t, AISContactDetails> details_;
+};
+
+#endif
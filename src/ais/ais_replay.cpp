@@ -0,0 +1,107 @@
+#include "ais_replay.h"
+#include "ais_dump.h"
+#include <QDebug>
+#include <algorithm>
+
+AISReplay::AISReplay(QObject* parent): QObject(parent)
+{
+  connect(&timer_, &QTimer::timeout, this, &AISReplay::play);
+}
+
+bool AISReplay::open(const QString& path)
+{
+  stop();
+  if(file_.isOpen())
+    file_.close();
+  dump_ = isAISDump(path);
+  file_.setFileName(path);
+  if(!file_.open(QIODevice::ReadOnly))
+  {
+    qWarning() << "Unable to open AIS recording" << path << file_.errorString();
+    return false;
+  }
+  return true;
+}
+
+void AISReplay::setSpeed(double speed)
+{
+  speed_ = std::max(0.0, speed);
+}
+
+void AISReplay::setSink(std::function<bool(const AISReport&)> sink)
+{
+  sink_ = sink;
+}
+
+uint64_t AISReplay::sent() const
+{
+  return sent_;
+}
+
+uint64_t AISReplay::errors() const
+{
+  return decoder_.errors() + dump_errors_;
+}
+
+void AISReplay::start()
+{
+  if(!file_.isOpen())
+    return;
+  file_.seek(dump_ ? sizeof(ais_dump_magic) : 0);
+  decoder_.clear();
+  dump_errors_ = 0;
+  sent_ = 0;
+  has_next_report_ = read();
+  first_time_ = has_next_report_ ? next_report_.timestamp.toSec() : 0.0;
+  start_time_ = ros::Time::now();
+  clock_.start();
+  timer_.start(speed_ > 0.0 ? 20 : 0);
+}
+
+void AISReplay::stop()
+{
+  timer_.stop();
+}
+
+bool AISReplay::read()
+{
+  if(dump_)
+  {
+    AISDumpRecord record;
+    while(file_.read(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record))
+    {
+      if(record.valid())
+      {
+        next_report_ = record.report();
+        return true;
+      }
+      dump_errors_++;
+    }
+    return false;
+  }
+  while(!file_.atEnd())
+    if(decoder_.decode(file_.readLine().trimmed().toStdString(), next_report_))
+      return true;
+  return false;
+}
+
+void AISReplay::play()
+{
+  double replay_time = clock_.elapsed()*speed_/1000.0;
+  int sent = 0;
+  while(has_next_report_)
+  {
+    double time = next_report_.timestamp.toSec() - first_time_;
+    if(speed_ > 0.0 ? time > replay_time : sent >= batch_size_)
+      return;
+    AISReport report = next_report_;
+    report.timestamp = speed_ > 0.0 ? start_time_ + ros::Duration(std::max(0.0, time/speed_)) : ros::Time::now();
+    if(sink_ && !sink_(report))
+      return;
+    sent_++;
+    sent++;
+    has_next_report_ = read();
+  }
+  stop();
+  emit finished();
+}
@@ -0,0 +1,74 @@
+#ifndef CAMP_AIS_REPLAY_H
+#define CAMP_AIS_REPLAY_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
+#include <functional>
+#include "ais_nmea.h"
+
+// Plays recorded AIS back as reports, from an AIS dump or from NMEA
+// sentences, one per line.
+//
+// The file is read as it plays, so recordings don't need to fit in memory.
+// Report times are moved to the replay clock, which starts when playing
+// starts, so the reports look live to the layer's history and aging. When
+// playing as fast as possible, reports are stamped as they are sent.
+// Sentences without times all play at once.
+class AISReplay: public QObject
+{
+  Q_OBJECT
+public:
+  AISReplay(QObject* parent = nullptr);
+
+  bool open(const QString& path);
+
+  // Multiple of real time, 0 to play as fast as possible.
+  void setSpeed(double speed);
+
+  // Takes each report, returning false to be offered it again on the next
+  // tick when it can't take more for now.
+  void setSink(std::function<bool(const AISReport&)> sink);
+
+  uint64_t sent() const;
+  // Sentences that couldn't be decoded, or corrupt dump records.
+  uint64_t errors() const;
+
+signals:
+  void finished();
+
+public slots:
+  // Plays from the start of the file.
+  void start();
+  void stop();
+
+private slots:
+  void play();
+
+private:
+  // Reads the next report into next_report_.
+  bool read();
+
+  QFile file_;
+  bool dump_ = false;
+  AISNmeaDecoder decoder_;
+  uint64_t dump_errors_ = 0;
+
+  std::function<bool(const AISReport&)> sink_;
+  double speed_ = 1.0;
+
+  AISReport next_report_;
+  bool has_next_report_ = false;
+  double first_time_ = 0.0;
+  ros::Time start_time_;
+  uint64_t sent_ = 0;
+
+  QElapsedTimer clock_;
+  QTimer timer_;
+
+  // Reports sent per timer tick when playing as fast as possible.
+  static constexpr int batch_size_ = 1000;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "collision_risk.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const double degrees_to_radians = M_PI/180.0;
+
+// WGS84
+const double semi_major_axis = 6378137.0;
+const double eccentricity_squared = 0.00669437999014;
+
+// Grid cells in degrees, about 11km of latitude.
+const double cell_size = 0.1;
+
+template<typename T> void swapRemove(std::vector<T>& values, std::size_t i)
+{
+  if(i+1 != values.size())
+    values[i] = values.back();
+  values.pop_back();
+}
+
+} // namespace
+
+CollisionRisk::CollisionRisk(): index_(cell_size)
+{
+}
+
+void CollisionRisk::setLimits(double cpa_limit, double tcpa_limit, double max_age)
+{
+  cpa_limit_ = cpa_limit;
+  tcpa_limit_ = tcpa_limit;
+  max_age_ = max_age;
+  // The swept bounds depend on the limits.
+  for(std::size_t c = 0; c < mmsis_.size(); c++)
+    index_.insert(mmsis_[c], sweptBounds(latitudes_[c], longitudes_[c], sogs_[c], cogs_[c], max_age_+tcpa_limit_, 0.0));
+}
+
+void CollisionRisk::updateContact(uint32_t mmsi, double latitude, double longitude, double sog, double cog, double time)
+{
+  if(std::isnan(latitude) || std::isnan(longitude))
+    return;
+  // Unknown motion is taken as stopped.
+  if(std::isnan(sog) || std::isnan(cog))
+  {
+    sog = 0.0;
+    cog = 0.0;
+  }
+
+  std::size_t c;
+  auto existing = contact_indexes_.find(mmsi);
+  if(existing == contact_indexes_.end())
+  {
+    c = mmsis_.size();
+    contact_indexes_[mmsi] = c;
+    mmsis_.push_back(mmsi);
+    latitudes_.emplace_back();
+    longitudes_.emplace_back();
+    sogs_.emplace_back();
+    cogs_.emplace_back();
+    times_.emplace_back();
+  }
+  else
+  {
+    c = existing->second;
+    // Late reports don't replace newer ones.
+    if(time < times_[c])
+      return;
+  }
+
+  latitudes_[c] = latitude;
+  longitudes_[c] = longitude;
+  sogs_[c] = sog;
+  cogs_[c] = cog;
+  times_[c] = time;
+  index_.insert(mmsi, sweptBounds(latitude, longitude, sog, cog, max_age_+tcpa_limit_, 0.0));
+}
+
+void CollisionRisk::removeContact(uint32_t mmsi)
+{
+  auto existing = contact_indexes_.find(mmsi);
+  if(existing == contact_indexes_.end())
+    return;
+  std::size_t c = existing->second;
+  contact_indexes_.erase(existing);
+  index_.remove(mmsi);
+
+  swapRemove(mmsis_, c);
+  swapRemove(latitudes_, c);
+  swapRemove(longitudes_, c);
+  swapRemove(sogs_, c);
+  swapRemove(cogs_, c);
+  swapRemove(times_, c);
+  if(c < mmsis_.size())
+    contact_indexes_[mmsis_[c]] = c;
+}
+
+void CollisionRisk::clear()
+{
+  index_.clear();
+  contact_indexes_.clear();
+  mmsis_.clear();
+  latitudes_.clear();
+  longitudes_.clear();
+  sogs_.clear();
+  cogs_.clear();
+  times_.clear();
+  results_.clear();
+}
+
+std::size_t CollisionRisk::contactCount() const
+{
+  return mmsis_.size();
+}
+
+void CollisionRisk::setOwnShip(double latitude, double longitude, double sog, double cog, double time)
+{
+  if(std::isnan(latitude) || std::isnan(longitude))
+    return;
+  if(std::isnan(sog) || std::isnan(cog))
+  {
+    sog = 0.0;
+    cog = 0.0;
+  }
+  own_latitude_ = latitude;
+  own_longitude_ = longitude;
+  own_sog_ = sog;
+  own_cog_ = cog;
+  own_time_ = time;
+  has_own_ship_ = true;
+}
+
+bool CollisionRisk::hasOwnShip() const
+{
+  return has_own_ship_;
+}
+
+const std::vector<CollisionRisk::Result>& CollisionRisk::evaluate(double time, bool dangerous_only)
+{
+  results_.clear();
+  if(!has_own_ship_)
+    return results_;
+
+  double own_cog = own_cog_*degrees_to_radians;
+  double own_east_velocity = own_sog_*std::sin(own_cog);
+  double own_north_velocity = own_sog_*std::cos(own_cog);
+
+  // Own ship dead reckoned to time is the origin of the tangent plane.
+  double latitude_degrees, longitude_degrees;
+  degreesPerMeter(own_latitude_, latitude_degrees, longitude_degrees);
+  double own_elapsed = std::max(0.0, time - own_time_);
+  double origin_latitude = own_latitude_ + own_north_velocity*own_elapsed*latitude_degrees;
+  double origin_longitude = own_longitude_ + own_east_velocity*own_elapsed*longitude_degrees;
+  degreesPerMeter(origin_latitude, latitude_degrees, longitude_degrees);
+
+  candidates_.clear();
+  index_.query(sweptBounds(origin_latitude, origin_longitude, own_sog_, own_cog_, tcpa_limit_, cpa_limit_), [&](uint32_t mmsi)
+  {
+    std::size_t c = contact_indexes_.at(mmsi);
+    if(time - times_[c] <= max_age_)
+      candidates_.push_back(c);
+  });
+
+  std::size_t n = candidates_.size();
+  east_.resize(n);
+  north_.resize(n);
+  east_velocity_.resize(n);
+  north_velocity_.resize(n);
+  cpa_.resize(n);
+  tcpa_.resize(n);
+  risk_.resize(n);
+
+  // Gathers the candidates into the tangent plane, dead reckoned to time.
+  double meters_per_latitude_degree = 1.0/latitude_degrees;
+  double meters_per_longitude_degree = 1.0/longitude_degrees;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    std::size_t c = candidates_[i];
+    double cog = cogs_[c]*degrees_to_radians;
+    east_velocity_[i] = sogs_[c]*std::sin(cog);
+    north_velocity_[i] = sogs_[c]*std::cos(cog);
+    double elapsed = time - times_[c];
+    east_[i] = std::remainder(longitudes_[c] - origin_longitude, 360.0)*meters_per_longitude_degree + east_velocity_[i]*elapsed;
+    north_[i] = (latitudes_[c] - origin_latitude)*meters_per_latitude_degree + north_velocity_[i]*elapsed;
+  }
+
+  double inverse_cpa_limit = 1.0/cpa_limit_;
+  double inverse_tcpa_limit = 1.0/tcpa_limit_;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    double dx = east_velocity_[i] - own_east_velocity;
+    double dy = north_velocity_[i] - own_north_velocity;
+    double speed_squared = dx*dx + dy*dy;
+    // Without relative motion the range stays the same.
+    double tcpa = speed_squared > 1e-9 ? -(east_[i]*dx + north_[i]*dy)/speed_squared : 0.0;
+    double t = std::max(tcpa, 0.0);
+    double x = east_[i] + dx*t;
+    double y = north_[i] + dy*t;
+    double cpa = std::sqrt(x*x + y*y);
+    tcpa_[i] = tcpa;
+    cpa_[i] = cpa;
+    double closeness = std::max(0.0, 1.0 - cpa*inverse_cpa_limit);
+    double imminence = std::max(0.0, 1.0 - tcpa*inverse_tcpa_limit)*(tcpa >= 0.0);
+    risk_[i] = closeness*imminence;
+  }
+
+  for(std::size_t i = 0; i < n; i++)
+  {
+    if(dangerous_only && risk_[i] <= 0.0)
+      continue;
+    Result result;
+    result.mmsi = mmsis_[candidates_[i]];
+    result.range = std::sqrt(east_[i]*east_[i] + north_[i]*north_[i]);
+    result.bearing = std::fmod(std::atan2(east_[i], north_[i])/degrees_to_radians + 360.0, 360.0);
+    result.cpa = cpa_[i];
+    result.tcpa = tcpa_[i];
+    result.risk = risk_[i];
+    results_.push_back(result);
+  }
+  return results_;
+}
+
+void CollisionRisk::degreesPerMeter(double latitude, double& latitude_degrees, double& longitude_degrees)
+{
+  double s = std::sin(latitude*degrees_to_radians);
+  double w = std::sqrt(1.0 - eccentricity_squared*s*s);
+  // Meridional and prime vertical radii of curvature.
+  double m = semi_major_axis*(1.0 - eccentricity_squared)/(w*w*w);
+  double n = semi_major_axis/w;
+  latitude_degrees = 1.0/(m*degrees_to_radians);
+  longitude_degrees = 1.0/(n*std::max(1e-6, std::cos(latitude*degrees_to_radians))*degrees_to_radians);
+}
+
+QRectF CollisionRisk::sweptBounds(double latitude, double longitude, double sog, double cog, double duration, double margin)
+{
+  double latitude_degrees, longitude_degrees;
+  degreesPerMeter(latitude, latitude_degrees, longitude_degrees);
+  double distance = sog*duration;
+  double end_latitude = latitude + distance*std::cos(cog*degrees_to_radians)*latitude_degrees;
+  double end_longitude = longitude + distance*std::sin(cog*degrees_to_radians)*longitude_degrees;
+  // The scale changes along the way, allow a few percent.
+  double latitude_margin = margin*latitude_degrees + 0.05*std::abs(end_latitude - latitude);
+  double longitude_margin = margin*longitude_degrees + 0.05*std::abs(end_longitude - longitude);
+  return QRectF(QPointF(std::min(longitude, end_longitude) - longitude_margin, std::min(latitude, end_latitude) - latitude_margin),
+                QPointF(std::max(longitude, end_longitude) + longitude_margin, std::max(latitude, end_latitude) + latitude_margin));
+}
@@ -0,0 +1,93 @@
+#ifndef CAMP_COLLISION_RISK_H
+#define CAMP_COLLISION_RISK_H
+
+#include "uniform_grid_index.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Closest point of approach of contacts to own ship.
+//
+// Each report is put in a grid of degree cells, covering where the contact
+// may be until it is too old to evaluate plus the time horizon, so
+// evaluating only visits the contacts that could pass within the CPA limit
+// of own ship inside the horizon. The candidates are then gathered into
+// arrays and moved to a local tangent plane at own ship, dead reckoned to
+// the evaluation time and their CPA and TCPA computed, each step being one
+// branch free loop over the batch.
+//
+// Positions are in degrees, speeds in m/s, courses in degrees from north,
+// distances in meters and times in seconds.
+class CollisionRisk
+{
+public:
+  struct Result
+  {
+    uint32_t mmsi;
+    double range;
+    double bearing;
+    double cpa;
+    // Negative once the closest point is passed.
+    double tcpa;
+    // 0 when not dangerous, up to 1 for a collision now.
+    double risk;
+  };
+
+  CollisionRisk();
+
+  // Contacts passing within cpa_limit in less than tcpa_limit are
+  // dangerous. Reports older than max_age are not evaluated.
+  void setLimits(double cpa_limit, double tcpa_limit, double max_age);
+
+  void updateContact(uint32_t mmsi, double latitude, double longitude, double sog, double cog, double time);
+  void removeContact(uint32_t mmsi);
+  void clear();
+  std::size_t contactCount() const;
+
+  void setOwnShip(double latitude, double longitude, double sog, double cog, double time);
+  bool hasOwnShip() const;
+
+  // Evaluates the contacts that may approach own ship, returning results
+  // for the dangerous ones when dangerous_only is set.
+  const std::vector<Result>& evaluate(double time, bool dangerous_only = false);
+
+private:
+  // Degrees of latitude and longitude per meter at latitude.
+  static void degreesPerMeter(double latitude, double& latitude_degrees, double& longitude_degrees);
+
+  // Box in degrees swept by a position moving for duration, grown by margin.
+  static QRectF sweptBounds(double latitude, double longitude, double sog, double cog, double duration, double margin);
+
+  double cpa_limit_ = 1000.0;
+  double tcpa_limit_ = 900.0;
+  double max_age_ = 600.0;
+
+  UniformGridIndex<uint32_t> index_;
+  std::unordered_map<uint32_t, std::size_t> contact_indexes_;
+  std::vector<uint32_t> mmsis_;
+  std::vector<double> latitudes_;
+  std::vector<double> longitudes_;
+  std::vector<double> sogs_;
+  std::vector<double> cogs_;
+  std::vector<double> times_;
+
+  bool has_own_ship_ = false;
+  double own_latitude_ = 0.0;
+  double own_longitude_ = 0.0;
+  double own_sog_ = 0.0;
+  double own_cog_ = 0.0;
+  double own_time_ = 0.0;
+
+  // Batch arrays, kept to avoid allocating each evaluation.
+  std::vector<std::size_t> candidates_;
+  std::vector<double> east_;
+  std::vector<double> north_;
+  std::vector<double> east_velocity_;
+  std::vector<double> north_velocity_;
+  std::vector<double> cpa_;
+  std::vector<double> tcpa_;
+  std::vector<double> risk_;
+  std::vector<Result> results_;
+};
+
+#endif
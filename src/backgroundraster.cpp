@@ -4,6 +4,8 @@
 #include <gdal_priv.h>
 #include <QModelIndex>
 #include <QDebug>
+#include <cmath>
+#include "colormap/colormap.h"
 
 BackgroundRaster::BackgroundRaster(const QString &fname, QObject *parent, QGraphicsItem *parentItem)
     : MissionItem(parent), QGraphicsItem(parentItem), m_filename(fname),m_valid(false),m_width(0),m_height(0)
@@ -40,28 +42,15 @@ BackgroundRaster::BackgroundRaster(const QString &fname, QObject *parent, QGraph
                     if(band->ComputeRasterMinMax(false,minmax) == CE_None)
                     {
                         qDebug() << "Depth layer: min: " << minmax[0] << " max: " << minmax[1];
+                        // zero and negative depths are land
+                        colormap::Colormap depth_colors(colormap::Palette::Bathymetric, std::nextafter(0.0f, 1.0f), minmax[1]);
+                        depth_colors.setUnderColor(qRgb(2, 100, 64));
+                        int has_no_data = false;
+                        double no_data = band->GetNoDataValue(&has_no_data);
+                        if(has_no_data)
+                            depth_colors.setNoData(no_data, qRgb(0, 0, 0));
                         for(int j = 0; j<m_height; ++j)
-                        {
-                            uchar *scanline = image.scanLine(j);
-                            for(int i = 0; i < m_width; ++i)
-                            {
-                                float depth = m_depth_data[j*m_width+i];
-                                if (depth <= 0.0)
-                                {
-                                    scanline[i*4] = 64;
-                                    scanline[i*4+1] = 100;
-                                    scanline[i*4+2] = 2;
-                                    scanline[i*4+3] = 255;
-                                }
-                                else
-                                {
-                                    scanline[i*4] = 255;
-                                    scanline[i*4+1] = 255*(1-(depth/minmax[1]));
-                                    scanline[i*4+2] = 255*(1-(depth/minmax[1]));
-                                    scanline[i*4+3] = 255;
-                                }
-                            }
-                        }
+                            depth_colors.apply(&m_depth_data[j*m_width], reinterpret_cast<QRgb*>(image.scanLine(j)), m_width);
                     }
                     
                 }
@@ -0,0 +1,410 @@
+// Measures the AIS path with synthetic harbor scenes: the reports per
+// second going from a recording through replay, ingest and the layer, the
+// time to update and paint a frame, and the memory used.
+//
+// Each scene has contacts moored in the harbor, anchored and underway,
+// reporting for 10 minutes as often as class A stations do. The reports are
+// written as NMEA sentences and as an AIS dump, and each recording is
+// replayed as fast as possible into a fresh scene. No ROS master or data is
+// needed. Runs offscreen unless QT_QPA_PLATFORM is set.
+//
+// usage: ais_benchmark [contact_count ...]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include "backgroundraster.h"
+#include "ais/ais_dump.h"
+#include "ais/ais_ingest.h"
+#include "ais/ais_layer.h"
+#include "ais/ais_replay.h"
+
+namespace
+{
+
+const double chart_latitude = 43.0;
+const double chart_longitude = -70.8;
+const double chart_degrees = 0.2;
+const int chart_size = 2048;
+
+const double start_time = 1.7e9;
+const int scene_duration = 600;
+const int frame_count = 20;
+
+QString createChart(const QTemporaryDir& dir)
+{
+  QString path = dir.filePath("chart.tif");
+  auto driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+  auto dataset = driver->Create(path.toStdString().c_str(), chart_size, chart_size, 3, GDT_Byte, nullptr);
+  double transform[6] = {chart_longitude, chart_degrees/chart_size, 0.0, chart_latitude+chart_degrees, 0.0, -chart_degrees/chart_size};
+  dataset->SetGeoTransform(transform);
+  OGRSpatialReference wgs84;
+  wgs84.SetWellKnownGeogCS("WGS84");
+  char* wkt = nullptr;
+  wgs84.exportToWkt(&wkt);
+  dataset->SetProjection(wkt);
+  CPLFree(wkt);
+  GDALClose(dataset);
+  return path;
+}
+
+// Resident memory in MB.
+double residentMemory()
+{
+  QFile status("/proc/self/status");
+  if(!status.open(QIODevice::ReadOnly))
+    return std::nan("");
+  for(auto line: status.readAll().split('\n'))
+    if(line.startsWith("VmRSS:"))
+      return line.mid(6).trimmed().split(' ').front().toDouble()/1024.0;
+  return std::nan("");
+}
+
+// Builds the six bit payloads of AIS messages.
+class PayloadWriter
+{
+public:
+  void add(uint32_t value, int bits)
+  {
+    for(int bit = bits-1; bit >= 0; bit--)
+      bits_.push_back((value >> bit) & 1);
+  }
+
+  void addSigned(double value, int bits)
+  {
+    add(uint32_t(int32_t(std::lround(value))) & ((1u << bits)-1), bits);
+  }
+
+  void addText(const std::string& text, int characters)
+  {
+    for(int i = 0; i < characters; i++)
+    {
+      char c = i < int(text.size()) ? text[i] : '@';
+      add(c >= 64 ? c-64 : c, 6);
+    }
+  }
+
+  std::string payload(int& fill_bits) const
+  {
+    auto bits = bits_;
+    fill_bits = (6 - bits.size()%6)%6;
+    bits.resize(bits.size()+fill_bits, false);
+    std::string ret;
+    for(std::size_t i = 0; i < bits.size(); i += 6)
+    {
+      int value = 0;
+      for(int j = 0; j < 6; j++)
+        value = (value << 1) | bits[i+j];
+      value += 48;
+      if(value > 87)
+        value += 8;
+      ret.push_back(char(value));
+    }
+    return ret;
+  }
+
+private:
+  std::vector<bool> bits_;
+};
+
+std::string withChecksum(const std::string& body)
+{
+  int checksum = 0;
+  for(auto c: body)
+    checksum ^= c;
+  char suffix[4];
+  snprintf(suffix, sizeof(suffix), "*%02X", checksum);
+  return body + suffix;
+}
+
+std::string sentence(const std::string& body)
+{
+  return "!" + withChecksum(body);
+}
+
+// NMEA 4 tag block with the time in seconds since 1970.
+std::string tagBlock(double time)
+{
+  return "\\" + withChecksum("c:" + std::to_string(int64_t(time))) + "\\";
+}
+
+struct Contact
+{
+  uint32_t mmsi;
+  std::string name;
+  QGeoCoordinate start;
+  // m/s and degrees
+  double sog;
+  double cog;
+  int report_interval;
+  int report_phase;
+  int to_bow;
+  int to_stern;
+  int to_port;
+  int to_stbd;
+
+  AISReport report(int t) const
+  {
+    AISReport ret;
+    ret.mmsi = mmsi;
+    ret.name = name;
+    ret.dimension_to_bow = to_bow;
+    ret.dimension_to_stern = to_stern;
+    ret.dimension_to_port = to_port;
+    ret.dimension_to_stbd = to_stbd;
+    ret.timestamp = ros::Time(start_time + t);
+    ret.location.location = sog > 0.0 ? start.atDistanceAndAzimuth(sog*t, cog) : start;
+    ret.sog = sog;
+    ret.cog = cog;
+    ret.heading = cog;
+    return ret;
+  }
+
+  std::string positionSentence(const AISReport& report) const
+  {
+    PayloadWriter w;
+    w.add(1, 6);
+    w.add(0, 2);
+    w.add(mmsi, 30);
+    w.add(sog > 0.5 ? 0 : 5, 4);
+    w.add(0x80, 8);
+    w.add(std::lround(sog*3600.0/185.2), 10);
+    w.add(0, 1);
+    w.addSigned(report.location.location.longitude()*600000.0, 28);
+    w.addSigned(report.location.location.latitude()*600000.0, 27);
+    w.add(std::lround(cog*10.0)%3600, 12);
+    w.add(std::lround(cog)%360, 9);
+    w.add(int(report.timestamp.toSec())%60, 6);
+    w.add(0, 2);
+    w.add(0, 3);
+    w.add(0, 1);
+    w.add(0, 19);
+    int fill_bits;
+    auto payload = w.payload(fill_bits);
+    return tagBlock(report.timestamp.toSec()) + sentence("AIVDM,1,1,,A," + payload + "," + std::to_string(fill_bits));
+  }
+
+  // Static and voyage data in two sentences.
+  std::vector<std::string> staticSentences(int sequence_id) const
+  {
+    PayloadWriter w;
+    w.add(5, 6);
+    w.add(0, 2);
+    w.add(mmsi, 30);
+    w.add(0, 2);
+    w.add(0, 30);
+    w.addText("SIM", 7);
+    w.addText(name, 20);
+    w.add(70, 8);
+    w.add(to_bow, 9);
+    w.add(to_stern, 9);
+    w.add(to_port, 6);
+    w.add(to_stbd, 6);
+    w.add(1, 4);
+    w.add(0, 4);
+    w.add(0, 5);
+    w.add(24, 5);
+    w.add(60, 6);
+    w.add(0, 8);
+    w.addText("PORTSMOUTH", 20);
+    w.add(0, 1);
+    w.add(0, 1);
+    int fill_bits;
+    auto payload = w.payload(fill_bits);
+    auto id = std::to_string(sequence_id);
+    return {sentence("AIVDM,2,1," + id + ",A," + payload.substr(0, 60) + ",0"),
+            sentence("AIVDM,2,2," + id + ",A," + payload.substr(60) + "," + std::to_string(fill_bits))};
+  }
+};
+
+std::vector<Contact> createScene(int contact_count)
+{
+  std::mt19937 random(contact_count);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  QGeoCoordinate harbor(chart_latitude + chart_degrees*0.5, chart_longitude + chart_degrees*0.3);
+
+  std::vector<Contact> contacts;
+  for(int i = 0; i < contact_count; i++)
+  {
+    Contact c;
+    c.mmsi = 367000000 + i;
+    c.name = "SIM " + std::to_string(i);
+    double kind = unit(random);
+    if(kind < 0.3)
+    {
+      // moored along the piers
+      c.start = harbor.atDistanceAndAzimuth(2000.0*unit(random), 360.0*unit(random));
+      c.sog = 0.0;
+      c.report_interval = 180;
+    }
+    else if(kind < 0.5)
+    {
+      // anchored, drifting slowly
+      c.start = harbor.atDistanceAndAzimuth(4000.0 + 3000.0*unit(random), 60.0 + 60.0*unit(random));
+      c.sog = 0.1;
+      c.report_interval = 60;
+    }
+    else
+    {
+      // underway in and out of the fairways
+      c.start = harbor.atDistanceAndAzimuth(8000.0*unit(random), 90.0 + 40.0*(unit(random)-0.5));
+      c.sog = 2.0 + 8.0*unit(random);
+      c.report_interval = 10;
+    }
+    c.cog = 360.0*unit(random);
+    c.report_phase = int(c.report_interval*unit(random));
+    c.to_bow = 5 + int(150*unit(random));
+    c.to_stern = 5 + int(50*unit(random));
+    c.to_port = 2 + int(15*unit(random));
+    c.to_stbd = 2 + int(15*unit(random));
+    contacts.push_back(c);
+  }
+  return contacts;
+}
+
+// Writes the scene's reports in time order.
+void writeRecordings(const std::vector<Contact>& contacts, const QString& nmea_path, const QString& dump_path)
+{
+  QFile nmea(nmea_path);
+  nmea.open(QIODevice::WriteOnly | QIODevice::Truncate);
+  QTextStream nmea_stream(&nmea);
+  AISDumpWriter dump;
+  dump.open(dump_path);
+
+  int sequence_id = 0;
+  for(const auto& c: contacts)
+  {
+    for(const auto& line: c.staticSentences(sequence_id))
+      nmea_stream << line.c_str() << "\n";
+    sequence_id = (sequence_id+1)%10;
+  }
+
+  for(int t = 0; t < scene_duration; t++)
+    for(const auto& c: contacts)
+      if(t % c.report_interval == c.report_phase)
+      {
+        auto report = c.report(t);
+        nmea_stream << c.positionSentence(report).c_str() << "\n";
+        dump.append(report);
+      }
+}
+
+struct Result
+{
+  uint64_t reports;
+  uint64_t errors;
+  double reports_per_second;
+  double update_ms;
+  double paint_ms;
+  double memory_mb;
+};
+
+Result run(QApplication& app, const QString& chart, const QString& recording)
+{
+  Result result;
+  double memory = residentMemory();
+
+  QGraphicsScene scene;
+  auto bg = new BackgroundRaster(chart);
+  bg->updateMapScale(1.0);
+  scene.addItem(bg);
+  auto layer = new AISLayer(nullptr, bg);
+
+  AISIngest ingest;
+  AISReplay replay;
+  replay.open(recording);
+  replay.setSpeed(0.0);
+  replay.setSink([&](const AISReport& report)
+  {
+    return ingest.tryPush(report);
+  });
+  bool finished = false;
+  QObject::connect(&replay, &AISReplay::finished, [&]()
+  {
+    finished = true;
+  });
+
+  // Applies batches as fast as they come instead of once per frame.
+  QElapsedTimer timer;
+  timer.start();
+  replay.start();
+  uint64_t applied = 0;
+  while(!finished || applied < replay.sent())
+  {
+    app.processEvents();
+    AISBatch batch;
+    if(ingest.take(batch))
+    {
+      for(const auto& update: batch.contacts)
+        layer->addContact(update.details, update.states);
+      applied += batch.reportCount();
+    }
+  }
+  result.reports = applied;
+  result.errors = replay.errors();
+  result.reports_per_second = applied/(timer.nsecsElapsed()/1.0e9);
+
+  QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+  qint64 update_ns = 0;
+  qint64 paint_ns = 0;
+  for(int frame = 0; frame < frame_count; frame++)
+  {
+    timer.start();
+    layer->updateView();
+    update_ns += timer.nsecsElapsed();
+    timer.start();
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    scene.render(&painter, image.rect(), bg->boundingRect());
+    paint_ns += timer.nsecsElapsed();
+  }
+  result.update_ms = update_ns/1.0e6/frame_count;
+  result.paint_ms = paint_ns/1.0e6/frame_count;
+  result.memory_mb = residentMemory() - memory;
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+  ros::Time::init();
+  GDALAllRegister();
+
+  std::vector<int> counts;
+  for(int i = 1; i < argc; i++)
+    counts.push_back(atoi(argv[i]));
+  if(counts.empty())
+    counts = {500, 2000, 10000};
+
+  QTemporaryDir dir;
+  QString chart = createChart(dir);
+
+  std::cout << "contacts\trecording\treports\terrors\treports/s\tupdate ms\tpaint ms\tmemory MB" << std::endl;
+  for(auto count: counts)
+  {
+    QString nmea = dir.filePath("scene.nmea");
+    QString dump = dir.filePath("scene.aisdump");
+    writeRecordings(createScene(count), nmea, dump);
+    for(auto recording: {nmea, dump})
+    {
+      auto result = run(app, chart, recording);
+      std::cout << count << "\t" << (recording == nmea ? "nmea" : "dump") << "\t" << result.reports << "\t" << result.errors << "\t" << result.reports_per_second << "\t" << result.update_ms << "\t" << result.paint_ms << "\t" << result.memory_mb << std::endl;
+    }
+  }
+  return 0;
+}
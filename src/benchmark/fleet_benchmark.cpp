@@ -0,0 +1,171 @@
+// Measures the cost of large fleets on the map: creating platforms, feeding
+// them positions and drawing them, with each platform painting itself and
+// with a FleetItem drawing them all.
+//
+// The platforms circle over a generated chart with simulated nav sources,
+// so no ROS master or data is needed. Runs offscreen unless
+// QT_QPA_PLATFORM is set.
+//
+// usage: fleet_benchmark [platform_count ...]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "backgroundraster.h"
+#include "nav_source.h"
+#include "platform_manager/fleet_item.h"
+#include "platform_manager/platform.h"
+
+namespace
+{
+
+const double chart_latitude = 43.1;
+const double chart_longitude = -70.8;
+const double chart_degrees = 0.2;
+const int chart_size = 2048;
+
+// Seconds of history fed to each platform before drawing, at 1 Hz.
+const int history_duration = 600;
+const int frame_count = 20;
+
+QString createChart(const QTemporaryDir& dir)
+{
+  QString path = dir.filePath("chart.tif");
+  auto driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+  auto dataset = driver->Create(path.toStdString().c_str(), chart_size, chart_size, 3, GDT_Byte, nullptr);
+  double transform[6] = {chart_longitude, chart_degrees/chart_size, 0.0, chart_latitude+chart_degrees, 0.0, -chart_degrees/chart_size};
+  dataset->SetGeoTransform(transform);
+  OGRSpatialReference wgs84;
+  wgs84.SetWellKnownGeogCS("WGS84");
+  char* wkt = nullptr;
+  wgs84.exportToWkt(&wkt);
+  dataset->SetProjection(wkt);
+  CPLFree(wkt);
+  GDALClose(dataset);
+  return path;
+}
+
+struct SimulatedPlatform
+{
+  Platform* platform;
+  NavSource* nav_source;
+  QGeoCoordinate center;
+  double radius;
+  double speed;
+  double start_angle;
+
+  void update(double time)
+  {
+    double angle = start_angle + speed*time/radius;
+    double heading = std::fmod(angle*180.0/M_PI + 90.0, 360.0);
+    nav_source->updateLocation(center.atDistanceAndAzimuth(radius, angle*180.0/M_PI), heading, time);
+  }
+};
+
+struct Result
+{
+  double create_ms;
+  double update_ms;
+  double frame_ms;
+};
+
+Result run(const QString& chart, int platform_count, bool batched)
+{
+  Result result;
+  QGraphicsScene scene;
+  auto bg = new BackgroundRaster(chart);
+  bg->updateMapScale(1.0);
+  scene.addItem(bg);
+  FleetItem* fleet = nullptr;
+  if(batched)
+    fleet = new FleetItem(bg);
+
+  std::mt19937 random(platform_count);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<SimulatedPlatform> platforms;
+
+  QElapsedTimer timer;
+  timer.start();
+  for(int i = 0; i < platform_count; i++)
+  {
+    project11_msgs::Platform message;
+    message.name = "sim_" + std::to_string(i);
+    message.width = 2.0 + 10.0*unit(random);
+    message.length = message.width*4.0;
+    message.color.r = unit(random);
+    message.color.g = unit(random);
+    message.color.b = unit(random);
+    message.color.a = 1.0;
+
+    SimulatedPlatform p;
+    p.platform = new Platform(nullptr, bg);
+    p.platform->update(message);
+    p.nav_source = new NavSource(QString("position"), p.platform, p.platform);
+    p.nav_source->setHistoryDuration(history_duration);
+    p.platform->addNavSource(p.nav_source);
+    if(fleet)
+      fleet->addPlatform(p.platform);
+    p.center = QGeoCoordinate(chart_latitude + chart_degrees*(0.2+0.6*unit(random)), chart_longitude + chart_degrees*(0.2+0.6*unit(random)));
+    p.radius = 200.0 + 1500.0*unit(random);
+    p.speed = 1.0 + 7.0*unit(random);
+    p.start_angle = 2.0*M_PI*unit(random);
+    platforms.push_back(p);
+  }
+  result.create_ms = timer.nsecsElapsed()/1.0e6;
+
+  timer.start();
+  for(int t = 0; t < history_duration; t++)
+    for(auto& p: platforms)
+      p.update(t);
+  result.update_ms = timer.nsecsElapsed()/1.0e6/history_duration;
+
+  QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+  timer.start();
+  for(int frame = 0; frame < frame_count; frame++)
+  {
+    for(auto& p: platforms)
+      p.update(history_duration+frame);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    scene.render(&painter, image.rect(), bg->boundingRect());
+  }
+  result.frame_ms = timer.nsecsElapsed()/1.0e6/frame_count;
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+  ros::Time::init();
+  GDALAllRegister();
+
+  std::vector<int> counts;
+  for(int i = 1; i < argc; i++)
+    counts.push_back(atoi(argv[i]));
+  if(counts.empty())
+    counts = {50, 100, 250, 500};
+
+  QTemporaryDir dir;
+  QString chart = createChart(dir);
+
+  std::cout << "platforms\tpainting\tcreate ms\tupdate ms/tick\tframe ms" << std::endl;
+  for(auto count: counts)
+    for(bool batched: {false, true})
+    {
+      auto result = run(chart, count, batched);
+      std::cout << count << "\t" << (batched ? "fleet" : "per item") << "\t" << result.create_ms << "\t" << result.update_ms << "\t" << result.frame_ms << std::endl;
+    }
+  return 0;
+}
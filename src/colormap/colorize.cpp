@@ -0,0 +1,77 @@
+#include "colorize.h"
+#include <algorithm>
+
+namespace colormap
+{
+
+void Int8Lut::set(int8_t value, QRgb color)
+{
+  table_[uint8_t(value)] = color;
+}
+
+QRgb Int8Lut::at(int8_t value) const
+{
+  return table_[uint8_t(value)];
+}
+
+void Int8Lut::colorize(const int8_t* values, QRgb* pixels, int count) const
+{
+  const QRgb* table = table_.data();
+  for(int i = 0; i < count; i++)
+    pixels[i] = table[uint8_t(values[i])];
+}
+
+void FloatLut::colorize(const float* values, QRgb* pixels, int count) const
+{
+  const QRgb* table = table_.data();
+  const float minimum = minimum_;
+  const float scale = scale_;
+  const float last = size-1;
+  for(int i = 0; i < count; i++)
+  {
+    float value = values[i];
+    float index = (value-minimum)*scale;
+    // written so NaN ends up at 0 before the conversion to int
+    index = index >= 0.0f ? index : 0.0f;
+    index = index <= last ? index : last;
+    QRgb color = table[int(index)];
+    color = value < minimum ? under_ : color;
+    color = value != value ? nan_ : color;
+    color = value == no_data_ ? no_data_color_ : color;
+    pixels[i] = color;
+  }
+}
+
+const Int8Lut& occupancyLut()
+{
+  static const Int8Lut lut = []()
+  {
+    Int8Lut ret;
+    // occupancy grid values are 0 to 100 percent or -1 for unknown
+    for(int i = -128; i < 128; i++)
+      if(i < 0)
+        ret.set(i, qRgba(128, 128, 128, 128));
+      else if(i >= 100)
+        ret.set(i, qRgba(255, 255, 255, 255));
+      else
+        ret.set(i, qRgba(0, 255, 0, i*2.55)); // 0-100 -> 0-255
+    return ret;
+  }();
+  return lut;
+}
+
+void colorizeGridMap(const float* data, int rows, int cols, int start_row, int start_col, const FloatLut& lut, QImage& image)
+{
+  if(image.width() != rows || image.height() != cols || image.format() != QImage::Format_ARGB32)
+    image = QImage(rows, cols, QImage::Format_ARGB32);
+  for(int i = 0; i < cols; i++)
+  {
+    const float* column = data + std::size_t((i+start_col)%cols)*rows;
+    QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(i));
+    lut.colorize(column+start_row, line, rows-start_row);
+    lut.colorize(column, line+rows-start_row, start_row);
+    std::reverse(line, line+rows);
+  }
+}
+
+} // namespace colormap
@@ -0,0 +1,88 @@
+#ifndef CAMP_COLORMAP_COLORIZE_H
+#define CAMP_COLORMAP_COLORIZE_H
+
+#include <QColor>
+#include <QImage>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// Lookup table based conversion of grid values to ARGB32 pixels.
+//
+// The kernels work on whole rows and write straight into image scanlines,
+// so images can be reused between messages instead of being filled pixel
+// by pixel through QColor.
+
+namespace colormap
+{
+
+// Maps every int8 value, such as occupancy, to a color.
+class Int8Lut
+{
+public:
+  void set(int8_t value, QRgb color);
+  QRgb at(int8_t value) const;
+
+  void colorize(const int8_t* values, QRgb* pixels, int count) const;
+
+private:
+  std::array<QRgb, 256> table_ = {};
+};
+
+// Maps a float range to colors quantized into 4096 steps. Values above the
+// range get the last entry's color.
+class FloatLut
+{
+public:
+  static constexpr int size = 4096;
+
+  // Fills the table by evaluating function over [minimum, maximum]. Below
+  // range and NaN values default to the first entry.
+  template<typename F> void set(float minimum, float maximum, F function)
+  {
+    minimum_ = minimum;
+    maximum_ = maximum;
+    scale_ = maximum > minimum ? (size-1)/(maximum-minimum) : 0.0;
+    for(int i = 0; i < size; i++)
+      table_[i] = function(minimum + i*(maximum-minimum)/(size-1));
+    under_ = table_[0];
+    nan_ = table_[0];
+  }
+
+  void setUnderColor(QRgb color) {under_ = color;}
+  void setNanColor(QRgb color) {nan_ = color;}
+
+  // Cells equal to value get color, such as a raster's no data value.
+  void setNoData(float value, QRgb color) {no_data_ = value; no_data_color_ = color;}
+
+  float minimum() const {return minimum_;}
+  float maximum() const {return maximum_;}
+
+  void colorize(const float* values, QRgb* pixels, int count) const;
+
+private:
+  std::array<QRgb, size> table_ = {};
+  float minimum_ = 0.0;
+  float maximum_ = 1.0;
+  float scale_ = 0.0;
+  QRgb under_ = 0;
+  QRgb nan_ = 0;
+  // NaN never compares equal, so no cell is no data by default.
+  float no_data_ = std::numeric_limits<float>::quiet_NaN();
+  QRgb no_data_color_ = 0;
+};
+
+// Occupancy: unknown (-1) is translucent gray, 100 and above is white and
+// occupancy in between is increasingly opaque green.
+const Int8Lut& occupancyLut();
+
+// Colorizes a grid_map layer, a column major matrix stored as a circular
+// buffer starting at start_row, start_col. Matrix rows go along decreasing
+// x so are written to the image right to left, and columns go along
+// decreasing y, one per scanline. The image is reallocated only if it isn't
+// rows by cols ARGB32 already.
+void colorizeGridMap(const float* data, int rows, int cols, int start_row, int start_col, const FloatLut& lut, QImage& image);
+
+} // namespace colormap
+
+#endif
@@ -0,0 +1,267 @@
+#include "colormap.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace colormap
+{
+
+namespace
+{
+
+QRgb toRgb(double r, double g, double b, double a = 1.0)
+{
+  auto channel = [](double v){return int(std::round(std::min(1.0, std::max(0.0, v))*255));};
+  return qRgba(channel(r), channel(g), channel(b), channel(a));
+}
+
+// Polynomial fits of matplotlib's viridis and Google's turbo.
+QRgb polynomial(const double c[7][3], double t)
+{
+  double rgb[3];
+  for(int i = 0; i < 3; i++)
+  {
+    double v = c[6][i];
+    for(int j = 5; j >= 0; j--)
+      v = v*t + c[j][i];
+    rgb[i] = v;
+  }
+  return toRgb(rgb[0], rgb[1], rgb[2]);
+}
+
+const double viridis_coefficients[7][3] = {
+  {0.2777273272234177, 0.005407344544966578, 0.3340998053353061},
+  {0.1050930431085774, 1.404613529898575, 1.384590162594685},
+  {-0.3308618287255563, 0.214847559468213, 0.09509516302823659},
+  {-4.634230498983486, -5.799100973351585, -19.33244095627987},
+  {6.228269936347081, 14.17993336680509, 56.69055260068105},
+  {4.776384997670288, -13.74514537774601, -65.35303263337234},
+  {-5.435455855934631, 4.645852612178535, 26.3124352495832}
+};
+
+const double turbo_coefficients[7][3] = {
+  {0.1140890109226559, 0.06288340699912215, 0.2248337216805064},
+  {6.716419496985708, 3.182286745507602, 7.571581586103393},
+  {-66.09402360453038, -4.9279827041226, -10.09439367561635},
+  {228.7660791526501, 25.04986699771073, -91.54105330182436},
+  {-334.8351565777451, -69.31749712757485, 288.5858850615712},
+  {218.7637218434795, 67.52150567819112, -305.2045772184957},
+  {-52.88903478218835, -21.54527364654712, 110.5174647748972}
+};
+
+// Linear interpolation between evenly spaced stops.
+QRgb stops(const std::vector<QRgb>& colors, double t)
+{
+  double position = t*(colors.size()-1);
+  int i = std::min<int>(colors.size()-2, position);
+  double f = position-i;
+  auto mix = [&](int a, int b){return a + (b-a)*f;};
+  return qRgba(mix(qRed(colors[i]), qRed(colors[i+1])), mix(qGreen(colors[i]), qGreen(colors[i+1])), mix(qBlue(colors[i]), qBlue(colors[i+1])), mix(qAlpha(colors[i]), qAlpha(colors[i+1])));
+}
+
+std::array<QRgb, 256> computePalette(Palette palette)
+{
+  std::array<QRgb, 256> ret;
+  for(int i = 0; i < 256; i++)
+  {
+    double t = i/255.0;
+    switch(palette)
+    {
+      case Palette::Viridis:
+        ret[i] = polynomial(viridis_coefficients, t);
+        break;
+      case Palette::Turbo:
+        ret[i] = polynomial(turbo_coefficients, t);
+        break;
+      case Palette::Bathymetric:
+        ret[i] = stops({qRgb(224, 247, 255), qRgb(140, 200, 240), qRgb(70, 140, 210), qRgb(30, 80, 170), qRgb(8, 30, 100)}, t);
+        break;
+      case Palette::Speed:
+        ret[i] = qRgb(255-i, 255, 0);
+        break;
+      case Palette::Intensity:
+        ret[i] = qRgba(0, i, 0, i);
+        break;
+    }
+  }
+  return ret;
+}
+
+std::atomic<quint64> next_version {1};
+
+} // namespace
+
+std::vector<Palette> palettes()
+{
+  return {Palette::Viridis, Palette::Turbo, Palette::Bathymetric, Palette::Speed, Palette::Intensity};
+}
+
+QString paletteName(Palette palette)
+{
+  switch(palette)
+  {
+    case Palette::Viridis: return "Viridis";
+    case Palette::Turbo: return "Turbo";
+    case Palette::Bathymetric: return "Bathymetric";
+    case Palette::Speed: return "Speed";
+    case Palette::Intensity: return "Intensity";
+  }
+  return {};
+}
+
+const std::array<QRgb, 256>& paletteColors(Palette palette)
+{
+  static const std::array<std::array<QRgb, 256>, 5> tables = {computePalette(Palette::Viridis), computePalette(Palette::Turbo), computePalette(Palette::Bathymetric), computePalette(Palette::Speed), computePalette(Palette::Intensity)};
+  return tables[int(palette)];
+}
+
+void AutoRange::setMode(Mode mode)
+{
+  mode_ = mode;
+  initialized_ = false;
+}
+
+void AutoRange::setRange(float minimum, float maximum)
+{
+  minimum_ = minimum;
+  maximum_ = maximum;
+}
+
+void AutoRange::setPercentiles(float low, float high)
+{
+  low_percentile_ = low;
+  high_percentile_ = high;
+}
+
+void AutoRange::setDecay(float decay)
+{
+  decay_ = decay;
+}
+
+bool AutoRange::update(const float* values, std::size_t count, float no_data)
+{
+  if(mode_ == Fixed || count == 0)
+    return false;
+
+  // Large layers are subsampled, a range doesn't need every cell.
+  std::size_t stride = std::max<std::size_t>(1, count/65536);
+  float data_min = std::numeric_limits<float>::max();
+  float data_max = std::numeric_limits<float>::lowest();
+  for(std::size_t i = 0; i < count; i += stride)
+  {
+    float v = values[i];
+    if(v != v || v == no_data)
+      continue;
+    data_min = std::min(data_min, v);
+    data_max = std::max(data_max, v);
+  }
+  if(data_min > data_max)
+    return false;
+
+  float minimum = data_min;
+  float maximum = data_max;
+  if(mode_ == Percentile && data_max > data_min)
+  {
+    samples_.clear();
+    for(std::size_t i = 0; i < count; i += stride)
+    {
+      float v = values[i];
+      if(v == v && v != no_data)
+        samples_.push_back(v);
+    }
+    auto low = samples_.begin() + std::size_t(low_percentile_*(samples_.size()-1));
+    auto high = samples_.begin() + std::size_t(high_percentile_*(samples_.size()-1));
+    std::nth_element(samples_.begin(), low, samples_.end());
+    minimum = *low;
+    // everything past low is now at least as large
+    std::nth_element(low, high, samples_.end());
+    maximum = *high;
+  }
+  else if(mode_ == Running && initialized_)
+  {
+    // Expands right away but shrinks slowly so the colors don't flicker.
+    minimum = std::min(data_min, minimum_ + (data_min-minimum_)*decay_);
+    maximum = std::max(data_max, maximum_ + (data_max-maximum_)*decay_);
+  }
+  initialized_ = true;
+
+  float span = std::max(std::abs(maximum_-minimum_), 1e-6f);
+  bool changed = std::abs(minimum-minimum_) > span*0.005 || std::abs(maximum-maximum_) > span*0.005;
+  if(changed)
+  {
+    minimum_ = minimum;
+    maximum_ = maximum;
+  }
+  return changed;
+}
+
+Colormap::Colormap(Palette palette, float minimum, float maximum):
+  palette_(palette)
+{
+  auto_range_.setRange(minimum, maximum);
+  rebuild();
+}
+
+void Colormap::setPalette(Palette palette)
+{
+  palette_ = palette;
+  rebuild();
+}
+
+void Colormap::setRange(float minimum, float maximum)
+{
+  auto_range_.setRange(minimum, maximum);
+  rebuild();
+}
+
+void Colormap::setOpacity(uint8_t opacity)
+{
+  opacity_ = opacity;
+  rebuild();
+}
+
+void Colormap::setUnderColor(QRgb color)
+{
+  has_under_color_ = true;
+  under_color_ = color;
+  rebuild();
+}
+
+void Colormap::setNanColor(QRgb color)
+{
+  nan_color_ = color;
+  rebuild();
+}
+
+void Colormap::setNoData(float value, QRgb color)
+{
+  no_data_ = value;
+  no_data_color_ = color;
+  rebuild();
+}
+
+void Colormap::updateRange(const float* values, std::size_t count)
+{
+  if(auto_range_.update(values, count, no_data_))
+    rebuild();
+}
+
+void Colormap::rebuild()
+{
+  const auto& colors = paletteColors(palette_);
+  float minimum = auto_range_.minimum();
+  float maximum = auto_range_.maximum();
+  float span = maximum > minimum ? maximum-minimum : 1.0;
+  lut_.set(minimum, maximum, [&](float value)
+  {
+    QRgb c = colors[std::min(255, std::max(0, int(std::round((value-minimum)/span*255))))];
+    return qRgba(qRed(c), qGreen(c), qBlue(c), qAlpha(c)*opacity_/255);
+  });
+  if(has_under_color_)
+    lut_.setUnderColor(under_color_);
+  lut_.setNanColor(nan_color_);
+  lut_.setNoData(no_data_, no_data_color_);
+  version_ = next_version++;
+}
+
+} // namespace colormap
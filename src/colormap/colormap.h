@@ -0,0 +1,132 @@
+#ifndef CAMP_COLORMAP_COLORMAP_H
+#define CAMP_COLORMAP_COLORMAP_H
+
+#include "colorize.h"
+#include <QString>
+#include <vector>
+
+// Palettes, value ranges and their application to scalar layers, shared by
+// grids, grid maps, background depth rasters and the radar.
+
+namespace colormap
+{
+
+enum class Palette
+{
+  // Perceptually uniform, dark purple to yellow.
+  Viridis,
+  // Rainbow like but smoother, dark blue through green to dark red.
+  Turbo,
+  // Shallow water is light, deep water dark blue.
+  Bathymetric,
+  // Yellow to green, the speed layers' legacy colors.
+  Speed,
+  // Transparent to opaque green, the legacy colors of other layers.
+  Intensity
+};
+
+std::vector<Palette> palettes();
+QString paletteName(Palette palette);
+
+// 256 colors from the low to the high end of the range, computed once.
+const std::array<QRgb, 256>& paletteColors(Palette palette);
+
+// Tracks the range of values a colormap should cover.
+class AutoRange
+{
+public:
+  enum Mode
+  {
+    // Set explicitly and never changed.
+    Fixed,
+    // Minimum and maximum of the latest values.
+    MinMax,
+    // Grows with the values, then slowly shrinks back.
+    Running,
+    // Between two percentiles of the latest values, ignoring outliers.
+    Percentile
+  };
+
+  void setMode(Mode mode);
+  Mode mode() const {return mode_;}
+
+  void setRange(float minimum, float maximum);
+  void setPercentiles(float low, float high);
+
+  // Fraction of the distance to the latest range a running range moves per
+  // update when shrinking.
+  void setDecay(float decay);
+
+  // Updates the range from values, skipping NaN and no_data. Returns true if
+  // the range moved enough to be worth recoloring.
+  bool update(const float* values, std::size_t count, float no_data);
+
+  float minimum() const {return minimum_;}
+  float maximum() const {return maximum_;}
+
+private:
+  Mode mode_ = Fixed;
+  float minimum_ = 0.0;
+  float maximum_ = 1.0;
+  float low_percentile_ = 0.02;
+  float high_percentile_ = 0.98;
+  float decay_ = 0.05;
+  bool initialized_ = false;
+
+  // Reused by the percentile mode.
+  std::vector<float> samples_;
+};
+
+// A palette stretched over a range, applied through a FloatLut which is
+// rebuilt when either changes.
+class Colormap
+{
+public:
+  Colormap(Palette palette = Palette::Viridis, float minimum = 0.0, float maximum = 1.0);
+
+  void setPalette(Palette palette);
+  Palette palette() const {return palette_;}
+
+  void setRange(float minimum, float maximum);
+  AutoRange& autoRange() {return auto_range_;}
+  const AutoRange& autoRange() const {return auto_range_;}
+
+  // Alpha applied to the palette's colors.
+  void setOpacity(uint8_t opacity);
+
+  // Below range values get the first palette color unless set.
+  void setUnderColor(QRgb color);
+  // NaN is transparent unless set.
+  void setNanColor(QRgb color);
+  void setNoData(float value, QRgb color = 0);
+
+  // Lets the auto range see new values, rebuilding the table if the range
+  // moved.
+  void updateRange(const float* values, std::size_t count);
+
+  void apply(const float* values, QRgb* pixels, int count) const {lut_.colorize(values, pixels, count);}
+  const FloatLut& lut() const {return lut_;}
+
+  // Changes whenever the table is rebuilt, unique across colormaps, so
+  // cached colorized images can tell they are stale.
+  quint64 version() const {return version_;}
+
+private:
+  void rebuild();
+
+  Palette palette_;
+  AutoRange auto_range_;
+  uint8_t opacity_ = 255;
+  bool has_under_color_ = false;
+  QRgb under_color_ = 0;
+  QRgb nan_color_ = 0;
+  float no_data_ = std::numeric_limits<float>::quiet_NaN();
+  QRgb no_data_color_ = 0;
+
+  FloatLut lut_;
+  quint64 version_ = 0;
+};
+
+} // namespace colormap
+
+#endif
@@ -32,6 +32,10 @@ public:
         SearchPatternType,
         GridType,
         AvoidAreaType,
+        RadarTargetsDisplayType,
+        RadarToolsDisplayType,
+        FleetType,
+        AISLayerType,
     };
     
     GeoGraphicsItem(QGraphicsItem *parentItem = Q_NULLPTR);
@@ -7,6 +7,7 @@
 #include <geometry_msgs/PoseStamped.h>
 #include "backgroundraster.h"
 #include <grid_map_ros/grid_map_ros.hpp>
+#include "colormap/colormap.h"
 
 Grid::Grid(QWidget* parent, QGraphicsItem *parentItem):
   QWidget(parent),
@@ -19,10 +20,10 @@ Grid::Grid(QWidget* parent, QGraphicsItem *parentItem):
 
 QRectF Grid::boundingRect() const
 {
-  if(current_grid_ && is_visible_)
+  if(!tiles_.rect().isEmpty() && is_visible_)
   {
-    auto size = current_grid_->grid_image.size();
-    auto scale = current_grid_->meters_per_pixel/pixel_size_;
+    auto size = tiles_.rect().size();
+    auto scale = meters_per_pixel_/pixel_size_;
     QRectF ret(-scale*size.width()/2.0,-scale*size.height()/2.0, size.width()*scale, size.height()*scale);
     return ret;
   }
@@ -31,13 +32,14 @@ QRectF Grid::boundingRect() const
 
 void Grid::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
-  if(current_grid_ && is_visible_)
+  if(!tiles_.rect().isEmpty() && is_visible_)
   {
     painter->save();
-    auto scale = current_grid_->meters_per_pixel/pixel_size_;
+    auto scale = meters_per_pixel_/pixel_size_;
     painter->scale(scale, scale);
-    auto size = current_grid_->grid_image.size();
-    painter->drawImage(QPoint(-size.width()/2.0, -size.height()/2.0), current_grid_->grid_image);
+    auto size = tiles_.rect().size();
+    painter->translate(-size.width()/2.0, -size.height()/2.0);
+    tiles_.draw(painter);
     painter->restore();
   }
 }
@@ -68,34 +70,41 @@ void Grid::setPixelSize(double s)
 
 void Grid::occupancyGridCallback(const nav_msgs::OccupancyGrid::ConstPtr &data)
 {
-  auto grid_data = std::make_shared<GridData>();
-  grid_data->grid_image = QImage(data->info.width, data->info.height, QImage::Format_ARGB32);
+  auto grid_data = spareGrid();
+  if(grid_data->grid_image.width() != data->info.width || grid_data->grid_image.height() != data->info.height)
+    grid_data->grid_image = QImage(data->info.width, data->info.height, QImage::Format_ARGB32);
   grid_data->meters_per_pixel = data->info.resolution;
+  const auto& lut = colormap::occupancyLut();
   for(int row = 0; row < data->info.height; row++)
-  {
-    // occupancy grid values are 0 to 100 percent or -1 for unknown
-    auto row_start = row*data->info.width;
-    for(int col = 0; col < data->info.width; col++)
-    {
-      QColor color;
-      if( data->data[row_start+col] < 0)
-        color = QColor(128, 128, 128, 128);
-      else if( data->data[row_start+col] >= 100)
-        color = QColor(255, 255, 255, 255);
-      else
-        color = QColor(0, 255, 0, data->data[row_start+col]*2.55); // 0-100 -> 0-255
-      grid_data->grid_image.setPixelColor(QPoint(col, data->info.height-1-row), color);
-    }
-  }
+    lut.colorize(&data->data[row*data->info.width], reinterpret_cast<QRgb*>(grid_data->grid_image.scanLine(data->info.height-1-row)), data->info.width);
   geometry_msgs::Pose center_pose = data->info.origin;
   center_pose.position.x += data->info.resolution*data->info.width/2.0;
   center_pose.position.y += data->info.resolution*data->info.height/2.0;
   grid_data->center = getGeoCoordinate(center_pose, data->header);
+  publishGrid(grid_data);
+}
+
+std::shared_ptr<Grid::GridData> Grid::spareGrid()
+{
+  std::lock_guard<std::mutex> lock(spare_grid_mutex_);
+  std::shared_ptr<GridData> ret;
+  ret.swap(spare_grid_);
+  if(!ret)
+    ret = std::make_shared<GridData>();
+  return ret;
+}
+
+void Grid::publishGrid(std::shared_ptr<GridData> grid_data)
+{
+  bool notify = new_grid_.put(grid_data, [this](std::shared_ptr<GridData>& pending, std::shared_ptr<GridData>&& grid)
   {
-    std::lock_guard<std::mutex> lock(new_grid_mutex_);
-    new_grid_ = grid_data;
-  }
-  emit newGridMadeAvaiable();
+    // a grid never displayed can be reused right away
+    std::lock_guard<std::mutex> lock(spare_grid_mutex_);
+    spare_grid_ = pending;
+    pending = grid;
+  });
+  if(notify)
+    emit newGridMadeAvaiable();
 }
 
 void Grid::gridMapCallback(const grid_map_msgs::GridMap::ConstPtr &data)
@@ -120,37 +129,27 @@ void Grid::gridMapCallback(const grid_map_msgs::GridMap::ConstPtr &data)
     }
   if(layer.empty())
    layer = grid_map.getLayers().front(); 
-  auto grid_data = std::make_shared<GridData>();
+  auto grid_data = spareGrid();
   auto size = grid_map.getSize();
-  grid_data->grid_image = QImage(size.x(), size.y(), QImage::Format_ARGB32);
   grid_data->meters_per_pixel = data->info.resolution;
 
-  if(layer == "speed")
-    for(grid_map::GridMapIterator iterator(grid_map); !iterator.isPastEnd(); ++iterator)
-    {
-      double value = grid_map.at(layer, *iterator);
-      if(value < 0.0)
-        grid_data->grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(255, 0, 0, 128));
-      else
-      {
-        uint8_t ival = std::min(1.0,std::max(0.0, value/3.0))*255;
-        grid_data->grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(255-ival, 255, 0, 128));
-      }
-    }
-  else
-    for(grid_map::GridMapIterator iterator(grid_map); !iterator.isPastEnd(); ++iterator)
-    {
-      double value = grid_map.at(layer, *iterator);
-      uint8_t ival = std::min(1.0,std::max(0.0, value))*255;
-      grid_data->grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(0, ival, 0, ival));
-    }
+  static const auto speed_colormap = []()
+  {
+    colormap::Colormap ret(colormap::Palette::Speed, 0.0, 3.0);
+    ret.setOpacity(128);
+    ret.setUnderColor(qRgba(255, 0, 0, 128));
+    // NaN speeds have always drawn as zero speed.
+    ret.setNanColor(qRgba(255, 255, 0, 128));
+    return ret;
+  }();
+  static const colormap::Colormap intensity_colormap(colormap::Palette::Intensity, 0.0, 1.0);
+  const auto& lut = layer == "speed" ? speed_colormap.lut() : intensity_colormap.lut();
+  const auto& matrix = grid_map.get(layer);
+  auto start = grid_map.getStartIndex();
+  colormap::colorizeGridMap(matrix.data(), size.x(), size.y(), start.x(), start.y(), lut, grid_data->grid_image);
 
   grid_data->center = getGeoCoordinate(data->info.pose, data->info.header);
-  {
-    std::lock_guard<std::mutex> lock(new_grid_mutex_);
-    new_grid_ = grid_data;
-  }
-  emit newGridMadeAvaiable();
+  publishGrid(grid_data);
 }
 
 QGeoCoordinate Grid::getGeoCoordinate(const geometry_msgs::Pose &pose, const std_msgs::Header &header)
@@ -184,19 +183,28 @@ QGeoCoordinate Grid::getGeoCoordinate(const geometry_msgs::Pose &pose, const std
 
 void Grid::newGridAvailable()
 {
-  if(current_grid_)
-    prepareGeometryChange();
+  std::shared_ptr<GridData> grid;
+  if(!new_grid_.take(grid))
+    return;
 
+  prepareGeometryChange();
+  tiles_.setImage(grid->grid_image);
+  center_ = grid->center;
+  meters_per_pixel_ = grid->meters_per_pixel;
   {
-    std::lock_guard<std::mutex> lock(new_grid_mutex_);
-    current_grid_ = new_grid_;
-    new_grid_.reset();
+    // The pixels are in the tiles now, so the image is free to be refilled.
+    std::lock_guard<std::mutex> lock(spare_grid_mutex_);
+    spare_grid_ = grid;
   }
 
+  auto dropped = new_grid_.dropped();
+  if(dropped > 0)
+    ui_.droppedLabel->setText(QString("dropped: %1/%2").arg(dropped).arg(new_grid_.received()));
+
   auto bg = findParentBackgroundRaster();
-  if(bg && current_grid_)
+  if(bg)
   {
-    setPos(geoToPixel(current_grid_->center, bg));
+    setPos(geoToPixel(center_, bg));
   }
 
   GeoGraphicsItem::update();
@@ -229,8 +237,8 @@ void Grid::updateBackground(BackgroundRaster * bg)
   if(bg)
   {
     setPixelSize(bg->pixelSize());
-    if(current_grid_)
-      setPos(geoToPixel(current_grid_->center, bg));
+    if(!tiles_.rect().isEmpty())
+      setPos(geoToPixel(center_, bg));
   }
   GeoGraphicsItem::update();
 }
\ No newline at end of file
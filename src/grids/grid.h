@@ -8,6 +8,8 @@
 #include "grid_map_msgs/GridMap.h"
 #include "ros/ros.h"
 #include <ros/callback_queue.h>
+#include "raster/tile_pyramid.h"
+#include "latest_mailbox.h"
 
 namespace tf2_ros
 {
@@ -47,11 +49,23 @@ private:
     float meters_per_pixel;
   };
 
+  // Returns a grid to fill, reusing the spare one when possible.
+  std::shared_ptr<GridData> spareGrid();
+  void publishGrid(std::shared_ptr<GridData> grid_data);
+
   Ui::Grid ui_;
 
-  std::shared_ptr<GridData> current_grid_; 
-  std::shared_ptr<GridData> new_grid_;
-  std::mutex new_grid_mutex_;
+  // The displayed grid. The tiles are the only copy of its pixels, its
+  // image being handed back as the spare once tiled.
+  raster::TilePyramid tiles_;
+  QGeoCoordinate center_;
+  float meters_per_pixel_ = 1.0;
+
+  LatestMailbox<std::shared_ptr<GridData> > new_grid_;
+  // Grid already tiled or never displayed, its image is reused by the next
+  // message.
+  std::shared_ptr<GridData> spare_grid_;
+  std::mutex spare_grid_mutex_;
 
 
   ros::CallbackQueue ros_queue_;
@@ -132,9 +132,11 @@ void HelmManager::updatePilotingMode(QString const &piloting_mode)
 
 void HelmManager::updateHeartbeatTimes(double last_heartbeat_timestamp, double last_heartbeat_receive_time)
 {
+  if(m_last_heartbeat_receive_time.isValid() && !m_last_heartbeat_receive_time.isZero())
+    m_heartbeat_interval.add(last_heartbeat_receive_time, last_heartbeat_receive_time - m_last_heartbeat_receive_time.toSec());
+  m_heartbeat_latency.add(last_heartbeat_receive_time, last_heartbeat_receive_time - last_heartbeat_timestamp);
   m_last_heartbeat_timestamp.fromSec(last_heartbeat_timestamp);
   m_last_heartbeat_receive_time.fromSec(last_heartbeat_receive_time);
-
 }
 
 void HelmManager::watchdogUpdate()
@@ -157,6 +159,12 @@ void HelmManager::watchdogUpdate()
     ros::Duration last_receive_duration = now-m_last_heartbeat_receive_time;
     ros::Duration latency = m_last_heartbeat_receive_time - m_last_heartbeat_timestamp;
     QString msg = "Last HB: " + QString::number(last_receive_duration.toSec()) + "s Latency: " + QString::number(latency.toSec()) +"s";
+    m_heartbeat_latency.expire(now.toSec());
+    m_heartbeat_interval.expire(now.toSec());
+    if(!m_heartbeat_latency.empty())
+      msg += " (60s avg: " + QString::number(m_heartbeat_latency.mean(),'f',2) + "s max: " + QString::number(m_heartbeat_latency.maximum(),'f',2) + "s)";
+    if(!m_heartbeat_interval.empty())
+      msg += " Interval: " + QString::number(m_heartbeat_interval.mean(),'f',2) + "s";
     ui->timeLatencyLabel->setText(msg);
   }
 }
@@ -4,6 +4,7 @@
 #include <QWidget>
 #include "ros/ros.h"
 #include "project11_msgs/Heartbeat.h"
+#include "../rolling_statistics.h"
 
 namespace Ui
 {
@@ -48,6 +49,10 @@ private:
 
   ros::Time m_last_heartbeat_timestamp;
   ros::Time m_last_heartbeat_receive_time;
+
+  // Over the last 60 seconds of heartbeats.
+  RollingStatistics m_heartbeat_latency;
+  RollingStatistics m_heartbeat_interval;
     
   QTimer * m_watchdog_timer;
 
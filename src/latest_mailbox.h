@@ -0,0 +1,74 @@
+#ifndef CAMP_LATEST_MAILBOX_H
+#define CAMP_LATEST_MAILBOX_H
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+// Single slot handoff from a worker thread to the GUI thread where the
+// latest value wins.
+//
+// A value put while the previous one is still unread replaces it, or is
+// merged into it, and counts as dropped, so a reader that falls behind sees
+// fewer, fresher values instead of a growing queue.
+template<typename T> class LatestMailbox
+{
+public:
+  // Returns true if the mailbox was empty, in which case the reader should
+  // be notified. Later puts before the reader takes the value don't need to
+  // notify again.
+  bool put(T value)
+  {
+    return put(std::move(value), [](T& pending, T&& value){pending = std::move(value);});
+  }
+
+  // merge(pending, value) combines a new value into the unread one.
+  template<typename Merge> bool put(T value, Merge merge)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    received_++;
+    if(full_)
+    {
+      merge(value_, std::move(value));
+      dropped_++;
+      return false;
+    }
+    value_ = std::move(value);
+    full_ = true;
+    return true;
+  }
+
+  // Moves the unread value to value. Returns false if there was none.
+  bool take(T& value)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!full_)
+      return false;
+    value = std::move(value_);
+    value_ = T();
+    full_ = false;
+    return true;
+  }
+
+  // Values replaced or merged before being read.
+  uint64_t dropped() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+  }
+
+  uint64_t received() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return received_;
+  }
+
+private:
+  T value_;
+  bool full_ = false;
+  uint64_t dropped_ = 0;
+  uint64_t received_ = 0;
+  mutable std::mutex mutex_;
+};
+
+#endif
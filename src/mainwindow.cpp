@@ -71,10 +71,12 @@ MainWindow::MainWindow(QWidget *parent) :
     m_ais_manager = new AISManager();
     connect(project, &AutonomousVehicleProject::backgroundUpdated, m_ais_manager, &AISManager::updateBackground);
     connect(m_ui->projectView, &ProjectView::viewportChanged, m_ais_manager, &AISManager::updateViewport);
+    connect(m_ui->platformManager, &PlatformManager::currentPlatformMotion, m_ais_manager, &AISManager::updateOwnShip);
 
     //m_radar_manager = new RadarManager();
     //m_radar_manager->setTFBuffer(m_ui->rosLink->tfBuffer());
     //connect(project, &AutonomousVehicleProject::backgroundUpdated, m_radar_manager, &RadarManager::updateBackground);
+    // Once the radar manager is back, connect its guard zone alarms to m_speech_alerts, created below.
 
     m_grid_manager = new GridManager();
     m_grid_manager->setTFBuffer(m_ui->rosLink->tfBuffer());
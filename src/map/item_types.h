@@ -37,6 +37,8 @@ enum ItemType
 
   // other QGraphicsItem descendants
   TileType,
+  TilePyramidType,
+  MarkerListType,
 };
 
 } // namespace map
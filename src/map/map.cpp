@@ -305,6 +305,40 @@ void Map::setMapItemParent(MapItem* child_item, MapItem* parent_item)
   endInsertRows()  ;
 }
 
+void Map::deleteMapItem(MapItem* map_item)
+{
+  auto parent_item = map_item->parentMapItem();
+  if(parent_item)
+  {
+    // reverse list index, see index(int, int, const QModelIndex&) for details
+    auto siblings = parent_item->childMapItems();
+    int row = siblings.size()-1-siblings.indexOf(map_item);
+    beginRemoveRows(index(parent_item), row, row);
+    map_item->setParentItem(nullptr);
+    if(map_item->scene())
+      map_item->scene()->removeItem(map_item);
+    endRemoveRows();
+  }
+  delete map_item;
+}
+
+void Map::deleteChildMapItems(MapItem* parent_item)
+{
+  auto children = parent_item->childMapItems();
+  if(children.empty())
+    return;
+  beginRemoveRows(index(parent_item), 0, children.size()-1);
+  // Last child first, which QGraphicsItem removes without searching.
+  for(auto child = children.rbegin(); child != children.rend(); child++)
+  {
+    (*child)->setParentItem(nullptr);
+    if((*child)->scene())
+      (*child)->scene()->removeItem(*child);
+  }
+  endRemoveRows();
+  qDeleteAll(children);
+}
+
 void Map::contextMenuFor(QMenu* menu, const QModelIndex& index)
 {
   auto map_item = reinterpret_cast<MapItem*>(index.internalPointer());
@@ -53,6 +53,13 @@ public:
   // Notifies the view of the change then sets the child's parent.
   void setMapItemParent(MapItem* child_item, MapItem* parent_item);
 
+  // Notifies the view of the removal then deletes the item.
+  void deleteMapItem(MapItem* map_item);
+
+  // Same as deleteMapItem for each of the parent's map item children, as a
+  // single removal.
+  void deleteChildMapItems(MapItem* parent_item);
+
   // Sets context menu items for given index
   void contextMenuFor(QMenu* menu, const QModelIndex& index);
 
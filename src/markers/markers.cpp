@@ -8,12 +8,17 @@
 #include "backgroundraster.h"
 #include <grid_map_ros/grid_map_ros.hpp>
 #include <QTimer>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
 
 Markers::Markers(QWidget* parent, QGraphicsItem *parentItem):
   QWidget(parent),
   GeoGraphicsItem(parentItem)
 {
   ui_.setupUi(this);
+  expiry_wheel_ = new TimingWheel(this);
+  // paint uses the exposed rect to query the index
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
   connect(this, &Markers::newMarkersMadeAvailable, this, &Markers::newMarkersAvailable, Qt::QueuedConnection);
   connect(ui_.displayCheckBox, &QCheckBox::stateChanged, this, &Markers::visibilityChanged);
   ui_.displayCheckBox->setChecked(true);
@@ -21,47 +26,136 @@ Markers::Markers(QWidget* parent, QGraphicsItem *parentItem):
 
 QRectF Markers::boundingRect() const
 {
-  QRectF ret;
-  BackgroundRaster* bg = findParentBackgroundRaster();
-  if(!current_markers_.empty() && is_visible_)
+  if(current_markers_.empty() || !is_visible_)
+    return QRectF();
+  if(bounds_dirty_)
   {
-    for(auto ns: current_markers_)
-      for(auto m: ns.second)
-      {
-        auto p = markerPath(*(m.second), bg);
-        ret |= p.boundingRect();
-      }
+    bounds_ = QRectF();
+    for(const auto& ns: current_markers_)
+      for(const auto& m: ns.second.markers)
+        bounds_ |= m.second->bounds;
+    bounds_dirty_ = false;
   }
-  return ret;
+  return bounds_;
 }
 
 void Markers::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
+  if(current_markers_.empty() || !is_visible_)
+    return;
+
   BackgroundRaster* bg = findParentBackgroundRaster();
-  if(!current_markers_.empty() && is_visible_)
-    for(auto ns: current_markers_)
-      for(auto m: ns.second)
+  if(bg && bg->scaledPixelSize() != text_scale_ && !text_rebuild_pending_)
+  {
+    // Geometry can't change while painting, resize the text right after.
+    text_rebuild_pending_ = true;
+    QTimer::singleShot(0, this, &Markers::rebuildTextGeometry);
+  }
+
+  painter->save();
+  std::vector<int32_t> ids;
+  for(const auto& ns: current_markers_)
+  {
+    ids.clear();
+    ns.second.index.query(option->exposedRect, [&](int32_t id){ids.push_back(id);});
+    // draw in id order, like before indexing
+    std::sort(ids.begin(), ids.end());
+    for(auto id: ids)
+    {
+      const auto& marker = ns.second.markers.at(id);
+      if(!marker->bounds.intersects(option->exposedRect) && !marker->bounds.isEmpty())
+        continue;
+      painter->setPen(marker->pen);
+      painter->setBrush(marker->brush);
+      painter->drawPath(marker->path);
+    }
+  }
+  painter->restore();
+}
+
+void Markers::updateGeometry(MarkerData& marker, BackgroundRaster* bg)
+{
+  if(bg)
+    marker.local_position = geoToPixel(marker.position, bg);
+  marker.path = markerPath(marker, bg);
+  marker.bounds = marker.path.boundingRect();
+
+  const auto& color = marker.marker.color;
+  QPen p;
+  p.setColor(QColor(color.r*255, color.g*255, color.b*255, color.a*255));
+  if(marker.marker.type == visualization_msgs::Marker::LINE_STRIP)
+    p.setWidthF(marker.marker.scale.x/pixel_size_);
+  if(marker.marker.type == visualization_msgs::Marker::TEXT_VIEW_FACING)
+    p.setCosmetic(true);
+  marker.pen = p;
+
+  QBrush b;
+  b.setColor(QColor(color.r*255, color.g*255, color.b*255, color.a*128));
+  if(marker.marker.type == visualization_msgs::Marker::SPHERE || marker.marker.type == visualization_msgs::Marker::TEXT_VIEW_FACING)
+    b.setStyle(Qt::BrushStyle::SolidPattern);
+  marker.brush = b;
+}
+
+void Markers::rebuildGeometry()
+{
+  prepareGeometryChange();
+  auto bg = findParentBackgroundRaster();
+  if(bg)
+    text_scale_ = bg->scaledPixelSize();
+  for(auto& ns: current_markers_)
+  {
+    ns.second.index.clear();
+    for(auto& m: ns.second.markers)
+    {
+      updateGeometry(*m.second, bg);
+      ns.second.index.insert(m.first, m.second->bounds);
+    }
+  }
+  bounds_dirty_ = true;
+}
+
+void Markers::rebuildTextGeometry()
+{
+  text_rebuild_pending_ = false;
+  auto bg = findParentBackgroundRaster();
+  if(!bg || bg->scaledPixelSize() == text_scale_)
+    return;
+  prepareGeometryChange();
+  text_scale_ = bg->scaledPixelSize();
+  for(auto& ns: current_markers_)
+    for(auto& m: ns.second.markers)
+      if(m.second->marker.type == visualization_msgs::Marker::TEXT_VIEW_FACING)
       {
-        painter->save();
-        QPen p;
-        p.setColor(QColor(m.second->marker.color.r*255, m.second->marker.color.g*255, m.second->marker.color.b*255, m.second->marker.color.a*255));
-        if(m.second->marker.type == visualization_msgs::Marker::LINE_STRIP)
-        {
-          p.setWidthF(m.second->marker.scale.x/pixel_size_);
-          // p.setWidth(0);
-          // p.setCosmetic(true);
-        }
-        if(m.second->marker.type == visualization_msgs::Marker::TEXT_VIEW_FACING)
-          p.setCosmetic(true);
-        painter->setPen(p);
-        QBrush b = painter->brush();
-        b.setColor(QColor(m.second->marker.color.r*255, m.second->marker.color.g*255, m.second->marker.color.b*255, m.second->marker.color.a*128));
-        if(m.second->marker.type == visualization_msgs::Marker::SPHERE || m.second->marker.type == visualization_msgs::Marker::TEXT_VIEW_FACING)
-          b.setStyle(Qt::BrushStyle::SolidPattern);
-        painter->setBrush(b);
-        painter->drawPath(markerPath(*m.second, bg));
-        painter->restore();
+        updateGeometry(*m.second, bg);
+        ns.second.index.insert(m.first, m.second->bounds);
       }
+  bounds_dirty_ = true;
+  GeoGraphicsItem::update();
+}
+
+void Markers::removeMarker(const std::string& ns, int32_t id)
+{
+  auto n = current_markers_.find(ns);
+  if(n == current_markers_.end())
+    return;
+  auto marker = n->second.markers.find(id);
+  if(marker == n->second.markers.end())
+    return;
+  expiry_wheel_->cancel(marker->second->expiry);
+  n->second.index.remove(id);
+  n->second.markers.erase(marker);
+  bounds_dirty_ = true;
+}
+
+void Markers::clearNamespace(const std::string& ns)
+{
+  auto n = current_markers_.find(ns);
+  if(n == current_markers_.end())
+    return;
+  for(const auto& marker: n->second.markers)
+    expiry_wheel_->cancel(marker.second->expiry);
+  current_markers_.erase(n);
+  bounds_dirty_ = true;
 }
 
 QPainterPath Markers::markerPath(const MarkerData& marker, BackgroundRaster* bg) const
@@ -141,6 +235,7 @@ void Markers::setTF2Buffer(tf2_ros::Buffer* buffer)
 void Markers::setPixelSize(double s)
 {
   pixel_size_ = s;
+  rebuildGeometry();
 }
 
 void Markers::markerArrayCallback(const visualization_msgs::MarkerArrayConstPtr &data)
@@ -230,45 +325,54 @@ void Markers::newMarkersAvailable()
   }
 
   auto bg = findParentBackgroundRaster();
+  if(bg && text_scale_ == 0.0)
+    text_scale_ = bg->scaledPixelSize();
   for(auto marker: new_markers)
   {
+    const auto& ns = marker->marker.ns;
     switch(marker->marker.action)
     {
       case visualization_msgs::Marker::ADD:
-        if(bg)
-          marker->local_position = geoToPixel(marker->position, bg);
+      {
+        updateGeometry(*marker, bg);
         //ROS_INFO_STREAM(marker->marker.ns << ": " << marker->marker.id << " local pos: " << marker->local_position.x() << ", " << marker->local_position.y());
-        current_markers_[marker->marker.ns][marker->marker.id] = marker;
-        if(!marker->marker.lifetime.isZero())
-          QTimer::singleShot((marker->marker.lifetime.toSec()+1.0)*1000, this, &Markers::newMarkersAvailable);
+        auto& n = current_markers_[ns];
+        auto& current = n.markers[marker->marker.id];
+        // a replaced marker may have shrunk
+        if(current)
+        {
+          bounds_dirty_ = true;
+          expiry_wheel_->cancel(current->expiry);
+        }
+        else if(!bounds_dirty_)
+          bounds_ |= marker->bounds;
+        current = marker;
+        n.index.insert(marker->marker.id, marker->bounds);
+        if(!marker->marker.header.stamp.isZero() && !marker->marker.lifetime.isZero())
+        {
+          std::string ns_name = ns;
+          int32_t id = marker->marker.id;
+          marker->expiry = expiry_wheel_->schedule(marker->marker.header.stamp + marker->marker.lifetime, [this, ns_name, id]()
+          {
+            ROS_DEBUG_STREAM("Purging " << ns_name << ": " << id);
+            prepareGeometryChange();
+            removeMarker(ns_name, id);
+            GeoGraphicsItem::update();
+          });
+        }
         break;
+      }
       case visualization_msgs::Marker::DELETE:
-        current_markers_[marker->marker.ns][marker->marker.id].reset();
+        removeMarker(ns, marker->marker.id);
         break;
       case visualization_msgs::Marker::DELETEALL:
-        current_markers_[marker->marker.ns].clear();
+        clearNamespace(ns);
         break;
       default:
         ROS_WARN_STREAM("Unknown marker action: " << marker->marker.action);
     }
   }
 
-  auto now = ros::Time::now();
-
-  for(auto& ns: current_markers_)
-  {
-    std::vector<int32_t> expired;
-    for(auto m: ns.second)
-      if(!m.second || (!m.second->marker.header.stamp.isZero() && !m.second->marker.lifetime.isZero()&& m.second->marker.header.stamp + m.second->marker.lifetime < now))
-        expired.push_back(m.first);
-    for(auto e: expired)
-    {
-      ROS_DEBUG_STREAM("Purging " << ns.first << ": " << e);
-      ns.second.erase(e);
-
-    }
-  }
-
   GeoGraphicsItem::update();
 }
 
@@ -288,5 +392,7 @@ void Markers::updateBackground(BackgroundRaster * bg)
   {
     setPixelSize(bg->pixelSize());
   }
+  else
+    rebuildGeometry();
   GeoGraphicsItem::update();
 }
@@ -7,12 +7,19 @@
 #include "visualization_msgs/MarkerArray.h"
 #include "ros/ros.h"
 #include <ros/callback_queue.h>
+#include "uniform_grid_index.h"
+#include "timing_wheel.h"
 
 namespace tf2_ros
 {
   class Buffer;
 }
 
+// Draws visualization markers over the background.
+//
+// Each marker's path, bounds, pen and brush are projected once, when the
+// marker or the background changes. Markers are indexed per namespace so
+// paint only draws those touching the exposed rect.
 class Markers: public QWidget, public GeoGraphicsItem
 {
   Q_OBJECT
@@ -34,6 +41,9 @@ public slots:
   void updateBackground(BackgroundRaster * bg);
   void newMarkersAvailable();
 
+private slots:
+  void rebuildTextGeometry();
+
 private:
   void markerArrayCallback(const visualization_msgs::MarkerArrayConstPtr &data);
   void markerCallback(const visualization_msgs::MarkerConstPtr &data);
@@ -47,13 +57,44 @@ private:
     QGeoCoordinate position;
     QPointF local_position;
     double rotation;
+
+    // Projected geometry, in the background's pixels.
+    QPainterPath path;
+    QRectF bounds;
+    QPen pen;
+    QBrush brush;
+
+    TimingWheel::Handle expiry = 0;
   };
 
   QPainterPath markerPath(const MarkerData& marker, BackgroundRaster* bg) const;
+  void updateGeometry(MarkerData& marker, BackgroundRaster* bg);
+  void rebuildGeometry();
+  void removeMarker(const std::string& ns, int32_t id);
+  void clearNamespace(const std::string& ns);
 
   Ui::Markers ui_;
 
-  std::map<std::string, std::map<int32_t, std::shared_ptr<MarkerData> > > current_markers_;
+  struct Namespace
+  {
+    std::map<int32_t, std::shared_ptr<MarkerData> > markers;
+    UniformGridIndex<int32_t> index;
+  };
+
+  std::map<std::string, Namespace> current_markers_;
+
+  // Union of the markers' bounds, recomputed when a marker shrinks or goes.
+  mutable QRectF bounds_;
+  mutable bool bounds_dirty_ = false;
+
+  // Text is sized according to the map scale, this is the one the text
+  // paths were made for.
+  double text_scale_ = 0.0;
+  bool text_rebuild_pending_ = false;
+
+  // Removes markers at the end of their lifetime.
+  TimingWheel* expiry_wheel_ = nullptr;
+
   std::vector<std::shared_ptr<MarkerData> > new_markers_;
   std::mutex new_markers_mutex_;
 
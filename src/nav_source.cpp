@@ -1,11 +1,13 @@
 #include "nav_source.h"
 #include <tf2/utils.h>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QTimer>
 #include <QDebug>
 
 NavSource::NavSource(const project11_msgs::NavSource& source, QObject* parent, QGraphicsItem *parentItem): QObject(parent), GeoGraphicsItem(parentItem)
 {
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
   setColor(color_);
   pending_position_topic_ = source.position_topic;
   pending_orientation_topic_ = source.orientation_topic;
@@ -16,6 +18,7 @@ NavSource::NavSource(const project11_msgs::NavSource& source, QObject* parent, Q
 
 NavSource::NavSource(std::pair<const std::string, XmlRpc::XmlRpcValue> &source, QObject* parent, QGraphicsItem *parentItem): QObject(parent), GeoGraphicsItem(parentItem)
 {
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
   setColor(color_);
   if (source.second.hasMember("position_topic"))
     pending_position_topic_ = std::string(source.second["position_topic"]);
@@ -27,6 +30,13 @@ NavSource::NavSource(std::pair<const std::string, XmlRpc::XmlRpcValue> &source,
   trySubscribe();
 }
 
+NavSource::NavSource(const QString& name, QObject* parent, QGraphicsItem *parentItem): QObject(parent), GeoGraphicsItem(parentItem)
+{
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+  setColor(color_);
+  setObjectName(name);
+}
+
 void NavSource::trySubscribe()
 {
   ros::master::V_TopicInfo topic_info;
@@ -87,7 +97,7 @@ void NavSource::trySubscribe()
 
 QRectF NavSource::boundingRect() const
 {
-  return shape().boundingRect().marginsAdded(QMargins(2,2,2,2));
+  return (recent_track_.boundingRect() | thinned_track_.boundingRect()).marginsAdded(QMargins(2,2,2,2));
 }
 
 void NavSource::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
@@ -100,10 +110,7 @@ void NavSource::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
   p1.setWidth(2);
   painter->setPen(p1);
 
-  auto s = shapes();
-
-  auto l = location();
-  painter->drawPath(s.first);
+  drawRecentTrack(painter, option->exposedRect);
 
   QPen p2;
   p2.setCosmetic(true);
@@ -111,71 +118,31 @@ void NavSource::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
   p2.setWidth(1);
   painter->setPen(p2);
 
-  painter->drawPath(s.second);
+  drawThinnedTrack(painter, option->exposedRect);
 
   painter->restore();
 }
 
-QPainterPath NavSource::shape() const
+void NavSource::drawRecentTrack(QPainter* painter, const QRectF& exposed) const
 {
-  QPainterPath ret;
-  auto s = shapes();
-  ret.addPath(s.first);
-  ret.addPath(s.second);
-  return ret;
+  recent_track_.draw(painter, exposed);
 }
 
-std::pair<QPainterPath, QPainterPath> NavSource::shapes() const
+void NavSource::drawThinnedTrack(QPainter* painter, const QRectF& exposed) const
 {
-  auto paths = std::make_pair<QPainterPath,QPainterPath>({},{});
-  auto location_iterator = location_history_.rbegin();
-  auto last_point = location_history_.rend();
-  if(location_iterator != location_history_.rend())
-  {
-    double latest_time = location_iterator->first;
-    bool first_point = true;
-    while(location_iterator != location_history_.rend())
-    {
-      if(location_iterator->first < latest_time-60.0)
-        break;
-      if(location_iterator->second.location.isValid())
-        if(first_point)
-        {
-          paths.first.moveTo(location_iterator->second.pos);
-          first_point = false;
-        }
-        else
-        {
-          paths.first.lineTo(location_iterator->second.pos);
-          last_point = location_iterator;
-        }
-      location_iterator++;
-    }
-    if(last_point != location_history_.rend())
-    {
-      paths.second.moveTo(last_point->second.pos);
-      first_point = false;
-    }
-    else
-      first_point = true;
-    while(location_iterator != location_history_.rend())
-    {
-      if(location_iterator->second.location.isValid())
-        if(first_point)
-        {
-          paths.second.moveTo(location_iterator->second.pos);
-          first_point = false;
-        }
-        else
-        {
-          paths.second.lineTo(location_iterator->second.pos);
-        }
-      location_iterator++;
-    }
-  }
-  return paths;
+  thinned_track_.draw(painter, exposed);
+  // join the two tracks
+  if(!thinned_history_.empty() && !recent_history_.empty())
+    painter->drawLine(thinned_history_.back().pos, recent_history_.front().pos);
 }
 
+QPainterPath NavSource::shape() const
+{
+  QPainterPath ret;
+  ret.addPath(recent_track_.path());
+  ret.addPath(thinned_track_.path());
+  return ret;
+}
 
 void NavSource::positionCallback(const sensor_msgs::NavSatFix::ConstPtr& message)
 {
@@ -217,6 +184,10 @@ void NavSource::orientationCallback(const sensor_msgs::Imu::ConstPtr& message)
 void NavSource::velocityCallback(const geometry_msgs::TwistWithCovarianceStamped::ConstPtr& message)
 {
   QMetaObject::invokeMethod(this,"updateSog", Qt::QueuedConnection, Q_ARG(double, sqrt(pow(message->twist.twist.linear.x,2) + pow(message->twist.twist.linear.y, 2))));
+  double cog = 90-180*atan2(message->twist.twist.linear.y, message->twist.twist.linear.x)/M_PI;
+  if(cog < 0.0)
+    cog += 360.0;
+  QMetaObject::invokeMethod(this,"updateCog", Qt::QueuedConnection, Q_ARG(double, cog));
 }
 
 
@@ -225,90 +196,196 @@ void NavSource::updateSog(double sog)
   emit NavSource::sog(sog);
 }
 
+void NavSource::updateCog(double cog)
+{
+  emit NavSource::cog(cog);
+}
+
 void NavSource::updateLocation(QGeoCoordinate const &location, float heading, double time)
 {
   emit beforeNavUpdate();
-  prepareGeometryChange();
 
-  location_history_[time].time = time;
+  // Time went backwards, as when sim time restarts or an older bag plays,
+  // so start over rather than ignore everything until it catches up.
   if(location.isValid())
   {
-    location_history_[time].location = location;
+    if(!recent_history_.empty() && time < recent_history_.back().time)
+      resetHistory();
+    if(telemetry_log_.size() > 0 && time < telemetry_log_.endTime())
+      telemetry_log_.rotate();
+  }
+
+  if(!isnan(heading) && time >= latest_heading_.time)
+  {
+    latest_heading_.time = time;
+    latest_heading_.heading = heading;
+  }
+
+  if(location.isValid())
+  {
+    LocationPositionHeadingTime lpht;
+    lpht.time = time;
+    lpht.location = location;
+    lpht.heading = heading;
     auto bg = findParentBackgroundRaster();
     if(bg)
-      location_history_[time].pos = geoToPixel(location, bg);
+      lpht.pos = geoToPixel(location, bg);
+    appendLocation(lpht);
+    if(telemetry_log_.isOpen())
+    {
+      TelemetryRecord record;
+      record.time = time;
+      record.latitude = location.latitude();
+      record.longitude = location.longitude();
+      record.altitude = location.altitude();
+      record.heading = isnan(heading) ? latest_heading_.heading : heading;
+      telemetry_log_.append(record);
+    }
+    emit positionUpdate(location);
   }
-  if(!isnan(heading))
-    location_history_[time].heading = heading;
+}
 
-  // trim samples that are older than buffer durration, if applicable.
-  while(buffer_duration_ > 0.0 && !location_history_.empty() && location_history_.rbegin()->first-buffer_duration_ > location_history_.begin()->first)
-    location_history_.erase(location_history_.begin()->first);
+void NavSource::appendLocation(const LocationPositionHeadingTime& location)
+{
+  // Drops repeated samples, updateLocation resets the history when time
+  // goes backwards.
+  if(!recent_history_.empty() && location.time <= recent_history_.back().time)
+    return;
+
+  prepareGeometryChange();
 
-  // thin older data
-  if(!location_history_.empty())
+  // Move samples out of the full rate window, keeping some.
+  while(!recent_history_.empty() && recent_history_.front().time < location.time - high_resolution_duration_)
   {
-    double low_res_end_time = location_history_.rbegin()->first - high_resolution_duration_;
-    std::vector<double> discard_pile;
-    auto location_iterator = location_history_.begin();
-    double last_keep_time = location_iterator->first;
-    location_iterator++;
-    while(location_iterator != location_history_.end() && location_iterator->first < low_res_end_time)
+    const auto& old = recent_history_.front();
+    if(thinned_history_.empty() || old.time >= thinned_history_.back().time + low_resolution_period_)
     {
-      if(location_iterator->first >= last_keep_time+low_resolution_period_)
+      if(thinned_history_.full())
       {
-        last_keep_time = location_iterator->first;
-      }
-      else
-      {
-        discard_pile.push_back(location_iterator->first);
+        if(buffer_duration_ > 0.0 && thinned_history_.front().time < location.time - buffer_duration_)
+          thinned_track_.popFront();
+        else
+          thinned_history_.setCapacity(thinned_history_.capacity()*2);
       }
-      location_iterator++;
+      thinned_history_.push_back(old);
+      thinned_track_.append(old.pos);
     }
-
-    for(auto discard: discard_pile)
-      location_history_.erase(discard);
+    recent_history_.pop_front();
+    recent_track_.popFront();
   }
 
+  // Samples left are all in the window, grow rather than lose one.
+  if(recent_history_.full())
+    recent_history_.setCapacity(recent_history_.capacity()*2);
+  recent_history_.push_back(location);
+  recent_track_.append(location.pos);
 
-  if(location.isValid())
-    emit positionUpdate(location);
+  // trim samples that are older than buffer durration, if applicable.
+  if(buffer_duration_ > 0.0)
+  {
+    double cutoff = location.time - buffer_duration_;
+    while(!thinned_history_.empty() && thinned_history_.front().time < cutoff)
+    {
+      thinned_history_.pop_front();
+      thinned_track_.popFront();
+    }
+    while(!recent_history_.empty() && recent_history_.front().time < cutoff)
+    {
+      recent_history_.pop_front();
+      recent_track_.popFront();
+    }
+  }
+}
+
+void NavSource::resetHistory()
+{
+  prepareGeometryChange();
+  recent_history_.clear();
+  thinned_history_.clear();
+  recent_track_.clear();
+  thinned_track_.clear();
+  latest_heading_ = LocationPositionHeadingTime();
 }
 
 void NavSource::updateProjectedPoints()
 {
   prepareGeometryChange();
   auto bg = findParentBackgroundRaster();
-  if(bg)
-    for(auto& lp: location_history_)
-      lp.second.pos = geoToPixel(lp.second.location, bg);
+  if(!bg)
+    return;
+  recent_track_.clear();
+  for(std::size_t i = 0; i < recent_history_.size(); i++)
+  {
+    recent_history_[i].pos = geoToPixel(recent_history_[i].location, bg);
+    recent_track_.append(recent_history_[i].pos);
+  }
+  thinned_track_.clear();
+  for(std::size_t i = 0; i < thinned_history_.size(); i++)
+  {
+    thinned_history_[i].pos = geoToPixel(thinned_history_[i].location, bg);
+    thinned_track_.append(thinned_history_[i].pos);
+  }
 }
 
 LocationPositionHeadingTime NavSource::location() const
 {
-  auto location_iterator = location_history_.rbegin();
-  while(location_iterator != location_history_.rend())
-    if(location_iterator->second.location.isValid())
-      return location_iterator->second;
-    else
-      location_iterator++;
+  if(!recent_history_.empty())
+    return recent_history_.back();
+  if(!thinned_history_.empty())
+    return thinned_history_.back();
   return {};
 }
 
 LocationPositionHeadingTime NavSource::heading() const
 {
-  auto location_iterator = location_history_.rbegin();
-  while(location_iterator != location_history_.rend())
-    if(!isnan(location_iterator->second.heading))
-      return location_iterator->second;
-    else
-      location_iterator++;
-  return {};
+  return latest_heading_;
 }
 
 void NavSource::setHistoryDuration(double duration)
 {
   buffer_duration_ = duration;
+  // room for the whole thinned history up front
+  if(duration > 0.0)
+    thinned_history_.setCapacity(std::max(thinned_history_.size(), std::size_t(duration/low_resolution_period_)+16));
+}
+
+bool NavSource::openTelemetryLog(const QString& path)
+{
+  if(!telemetry_log_.open(path))
+    return false;
+  if(telemetry_log_.size() == 0)
+    return true;
+
+  double end = telemetry_log_.endTime();
+  double start = buffer_duration_ > 0.0 ? end - buffer_duration_ : telemetry_log_.startTime();
+  auto bg = findParentBackgroundRaster();
+  for(auto i = telemetry_log_.lowerBound(start); i < telemetry_log_.size(); i++)
+  {
+    const auto& record = telemetry_log_.at(i);
+    LocationPositionHeadingTime lpht;
+    lpht.time = record.time;
+    lpht.location = QGeoCoordinate(record.latitude, record.longitude, record.altitude);
+    lpht.heading = record.heading;
+    if(bg)
+      lpht.pos = geoToPixel(lpht.location, bg);
+    appendLocation(lpht);
+    if(!isnan(record.heading) && record.time >= latest_heading_.time)
+    {
+      latest_heading_.time = record.time;
+      latest_heading_.heading = record.heading;
+    }
+  }
+  return true;
+}
+
+QString NavSource::telemetryLogPath() const
+{
+  return telemetry_log_.path();
+}
+
+void NavSource::setHighResolutionDuration(double duration)
+{
+  high_resolution_duration_ = duration;
 }
 
 void NavSource::setColor(QColor color)
@@ -317,3 +394,13 @@ void NavSource::setColor(QColor color)
   dim_color_ = color;
   dim_color_.setAlphaF(color.alphaF()*.5);
 }
+
+QColor NavSource::color() const
+{
+  return color_;
+}
+
+QColor NavSource::dimColor() const
+{
+  return dim_color_;
+}
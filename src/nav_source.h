@@ -10,6 +10,9 @@
 #include "geometry_msgs/TwistWithCovarianceStamped.h"
 #include "geographic_msgs/GeoPointStamped.h"
 #include "geographic_msgs/GeoPoseStamped.h"
+#include "ring_buffer.h"
+#include "track_path.h"
+#include "telemetry_log.h"
 
 class NavSource: public QObject, public GeoGraphicsItem
 {
@@ -18,6 +21,8 @@ class NavSource: public QObject, public GeoGraphicsItem
 public:
   NavSource(const project11_msgs::NavSource& source, QObject* parent, QGraphicsItem *parentItem = nullptr);
   NavSource(std::pair<const std::string, XmlRpc::XmlRpcValue> &source, QObject* parent, QGraphicsItem *parentItem = nullptr);
+  /// Source without topics, fed through updateLocation.
+  NavSource(const QString& name, QObject* parent, QGraphicsItem *parentItem = nullptr);
 
   int type() const override {return NavSourceType;}
 
@@ -25,16 +30,31 @@ public:
   void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
   QPainterPath shape() const override;
 
-  std::pair<QPainterPath, QPainterPath> shapes() const;
 
   LocationPositionHeadingTime location() const;
   LocationPositionHeadingTime heading() const;
 
   void setColor(QColor color);
+  QColor color() const;
+  QColor dimColor() const;
+
+  /// Draw the tracks with the painter's pen so a FleetItem can batch
+  /// sources of the same color. The recent track uses color(), the thinned
+  /// one dimColor() along with the line joining them.
+  void drawRecentTrack(QPainter* painter, const QRectF& exposed) const;
+  void drawThinnedTrack(QPainter* painter, const QRectF& exposed) const;
+
+  /// Logs locations to path and reloads the history kept in it.
+  bool openTelemetryLog(const QString& path);
+  QString telemetryLogPath() const;
+
+  /// How long to keep full rate data in seconds.
+  void setHighResolutionDuration(double duration);
 
 signals:
   void beforeNavUpdate();
   void sog(double sog);
+  void cog(double cog);
   void positionUpdate(QGeoCoordinate position);
 
 public slots:
@@ -44,6 +64,7 @@ public slots:
   /// Set buffer duration in seconds 
   void setHistoryDuration(double duration);
   void updateSog(double sog);
+  void updateCog(double cog);
   void trySubscribe();
 
 private:
@@ -61,7 +82,24 @@ private:
   std::string pending_orientation_topic_;
   std::string pending_velocity_topic_;
 
-  std::map<double, LocationPositionHeadingTime> location_history_;
+  void appendLocation(const LocationPositionHeadingTime& location);
+
+  // Drops the history and tracks, for when time goes backwards.
+  void resetHistory();
+
+  // Full rate locations from the last high_resolution_duration_ seconds,
+  // and older ones thinned to one per low_resolution_period_. Only samples
+  // with a valid location are kept.
+  RingBuffer<LocationPositionHeadingTime> recent_history_;
+  RingBuffer<LocationPositionHeadingTime> thinned_history_;
+
+  // Projected tracks of the above, updated as samples come and go.
+  TrackPath recent_track_;
+  TrackPath thinned_track_;
+
+  LocationPositionHeadingTime latest_heading_;
+
+  TelemetryLog telemetry_log_;
 
   /// How long data should be kept in seconds. Forever if 0.
   double buffer_duration_ = 0.0;
@@ -0,0 +1,123 @@
+#include "fleet_item.h"
+#include "platform.h"
+#include "nav_source.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <map>
+
+FleetItem::FleetItem(QGraphicsItem* parentItem): GeoGraphicsItem(parentItem)
+{
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+  setZValue(6.0);
+}
+
+FleetItem::~FleetItem()
+{
+  for(auto platform: platforms_)
+    platform->setFleet(nullptr);
+}
+
+QRectF FleetItem::boundingRect() const
+{
+  if(bounds_dirty_)
+  {
+    bounds_ = QRectF();
+    for(auto platform: platforms_)
+    {
+      bounds_ |= platform->boundingRect();
+      for(auto nav: platform->navSources())
+        bounds_ |= nav.second->boundingRect();
+    }
+    bounds_dirty_ = false;
+  }
+  return bounds_;
+}
+
+void FleetItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  const QRectF& exposed = option->exposedRect;
+
+  std::map<QRgb, std::vector<NavSource*> > recent_tracks;
+  std::map<QRgb, std::vector<NavSource*> > thinned_tracks;
+  std::map<QRgb, QPainterPath> symbols;
+  for(auto platform: platforms_)
+  {
+    for(auto nav: platform->navSources())
+      if(nav.second->boundingRect().intersects(exposed))
+      {
+        recent_tracks[nav.second->color().rgba()].push_back(nav.second);
+        thinned_tracks[nav.second->dimColor().rgba()].push_back(nav.second);
+      }
+    auto symbol = platform->shape();
+    if(symbol.boundingRect().intersects(exposed))
+      symbols[platform->color().rgba()].addPath(symbol);
+  }
+
+  painter->save();
+  painter->setBrush(Qt::NoBrush);
+  QPen pen;
+  pen.setCosmetic(true);
+
+  pen.setWidth(1);
+  for(const auto& tracks: thinned_tracks)
+  {
+    pen.setColor(QColor::fromRgba(tracks.first));
+    painter->setPen(pen);
+    for(auto nav: tracks.second)
+      nav->drawThinnedTrack(painter, exposed);
+  }
+
+  pen.setWidth(2);
+  for(const auto& tracks: recent_tracks)
+  {
+    pen.setColor(QColor::fromRgba(tracks.first));
+    painter->setPen(pen);
+    for(auto nav: tracks.second)
+      nav->drawRecentTrack(painter, exposed);
+  }
+
+  pen.setWidth(4);
+  for(const auto& symbol: symbols)
+  {
+    pen.setColor(QColor::fromRgba(symbol.first));
+    painter->setPen(pen);
+    painter->drawPath(symbol.second);
+  }
+
+  painter->restore();
+}
+
+void FleetItem::addPlatform(Platform* platform)
+{
+  platformChanged();
+  platforms_.push_back(platform);
+  platform->setFleet(this);
+}
+
+void FleetItem::removePlatform(Platform* platform)
+{
+  auto i = std::find(platforms_.begin(), platforms_.end(), platform);
+  if(i == platforms_.end())
+    return;
+  platformChanged();
+  platforms_.erase(i);
+  platform->setFleet(nullptr);
+}
+
+const std::vector<Platform*>& FleetItem::platforms() const
+{
+  return platforms_;
+}
+
+void FleetItem::platformChanged()
+{
+  // Once dirty, the scene already has the old bounds to repaint.
+  if(bounds_dirty_)
+  {
+    update();
+    return;
+  }
+  prepareGeometryChange();
+  bounds_dirty_ = true;
+}
@@ -0,0 +1,45 @@
+#ifndef CAMP_FLEET_ITEM_H
+#define CAMP_FLEET_ITEM_H
+
+#include "geographicsitem.h"
+#include <vector>
+
+class Platform;
+
+// Draws the symbols and tracks of all platforms in one paint call.
+//
+// Platforms added to the fleet stop painting themselves and their nav
+// sources, but stay in the scene for hovering. The fleet skips what is
+// outside the exposed area and groups the rest by color so the pen is set
+// once per color instead of once per platform. Tracks are drawn under the
+// symbols.
+//
+// The fleet and its platforms are expected to share the background's
+// coordinates.
+class FleetItem: public GeoGraphicsItem
+{
+public:
+  FleetItem(QGraphicsItem* parentItem = nullptr);
+  ~FleetItem();
+
+  int type() const override {return FleetType;}
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  void addPlatform(Platform* platform);
+  void removePlatform(Platform* platform);
+  const std::vector<Platform*>& platforms() const;
+
+  // Called before a platform moves or changes appearance.
+  void platformChanged();
+
+private:
+  std::vector<Platform*> platforms_;
+
+  // Union of the platforms and their tracks, computed when next needed.
+  mutable QRectF bounds_;
+  mutable bool bounds_dirty_ = true;
+};
+
+#endif
@@ -3,23 +3,106 @@
 #include <QPainter>
 #include "nav_source.h"
 #include "backgroundraster.h"
+#include "telemetry_replay.h"
+#include "fleet_item.h"
+#include "geoviz/geoviz_display.h"
+#include <QDir>
 
 #include <QDebug>
 
 Platform::Platform(QWidget* parent, QGraphicsItem *parentItem):
   QWidget(parent),
-  ShipTrack(parentItem),
-  m_ui(new Ui::Platform)
+  ShipTrack(parentItem)
 {
-  m_ui->setupUi(this);
   setAcceptHoverEvents(true);
-  m_ui->geovizDisplay->setParentItem(this);
   setZValue(6.0);
+  // Draws on the map, so it exists whether or not the panel does.
+  m_geoviz_display = new GeovizDisplay(this, this);
 }
 
 Platform::~Platform()
 {
+  if(m_fleet)
+    m_fleet->removePlatform(this);
+  delete m_ui;
+}
+
+bool Platform::hasWidgets() const
+{
+  return m_ui != nullptr;
+}
+
+void Platform::createWidgets()
+{
+  if(m_ui)
+    return;
+  m_ui = new Ui::Platform;
+  m_ui->setupUi(this);
+  m_ui->horizontalLayout->addWidget(m_geoviz_display);
+  if(!m_robot_namespace.isEmpty())
+  {
+    m_ui->helmManager->updateRobotNamespace(m_robot_namespace);
+    m_ui->missionManager->updateRobotNamespace(m_robot_namespace);
+  }
+  updateTelemetryLabel();
+}
+
+void Platform::setRobotNamespace(QString robot_namespace)
+{
+  m_robot_namespace = robot_namespace;
+  m_geoviz_display->updateRobotNamespace(robot_namespace);
+  if(m_ui)
+  {
+    m_ui->helmManager->updateRobotNamespace(robot_namespace);
+    m_ui->missionManager->updateRobotNamespace(robot_namespace);
+  }
+}
+
+void Platform::addNavSource(NavSource* nav_source)
+{
+  std::string name = nav_source->objectName().toStdString();
+  m_nav_sources[name] = nav_source;
+  nav_source->setParent(this);
+  nav_source->setParentItem(this);
+  connect(nav_source, &NavSource::beforeNavUpdate, this, &Platform::aboutToUpdateNav);
+  connect(nav_source, &NavSource::positionUpdate, this, &Platform::updatePosition);
+  if(m_nav_sources.size() == 1)
+  {
+    connect(nav_source, &NavSource::sog, this, &Platform::updateSog);
+    connect(nav_source, &NavSource::cog, this, &Platform::updateCog);
+  }
+  nav_source->setColor(trackColor());
+  nav_source->setFlag(QGraphicsItem::ItemHasNoContents, m_fleet != nullptr);
+  m_shape_dirty = true;
+}
+
+const std::map<std::string, NavSource*>& Platform::navSources() const
+{
+  return m_nav_sources;
+}
+
+QColor Platform::color() const
+{
+  return m_color;
+}
+
+qreal Platform::sog() const
+{
+  return m_sog/1.9438;
+}
+
+qreal Platform::cog() const
+{
+  return m_cog;
+}
 
+void Platform::setFleet(FleetItem* fleet)
+{
+  m_fleet = fleet;
+  setFlag(QGraphicsItem::ItemHasNoContents, fleet != nullptr);
+  for(auto nav: m_nav_sources)
+    nav.second->setFlag(QGraphicsItem::ItemHasNoContents, fleet != nullptr);
+  QGraphicsItem::update();
 }
 
 QRectF Platform::boundingRect() const
@@ -42,17 +125,25 @@ void Platform::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
 
 QPainterPath Platform::shape() const
 {
-  QPainterPath ret;
+  // Cached until the platform moves or the view's scale changes.
+  BackgroundRaster* bg = findParentBackgroundRaster();
+  qreal pixel_size = bg ? bg->scaledPixelSize() : 0.0;
+  if(!m_shape_dirty && bg == m_shape_background && pixel_size == m_shape_pixel_size)
+    return m_shape;
+  m_shape_dirty = false;
+  m_shape_background = bg;
+  m_shape_pixel_size = pixel_size;
+
+  QPainterPath& ret = m_shape;
+  ret = QPainterPath();
   if(!m_nav_sources.empty())
   {
-    BackgroundRaster* bg = findParentBackgroundRaster();
     if(bg)
       {
         bool forceTriangle = false;
         if (m_length == 0 || m_width == 0)
           forceTriangle = true;
         float max_size = std::max(m_length, m_width);
-        qreal pixel_size = bg->scaledPixelSize();
 
         LocationPositionHeadingTime location, heading;
         for(const auto& ns: m_nav_sources)
@@ -87,14 +178,13 @@ void Platform::update(project11_msgs::Platform& platform)
   std::string platformNamespace = platform.name;
   if(!platform.platform_namespace.empty())
     platformNamespace = platform.platform_namespace;
-  m_ui->helmManager->updateRobotNamespace(platformNamespace.c_str());
-  m_ui->missionManager->updateRobotNamespace(platformNamespace.c_str());
-  m_ui->geovizDisplay->updateRobotNamespace(platformNamespace.c_str());
+  setRobotNamespace(platformNamespace.c_str());
 
   m_width = platform.width;
   m_length = platform.length;
   m_reference_x = platform.reference_x;
   m_reference_y = platform.reference_y;
+  m_shape_dirty = true;
 
   if (platform.color.a > 0.0)
   {
@@ -109,13 +199,10 @@ void Platform::update(project11_msgs::Platform& platform)
   for(auto ns: platform.nav_sources)
     if(m_nav_sources.find(ns.name) == m_nav_sources.end())
     {
-      m_nav_sources[ns.name] = new NavSource(ns, this, this);
-      m_nav_sources[ns.name]->setHistoryDuration(7200);
-      connect(m_nav_sources[ns.name], &NavSource::beforeNavUpdate, this, &Platform::aboutToUpdateNav);
-      connect(m_nav_sources[ns.name], &NavSource::positionUpdate, this, &Platform::updatePosition);
-      if(m_nav_sources.size() == 1)
-        connect(m_nav_sources[ns.name], &NavSource::sog, this, &Platform::updateSog);
-      m_nav_sources[ns.name]->setColor(m_color);
+      auto nav_source = new NavSource(ns, this, this);
+      nav_source->setHistoryDuration(7200);
+      nav_source->openTelemetryLog(telemetryLogPath(ns.name));
+      addNavSource(nav_source);
     }
 
 }
@@ -129,9 +216,7 @@ void Platform::update(std::pair<const std::string, XmlRpc::XmlRpcValue> &platfor
   std::string platformNamespace = platform.first;
   if(platform.second.hasMember("namespace"))
     platformNamespace = std::string(platform.second["namespace"]);
-  m_ui->helmManager->updateRobotNamespace(platformNamespace.c_str());
-  m_ui->missionManager->updateRobotNamespace(platformNamespace.c_str());
-  m_ui->geovizDisplay->updateRobotNamespace(platformNamespace.c_str());
+  setRobotNamespace(platformNamespace.c_str());
 
   if(platform.second.hasMember("width"))
     m_width = double(platform.second["width"]);
@@ -141,15 +226,14 @@ void Platform::update(std::pair<const std::string, XmlRpc::XmlRpcValue> &platfor
     m_reference_x = double(platform.second["reference_x"]);
   if(platform.second.hasMember("reference_y"))
     m_reference_y = double(platform.second["reference_y"]);
+  m_shape_dirty = true;
   if(platform.second.hasMember("nav_sources"))
     for(auto nav: platform.second["nav_sources"])
     {
-      m_nav_sources[nav.first] = new NavSource(nav, this, this);
-      m_nav_sources[nav.first]->setHistoryDuration(7200);
-      connect(m_nav_sources[nav.first], &NavSource::beforeNavUpdate, this, &Platform::aboutToUpdateNav);
-      connect(m_nav_sources[nav.first], &NavSource::positionUpdate, this, &Platform::updatePosition);
-      if(m_nav_sources.size() == 1)
-        connect(m_nav_sources[nav.first], &NavSource::sog, this, &Platform::updateSog);
+      auto nav_source = new NavSource(nav, this, this);
+      nav_source->setHistoryDuration(7200);
+      nav_source->openTelemetryLog(telemetryLogPath(nav.first));
+      addNavSource(nav_source);
     }
   if(platform.second.hasMember("color"))
   {
@@ -168,6 +252,39 @@ void Platform::update(std::pair<const std::string, XmlRpc::XmlRpcValue> &platfor
   }
 }
 
+QString Platform::telemetryLogPath(const std::string& nav_source) const
+{
+  return QDir::home().filePath(".CCOMAutonomousMissionPlanner/telemetry/"+objectName()+"/"+QString::fromStdString(nav_source)+".tlm");
+}
+
+void Platform::replayTelemetry(double start, double end, double speed)
+{
+  // Replaces the previous replay, stopping it if still playing.
+  for(auto source: m_replay_sources)
+    delete source.second;
+  m_replay_sources.clear();
+
+  for(auto nav: m_nav_sources)
+  {
+    auto source = new NavSource(QString::fromStdString(nav.first)+" replay", this, this);
+    auto replay = new TelemetryReplay(source);
+    if(!replay->open(nav.second->telemetryLogPath()))
+    {
+      delete source;
+      continue;
+    }
+    replay->setRange(start, end);
+    replay->setSpeed(speed);
+    source->setHistoryDuration(end > start ? end - start : 7200);
+    // Keep every sample so the replay shows the logged rate.
+    source->setHighResolutionDuration(end > start ? end - start : 7200);
+    source->setColor(m_color.lighter());
+    connect(replay, &TelemetryReplay::location, source, &NavSource::updateLocation);
+    connect(replay, &TelemetryReplay::finished, replay, &QObject::deleteLater);
+    m_replay_sources[nav.first] = source;
+    replay->start();
+  }
+}
 
 void Platform::updateProjectedPoints()
 {
@@ -175,8 +292,12 @@ void Platform::updateProjectedPoints()
   setPos(0,0);
   for(auto ns: m_nav_sources)
     ns.second->updateProjectedPoints();
-  m_ui->geovizDisplay->updateProjectedPoints();
-
+  m_shape_dirty = true;
+  for(auto ns: m_replay_sources)
+    ns.second->updateProjectedPoints();
+  m_geoviz_display->updateProjectedPoints();
+  if(m_fleet)
+    m_fleet->platformChanged();
 }
 
 void Platform::hoverEnterEvent(QGraphicsSceneHoverEvent* event)
@@ -202,46 +323,77 @@ void Platform::updateLabel()
 void Platform::aboutToUpdateNav()
 {
   prepareGeometryChange();
+  if(m_fleet)
+    m_fleet->platformChanged();
+  // After the above, which may still need the old shape.
+  m_shape_dirty = true;
 }
 
 void Platform::updateSog(double sog)
 {
   // 1852m per NM
   m_sog = sog*1.9438;
-  m_sog_history.append(m_sog);
-  if(m_sog_history.length() > 200)
-      m_sog_history.pop_front();
-  qreal sog_sum = 0;
-  for(auto s: m_sog_history)
-      sog_sum += s;
-  m_sog_avg = sog_sum/m_sog_history.length();
-  QString sogLabel = "SOG: " + QString::number(m_sog,'f',1) + ", avg: " + QString::number(m_sog_avg,'f',1) + " (200 samples)";
-  m_ui->sogLineEdit->setText(sogLabel);
+  m_sog_statistics.add(ros::Time::now().toSec(), m_sog);
+  updateTelemetryLabel();
+}
+
+void Platform::updateCog(double cog)
+{
+  m_cog = cog;
+  m_cog_statistics.add(ros::Time::now().toSec(), cog);
+  updateTelemetryLabel();
 }
 
-MissionManager* Platform::missionManager() const
+void Platform::updateTelemetryLabel()
 {
+  QString label = "SOG: " + QString::number(m_sog,'f',1) + ", avg: " + QString::number(m_sog_statistics.mean(),'f',1) + " max: " + QString::number(m_sog_statistics.maximum(),'f',1);
+  if(!m_cog_statistics.empty())
+    label += " COG: " + QString::number(m_cog,'f',0) + ", avg: " + QString::number(m_cog_statistics.mean(),'f',0);
+  if(!m_position_latency.empty())
+    label += " Latency: " + QString::number(m_position_latency.mean(),'f',2) + "s";
+  label += " (60s)";
+  if(m_ui)
+    m_ui->sogLineEdit->setText(label);
+}
+
+MissionManager* Platform::missionManager()
+{
+  createWidgets();
   return m_ui->missionManager;
 }
 
-HelmManager* Platform::helmManager() const
+HelmManager* Platform::helmManager()
 {
+  createWidgets();
   return m_ui->helmManager;
 }
 
 void Platform::updatePosition(QGeoCoordinate position)
 {
-  emit platformPosition(this, position);
+  auto nav = qobject_cast<NavSource*>(sender());
+  if(nav)
+  {
+    double now = ros::Time::now().toSec();
+    m_position_latency.add(now, now - nav->location().time);
   }
+  emit platformPosition(this, position);
+}
 
 void Platform::setColor(QColor color)
 {
   m_color = color;
-  QColor dim;
-  dim.setRedF(color.redF()*.8);
-  dim.setGreenF(color.greenF()*.8);
-  dim.setBlueF(color.blueF()*.8);
-  dim.setAlphaF(color.alphaF()*.8);
   for(auto nav: m_nav_sources)
-    nav.second->setColor(dim);
+    nav.second->setColor(trackColor());
+  if(m_fleet)
+    m_fleet->platformChanged();
+}
+
+QColor Platform::trackColor() const
+{
+  QColor dim;
+  dim.setRedF(m_color.redF()*.8);
+  dim.setGreenF(m_color.greenF()*.8);
+  dim.setBlueF(m_color.blueF()*.8);
+  dim.setAlphaF(m_color.alphaF()*.8);
+  return dim;
 }
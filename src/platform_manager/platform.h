@@ -5,6 +5,7 @@
 #include "ship_track.h"
 #include "ros/ros.h"
 #include "project11_msgs/PlatformList.h"
+#include "rolling_statistics.h"
 
 namespace Ui
 {
@@ -14,6 +15,8 @@ namespace Ui
 class NavSource;
 class MissionManager;
 class HelmManager;
+class FleetItem;
+class GeovizDisplay;
 
 class Platform : public QWidget, public ShipTrack
 {
@@ -31,8 +34,28 @@ public:
   void update(project11_msgs::Platform &platform);
   void update(std::pair<const std::string, XmlRpc::XmlRpcValue> &platform);
 
-  MissionManager* missionManager() const;
-  HelmManager* helmManager() const;
+  /// Creates the widgets if they don't exist yet.
+  MissionManager* missionManager();
+  HelmManager* helmManager();
+
+  /// The helm and mission widgets, with their subscriptions, are only
+  /// created once the platform is selected. The geoviz display draws on
+  /// the map so it is always created, only joining the panel then.
+  bool hasWidgets() const;
+  void createWidgets();
+
+  /// Takes ownership and shows the source with this platform's colors.
+  void addNavSource(NavSource* nav_source);
+  const std::map<std::string, NavSource*>& navSources() const;
+
+  QColor color() const;
+
+  /// Latest speed in m/s and course in degrees, the course NaN if unknown.
+  qreal sog() const;
+  qreal cog() const;
+
+  /// When set, the fleet draws this platform and its tracks instead.
+  void setFleet(FleetItem* fleet);
 
 signals:
   void platformPosition(Platform* platform, QGeoCoordinate position);
@@ -42,25 +65,43 @@ public slots:
   void updateProjectedPoints();
   void aboutToUpdateNav();
   void updateSog(double sog);
+  void updateCog(double cog);
   void updatePosition(QGeoCoordinate position);
 
+  /// Plays back logged positions of each nav source between start and end,
+  /// in seconds since 1970, at speed times real time.
+  void replayTelemetry(double start, double end, double speed);
+
 protected:
   void hoverEnterEvent(QGraphicsSceneHoverEvent * event) override;
   void hoverLeaveEvent(QGraphicsSceneHoverEvent * event) override;
 
 private:
   void updateLabel();
+  void updateTelemetryLabel();
   void setColor(QColor color);
+  QColor trackColor() const;
+  void setRobotNamespace(QString robot_namespace);
+  QString telemetryLogPath(const std::string& nav_source) const;
 
-  Ui::Platform* m_ui;
-
+  Ui::Platform* m_ui = nullptr;
+  GeovizDisplay* m_geoviz_display = nullptr;
+  QString m_robot_namespace;
+  FleetItem* m_fleet = nullptr;
 
   std::map<std::string, NavSource*> m_nav_sources;
+  // Tracks of the last replayTelemetry, kept until the next one.
+  std::map<std::string, NavSource*> m_replay_sources;
 
   ros::Subscriber m_sog_subscriber;
-  QList<qreal> m_sog_history;
-  qreal m_sog;
-  qreal m_sog_avg;
+  qreal m_sog = 0.0;
+  qreal m_cog = std::nan("");
+
+  // Over the last 60 seconds.
+  RollingStatistics m_sog_statistics;
+  RollingAngleStatistics m_cog_statistics;
+  // Seconds between a position's stamp and its arrival.
+  RollingStatistics m_position_latency;
 
   float m_width = 0.0;
   float m_length = 0.0;
@@ -69,6 +110,12 @@ private:
 
   QColor m_color = QColor(0,0,255,255);
 
+  // Symbol for the background and scale it was built at.
+  mutable QPainterPath m_shape;
+  mutable bool m_shape_dirty = true;
+  mutable BackgroundRaster* m_shape_background = nullptr;
+  mutable qreal m_shape_pixel_size = 0.0;
+
 };
 
 #endif // PLATFORM_H
@@ -0,0 +1,59 @@
+#include "platform_list_model.h"
+#include "platform.h"
+#include <algorithm>
+
+PlatformListModel::PlatformListModel(QObject* parent): QAbstractListModel(parent)
+{
+}
+
+int PlatformListModel::rowCount(const QModelIndex& parent) const
+{
+  if(parent.isValid())
+    return 0;
+  return platforms_.size();
+}
+
+QVariant PlatformListModel::data(const QModelIndex& index, int role) const
+{
+  auto p = platform(index);
+  if(!p)
+    return QVariant();
+  switch(role)
+  {
+    case Qt::DisplayRole:
+      return p->objectName();
+    case Qt::DecorationRole:
+      return p->color();
+    default:
+      return QVariant();
+  }
+}
+
+void PlatformListModel::addPlatform(Platform* platform)
+{
+  beginInsertRows(QModelIndex(), platforms_.size(), platforms_.size());
+  platforms_.push_back(platform);
+  endInsertRows();
+}
+
+Platform* PlatformListModel::platform(const QModelIndex& index) const
+{
+  if(!index.isValid() || index.row() < 0 || index.row() >= int(platforms_.size()))
+    return nullptr;
+  return platforms_[index.row()];
+}
+
+QModelIndex PlatformListModel::indexOf(Platform* platform) const
+{
+  auto i = std::find(platforms_.begin(), platforms_.end(), platform);
+  if(i == platforms_.end())
+    return QModelIndex();
+  return index(i - platforms_.begin());
+}
+
+void PlatformListModel::platformUpdated(Platform* platform)
+{
+  auto i = indexOf(platform);
+  if(i.isValid())
+    emit dataChanged(i, i);
+}
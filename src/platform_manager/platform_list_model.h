@@ -0,0 +1,31 @@
+#ifndef CAMP_PLATFORM_LIST_MODEL_H
+#define CAMP_PLATFORM_LIST_MODEL_H
+
+#include <QAbstractListModel>
+#include <vector>
+
+class Platform;
+
+// Lists the platforms by name and color for the fleet panel. Views only
+// query the visible rows, so the list stays cheap with large fleets.
+class PlatformListModel: public QAbstractListModel
+{
+  Q_OBJECT
+public:
+  explicit PlatformListModel(QObject* parent = nullptr);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+  void addPlatform(Platform* platform);
+  Platform* platform(const QModelIndex& index) const;
+  QModelIndex indexOf(Platform* platform) const;
+
+  // Refreshes the platform's row after its name or color changed.
+  void platformUpdated(Platform* platform);
+
+private:
+  std::vector<Platform*> platforms_;
+};
+
+#endif
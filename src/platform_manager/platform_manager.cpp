@@ -2,12 +2,18 @@
 #include "ui_platform_manager.h"
 #include "platform.h"
 #include "backgroundraster.h"
+#include "fleet_item.h"
+#include "platform_list_model.h"
 
 PlatformManager::PlatformManager(QWidget* parent):
   QWidget(parent),
   m_ui(new Ui::PlatformManager)
 {
   m_ui->setupUi(this);
+  m_model = new PlatformListModel(this);
+  m_ui->platformListView->setModel(m_model);
+  connect(m_ui->platformListView->selectionModel(), &QItemSelectionModel::currentChanged, this, &PlatformManager::selectPlatform);
+  m_fleet = new FleetItem(m_background);
   ros::NodeHandle nh;
   m_platform_list_sub = nh.subscribe("/project11/platforms", 5, &PlatformManager::platformListCallback, this);
   
@@ -24,16 +30,28 @@ void PlatformManager::loadFromParameters()
     {
       for(auto platform:platforms_dict)
       {
-        m_platforms[platform.first] = new Platform(this, m_background);
-        m_ui->tabWidget->addTab(m_platforms[platform.first], platform.first.c_str());
-        m_platforms[platform.first]->update(platform);
-        connect(m_platforms[platform.first], &Platform::platformPosition, this, &PlatformManager::platformPosition);
+        auto p = addPlatform(platform.first);
+        p->update(platform);
+        m_model->platformUpdated(p);
       }
     }
   }
-  if(m_ui->tabWidget->count()>0)
-    on_tabWidget_currentChanged(0);
+  if(!m_current_platform && m_model->rowCount() > 0)
+    m_ui->platformListView->setCurrentIndex(m_model->index(0));
+}
 
+Platform* PlatformManager::addPlatform(const std::string& name)
+{
+  // Only the selected platform's widgets are created and shown, in the
+  // stack.
+  auto platform = new Platform(this, m_background);
+  platform->hide();
+  platform->setObjectName(name.c_str());
+  m_platforms[name] = platform;
+  m_model->addPlatform(platform);
+  m_fleet->addPlatform(platform);
+  connect(platform, &Platform::platformPosition, this, &PlatformManager::platformPosition);
+  return platform;
 }
 
 PlatformManager::~PlatformManager()
@@ -52,16 +70,18 @@ void PlatformManager::platformListCallback(const project11_msgs::PlatformList::C
 void PlatformManager::updatePlatform(project11_msgs::Platform platform)
 {
   if(m_platforms.find(platform.name) == m_platforms.end())
-  {
-    m_platforms[platform.name] = new Platform(this, m_background);
-    m_ui->tabWidget->addTab(m_platforms[platform.name], platform.name.c_str());
-  }
-  m_platforms[platform.name]->update(platform);
+    addPlatform(platform.name);
+  auto p = m_platforms[platform.name];
+  p->update(platform);
+  m_model->platformUpdated(p);
+  if(!m_current_platform)
+    m_ui->platformListView->setCurrentIndex(m_model->indexOf(p));
 }
 
 void PlatformManager::updateBackground(BackgroundRaster * bg)
 {
   m_background = bg;
+  m_fleet->setParentItem(bg);
   for(auto p: m_platforms)
   {
     p.second->setParentItem(bg);
@@ -69,17 +89,25 @@ void PlatformManager::updateBackground(BackgroundRaster * bg)
   }
 }
 
-void PlatformManager::on_tabWidget_currentChanged(int index)
+void PlatformManager::selectPlatform(const QModelIndex& index)
 {
-  if(index == -1)
-    emit currentPlatform(nullptr);
-  else
-    emit currentPlatform(qobject_cast<Platform*>(m_ui->tabWidget->currentWidget()));
+  m_current_platform = m_model->platform(index);
+  if(m_current_platform)
+  {
+    m_current_platform->createWidgets();
+    if(m_ui->platformStack->indexOf(m_current_platform) == -1)
+      m_ui->platformStack->addWidget(m_current_platform);
+    m_ui->platformStack->setCurrentWidget(m_current_platform);
+  }
+  emit currentPlatform(m_current_platform);
 }
 
 void PlatformManager::platformPosition(Platform * platform, QGeoCoordinate position)
 {
-  if(m_ui->tabWidget->currentWidget() == platform)
+  if(m_current_platform == platform)
+  {
     emit currentPlatformPosition(position);
+    emit currentPlatformMotion(position, platform->sog(), platform->cog());
+  }
 }
   
\ No newline at end of file
@@ -15,6 +15,8 @@ namespace Ui
 
 class Platform;
 class BackgroundRaster;
+class FleetItem;
+class PlatformListModel;
 
 class PlatformManager: public QWidget
 {
@@ -26,6 +28,8 @@ public:
 signals:
   void currentPlatform(Platform* platform);
   void currentPlatformPosition(QGeoCoordinate position);
+  // With the platform's speed in m/s and course in degrees.
+  void currentPlatformMotion(QGeoCoordinate position, double sog, double cog);
 
 public slots:
   void updateBackground(BackgroundRaster * bg);
@@ -34,16 +38,22 @@ public slots:
   
 private slots:
   void updatePlatform(project11_msgs::Platform platform);
-  void on_tabWidget_currentChanged(int index);
+  void selectPlatform(const QModelIndex& index);
 
 private:
   void platformListCallback(const project11_msgs::PlatformList::ConstPtr &message);
+  Platform* addPlatform(const std::string& name);
 
 
   Ui::PlatformManager* m_ui;
   ros::Subscriber m_platform_list_sub;
 
   std::map<std::string, Platform*> m_platforms;
+  PlatformListModel* m_model;
+  Platform* m_current_platform = nullptr;
+
+  // Draws all the platforms.
+  FleetItem* m_fleet;
 
   BackgroundRaster* m_background = nullptr;
 };
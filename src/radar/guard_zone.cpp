@@ -0,0 +1,125 @@
+#include "guard_zone.h"
+#include <cmath>
+
+namespace
+{
+
+// Relative bearing, clockwise from the bow in [0, 2pi), of a radar frame
+// angle which is counterclockwise from the bow.
+double relativeBearing(double angle)
+{
+  double bearing = std::fmod(-angle, 2.0*M_PI);
+  if(bearing < 0.0)
+    bearing += 2.0*M_PI;
+  return bearing;
+}
+
+bool bearingInZone(double bearing, const GuardZone& zone)
+{
+  double width = std::fmod(zone.bearing_end - zone.bearing_start, 2.0*M_PI);
+  // Equal start and end is a full circle, as drawn by the tools display.
+  if(width <= 0.0)
+    width += 2.0*M_PI;
+  double offset = std::fmod(bearing - zone.bearing_start, 2.0*M_PI);
+  if(offset < 0.0)
+    offset += 2.0*M_PI;
+  return offset <= width;
+}
+
+} // namespace
+
+void GuardZoneMonitor::setZones(const std::vector<GuardZone>& zones)
+{
+  QMutexLocker lock(&m_mutex);
+  m_zones.clear();
+  for(const auto& z: zones)
+  {
+    ZoneState state;
+    state.zone = z;
+    m_zones.push_back(state);
+  }
+  // Forces the masks to be rebuilt with the next spoke.
+  m_bin_count = 0;
+}
+
+std::vector<GuardZone> GuardZoneMonitor::zones() const
+{
+  QMutexLocker lock(&m_mutex);
+  std::vector<GuardZone> ret;
+  for(const auto& z: m_zones)
+    ret.push_back(z.zone);
+  return ret;
+}
+
+void GuardZoneMonitor::updateGeometry(int bin_count, int samples, double range_max)
+{
+  if(bin_count == m_bin_count && samples == m_samples && range_max == m_range_max)
+    return;
+  m_bin_count = bin_count;
+  m_samples = samples;
+  m_range_max = range_max;
+
+  double sample_size = range_max/samples;
+  for(auto& z: m_zones)
+  {
+    z.bins.assign(bin_count, false);
+    z.bin_energy.assign(bin_count, 0.0);
+    z.energy = 0.0;
+    for(int i = 0; i < bin_count; i++)
+      z.bins[i] = bearingInZone((i+0.5)*2.0*M_PI/bin_count, z.zone);
+    // samples are centered in their cell
+    z.sample_begin = std::max(0, int(std::ceil(z.zone.range_min/sample_size - 0.5)));
+    z.sample_end = std::min(samples, int(std::floor(z.zone.range_max/sample_size - 0.5)) + 1);
+  }
+}
+
+std::vector<GuardZoneEvent> GuardZoneMonitor::update(const marine_sensor_msgs::RadarSector& sector)
+{
+  std::vector<GuardZoneEvent> ret;
+  if(sector.intensities.empty() || sector.angle_increment == 0.0 || sector.range_max <= 0.0)
+    return ret;
+  int samples = sector.intensities.front().echoes.size();
+  if(samples == 0)
+    return ret;
+
+  QMutexLocker lock(&m_mutex);
+  if(m_zones.empty())
+    return ret;
+
+  int bin_count = std::max(1, int(std::round(2.0*M_PI/std::abs(sector.angle_increment))));
+  updateGeometry(bin_count, samples, sector.range_max);
+
+  for(int i = 0; i < sector.intensities.size(); i++)
+  {
+    double bearing = relativeBearing(sector.angle_start + i*sector.angle_increment);
+    int bin = std::min(bin_count-1, int(bearing*bin_count/(2.0*M_PI)));
+    const auto& echoes = sector.intensities[i].echoes;
+    for(auto& z: m_zones)
+    {
+      if(!z.bins[bin])
+        continue;
+      float energy = 0.0;
+      int end = std::min<int>(z.sample_end, echoes.size());
+      for(int j = z.sample_begin; j < end; j++)
+        energy += echoes[j];
+      z.energy += energy - z.bin_energy[bin];
+      z.bin_energy[bin] = energy;
+    }
+  }
+
+  for(int i = 0; i < m_zones.size(); i++)
+  {
+    auto& z = m_zones[i];
+    bool active = z.active;
+    if(!z.active && z.energy > z.zone.threshold)
+      active = true;
+    else if(z.active && z.energy < z.zone.threshold*m_hysteresis)
+      active = false;
+    if(active != z.active)
+    {
+      z.active = active;
+      ret.push_back({i, active, z.energy});
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,85 @@
+#ifndef CAMP_GUARD_ZONE_H
+#define CAMP_GUARD_ZONE_H
+
+#include <QMutex>
+#include <vector>
+#include "marine_sensor_msgs/RadarSector.h"
+
+// Area around the radar watched for echoes.
+struct GuardZone
+{
+  // Radians, relative bearing clockwise from the bow. The zone goes
+  // clockwise from start to end, so it may straddle the bow. Equal start
+  // and end make a full circle.
+  double bearing_start = 0.0;
+  double bearing_end = 0.0;
+
+  // Meters.
+  double range_min = 0.0;
+  double range_max = 0.0;
+
+  // Alarm when the summed intensity of the zone's cells over the last
+  // rotation exceeds this.
+  float threshold = 10.0;
+};
+
+// Alarm state change of a zone.
+struct GuardZoneEvent
+{
+  int zone;
+  bool active;
+  double energy;
+};
+
+// Checks guard zones against raw spokes as they arrive, so it works whether
+// or not the radar is being drawn.
+//
+// Spokes are binned by bearing. Each zone keeps a precomputed mask of the
+// bins it covers along with the range of samples it covers, rebuilt only
+// when the spoke geometry changes, and the energy seen in each bin during
+// the last rotation. A spoke replaces its bin's previous contribution to the
+// running total, so the cost per spoke is a sum over the zone's samples.
+// Thread safe.
+class GuardZoneMonitor
+{
+public:
+  void setZones(const std::vector<GuardZone>& zones);
+  std::vector<GuardZone> zones() const;
+
+  // Returns the zones whose alarm state changed.
+  std::vector<GuardZoneEvent> update(const marine_sensor_msgs::RadarSector& sector);
+
+private:
+  struct ZoneState
+  {
+    GuardZone zone;
+
+    // One entry per bearing bin.
+    std::vector<bool> bins;
+    std::vector<float> bin_energy;
+    double energy = 0.0;
+
+    int sample_begin = 0;
+    int sample_end = 0;
+
+    bool active = false;
+  };
+
+  // Called with m_mutex held.
+  void updateGeometry(int bin_count, int samples, double range_max);
+
+  std::vector<ZoneState> m_zones;
+
+  // Geometry the masks were built for.
+  int m_bin_count = 0;
+  int m_samples = 0;
+  double m_range_max = 0.0;
+
+  // Fraction of the threshold the energy must drop below to clear an alarm,
+  // so it does not chatter around the threshold.
+  double m_hysteresis = 0.8;
+
+  mutable QMutex m_mutex;
+};
+
+#endif
@@ -7,43 +7,128 @@
 #include <QPainter>
 #include <QOpenGLFramebufferObject>
 #include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
 #include <tf2/utils.h>
 #include "gz4d_geo.h"
 #include <tf2_ros/transform_listener.h>
-#include <yaml-cpp/yaml.h>
+#include "radar_targets_display.h"
+#include "radar_tools_display.h"
+#include "colormap/colormap.h"
+
+#ifndef GL_MAX
+#define GL_MAX 0x8008
+#endif
 
 
 RadarDisplay::RadarDisplay(QObject* parent, QGraphicsItem *parentItem): QObject(parent), GeoGraphicsItem(parentItem)
 {
+  m_targets_display = new RadarTargetsDisplay(this);
+  m_targets_display->setVisible(false);
+  m_targets_timer = new QTimer(this);
+  connect(m_targets_timer, &QTimer::timeout, this, &RadarDisplay::updateTargets);
+  m_targets_timer->start(200);
+
+  m_tools_display = new RadarToolsDisplay(this);
+  connect(this, &RadarDisplay::guardZoneAlarm, this, [this](QString topic, int zone, bool active)
+  {
+    m_tools_display->setGuardZoneActive(topic, zone, active);
+  });
+
   m_radarImageThread = QThread::create(std::bind(&RadarDisplay::updateRadarImage, this));
   m_radarImageThread->start();
 }
 
+RadarDisplay::~RadarDisplay()
+{
+  // GL resources are freed by the render thread, which owns the context.
+  m_radarImageThread->requestInterruption();
+  m_radarImageThread->wait();
+  delete m_radarImageThread;
+}
+
 void RadarDisplay::setTF2Buffer(tf2_ros::Buffer* buffer)
 {
     m_tf_buffer = buffer;
+    m_transforms.setTF2Buffer(buffer);
 }
 
 void RadarDisplay::setMapFrame(std::string mapFrame)
 {
-    m_mapFrame = mapFrame;
+    m_transforms.setMapFrame(mapFrame);
 }
 
 void RadarDisplay::setPixelSize(double s)
 {
     m_pixel_size = s;
+    m_targets_display->setPixelSize(s);
+    m_tools_display->setPixelSize(s);
     //ROS_INFO_STREAM("Pixel size: " << s);
 }
 
-void RadarDisplay::subscribe(QString topic)
+void RadarDisplay::addSource(QString topic)
 {
+    if(source(topic))
+        return;
     if(!m_spinner)
     {
-        m_spinner = std::shared_ptr<ros::AsyncSpinner>(new ros::AsyncSpinner(1, &m_ros_queue));
+        m_spinner = std::shared_ptr<ros::AsyncSpinner>(new ros::AsyncSpinner(2, &m_ros_queue));
         m_spinner->start();
     }
-    ros::SubscribeOptions ops = ros::SubscribeOptions::create<marine_sensor_msgs::RadarSector>(topic.toStdString(), 300, boost::bind(&RadarDisplay::radarCallback, this, _1), ros::VoidPtr(), &m_ros_queue);
-    m_subscriber = ros::NodeHandle().subscribe(ops);
+    auto source = std::make_shared<Source>();
+    source->topic = topic.toStdString();
+    source->guard_zones.setZones(m_tools_display->tools().guard_zones);
+    ros::SubscribeOptions ops = ros::SubscribeOptions::create<marine_sensor_msgs::RadarSector>(source->topic, 300, boost::bind(&RadarDisplay::radarCallback, this, source.get(), _1), ros::VoidPtr(), &m_ros_queue);
+    source->subscriber = ros::NodeHandle().subscribe(ops);
+
+    QMutexLocker lock(&m_sources_mutex);
+    m_sources.push_back(source);
+}
+
+std::vector<std::shared_ptr<RadarDisplay::Source> > RadarDisplay::sources() const
+{
+    QMutexLocker lock(&m_sources_mutex);
+    return m_sources;
+}
+
+std::shared_ptr<RadarDisplay::Source> RadarDisplay::source(const QString& topic) const
+{
+    QMutexLocker lock(&m_sources_mutex);
+    for(auto s: m_sources)
+        if(s->topic == topic.toStdString())
+            return s;
+    return {};
+}
+
+RadarSourceSettings RadarDisplay::sourceSettings(QString topic) const
+{
+    auto s = source(topic);
+    if(!s)
+        return {};
+    QMutexLocker lock(&s->mutex);
+    return s->settings;
+}
+
+void RadarDisplay::setSourceSettings(QString topic, const RadarSourceSettings& settings)
+{
+    auto s = source(topic);
+    if(s)
+    {
+        QMutexLocker lock(&s->mutex);
+        s->settings = settings;
+    }
+}
+
+void RadarDisplay::setTools(const RadarTools& tools)
+{
+    m_tools_display->setTools(tools);
+    for(auto s: sources())
+        s->guard_zones.setZones(tools.guard_zones);
+}
+
+const RadarTools& RadarDisplay::tools() const
+{
+    return m_tools_display->tools();
 }
 
 void RadarDisplay::initializeGL()
@@ -120,7 +205,10 @@ void RadarDisplay::initializeGL()
         "uniform float minAngle;\n"
         "uniform float maxAngle;\n"
         "uniform float fade;\n"
+        "uniform float gain;\n"
         "uniform vec4 color;\n"
+        "uniform sampler2D palette;\n"
+        "uniform bool usePalette;\n"
         "void main(void)\n"
         "{\n"
         "    if(texc.x == 0.0) discard;\n"
@@ -131,8 +219,12 @@ void RadarDisplay::initializeGL()
         "    if(theta < minAngle) discard;\n"
         "    if(theta > maxAngle) discard;\n"
         "    vec4 radarData = texture2D(texture, vec2(r, (theta-minAngle)/(maxAngle-minAngle)));\n"
-        "    if(radarData.r < 0.01) discard;\n"
-        "    gl_FragColor = color*fade*radarData.r;\n"
+        "    float intensity = min(radarData.r*gain, 1.0);\n"
+        "    if(intensity < 0.01) discard;\n"
+        "    if(usePalette)\n"
+        "        gl_FragColor = texture2D(palette, vec2(intensity, 0.5))*fade;\n"
+        "    else\n"
+        "        gl_FragColor = color*fade*intensity;\n"
         "    //gl_FragColor.a = radarData.r*fade;\n"
         "}\n";
     fshader->compileSourceCode(fsrc);
@@ -145,10 +237,45 @@ void RadarDisplay::initializeGL()
 
     m_program->bind();
     m_program->setUniformValue("texture", 0);
+    m_program->setUniformValue("palette", 1);
 
     m_opengl_initialized = true;
 }
 
+QOpenGLTexture* RadarDisplay::paletteTexture(colormap::Palette palette)
+{
+    auto& texture = m_palette_textures[int(palette)];
+    if(!texture)
+    {
+        // Premultiplied so fading and additive blending work as with the
+        // source color.
+        QImage image(256, 1, QImage::Format_ARGB32_Premultiplied);
+        const auto& colors = colormap::paletteColors(palette);
+        for(int i = 0; i < 256; i++)
+        {
+            // the low end fades out like the single color ramp
+            QColor c(colors[i]);
+            c.setAlpha(qAlpha(colors[i])*i/255);
+            image.setPixelColor(i, 0, c);
+        }
+        texture = new QOpenGLTexture(image);
+        texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+    }
+    return texture;
+}
+
+void RadarDisplay::releaseGL()
+{
+    if(!m_opengl_initialized)
+      return;
+    m_context->makeCurrent(m_surface);
+    for(auto texture: m_palette_textures)
+      delete texture.second;
+    m_palette_textures.clear();
+    m_context->doneCurrent();
+}
+
 QRectF RadarDisplay::boundingRect() const
 {
   if (m_range > 0);
@@ -161,13 +288,13 @@ QRectF RadarDisplay::boundingRect() const
 
 void RadarDisplay::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
-    if(m_show_radar && !m_sectors.empty())
+    double r;
+    {
+      QMutexLocker lock(&m_range_mutex);
+      r = m_range;
+    }
+    if(m_show_radar && r > 0.0)
     {
-        double r;
-        {
-          QMutexLocker lock(&m_range_mutex);
-          r = m_range;
-        }
         r /= m_pixel_size;
         QPen p;
         p.setColor(Qt::green);
@@ -191,9 +318,36 @@ void RadarDisplay::sectorAdded()
     update();
 }
 
-void RadarDisplay::radarCallback(const marine_sensor_msgs::RadarSector::ConstPtr &message)
+void RadarDisplay::radarCallback(Source* source, const marine_sensor_msgs::RadarSector::ConstPtr &message)
 {
   ROS_DEBUG_STREAM("now: " << ros::Time::now() << " Radar timestamp: " << message->header.stamp);
+  for(const auto& event: source->guard_zones.update(*message))
+  {
+    if(event.active)
+      ROS_WARN_STREAM("Guard zone " << event.zone << " alarm on " << source->topic << ", energy: " << event.energy);
+    emit guardZoneAlarm(source->topic.c_str(), event.zone, event.active);
+  }
+  {
+    // Lets the overlays be positioned even if the radar is never drawn.
+    QMutexLocker lock(&m_radar_frame_mutex);
+    if(m_radar_frame.empty())
+      m_radar_frame = message->header.frame_id;
+  }
+  if (m_show_targets && !message->intensities.empty())
+  {
+    RadarPolarSector sector;
+    sector.stamp = message->header.stamp;
+    sector.frame_id = message->header.frame_id;
+    sector.angle_start = message->angle_start;
+    sector.angle_increment = message->angle_increment;
+    sector.range_max = message->range_max;
+    sector.spokes = message->intensities.size();
+    sector.samples = message->intensities.front().echoes.size();
+    sector.intensities.resize(sector.spokes*sector.samples, 0.0);
+    for(int i = 0; i < sector.spokes; i++)
+      std::copy_n(message->intensities[i].echoes.begin(), std::min<int>(sector.samples, message->intensities[i].echoes.size()), sector.intensities.begin()+i*sector.samples);
+    queueDetection(std::move(sector));
+  }
   if (m_show_radar && !message->intensities.empty())
   {
     double angle1 = message->angle_start;
@@ -219,9 +373,9 @@ void RadarDisplay::radarCallback(const marine_sensor_msgs::RadarSector::ConstPtr
     s.timestamp = message->header.stamp;
     s.frame_id = message->header.frame_id.c_str();
     //ROS_INFO_STREAM("angles: " << s.angle1 << " - " << s.angle2 << " range: " << range << " half angle: " << s.half_scanline_angle);
-    QMutexLocker lock(&m_new_sectors_mutex);
-    m_new_sectors.push_back(s);
-    m_radar_frame = s.frame_id.toStdString();
+    QMutexLocker lock(&source->mutex);
+    source->new_sectors.push_back(s);
+    source->frame_id = s.frame_id.toStdString();
   }
 }
 
@@ -231,7 +385,10 @@ void RadarDisplay::updateRadarImage()
   while(true)
   {
     if ( QThread::currentThread()->isInterruptionRequested() )
+    {
+      releaseGL();
       return;
+    }
 
     if(!m_opengl_initialized)
       initializeGL();
@@ -240,122 +397,151 @@ void RadarDisplay::updateRadarImage()
     m_fbo->bind();
     glClear(GL_COLOR_BUFFER_BIT);
 
-    QMatrix4x4 matrix;
-    matrix.ortho(-1, 1, -1, 1, 4.0f, 15.0f);
-    matrix.translate(0.0f, 0.0f, -10.0f);
+    QMatrix4x4 map_matrix;
+    map_matrix.ortho(-1, 1, -1, 1, 4.0f, 15.0f);
+    map_matrix.translate(0.0f, 0.0f, -10.0f);
     
     glViewport(0,0,2048,2048);
     
-    m_program->setUniformValue("matrix", matrix);
     m_program->enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
     m_program->setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
 
     ros::Time now = ros::Time::now();
     float persistance = 3.0;
+
+    auto current_sources = sources();
+    std::vector<RadarSourceSettings> settings;
+    for(auto source: current_sources)
     {
-      QMutexLocker lock(&m_new_sectors_mutex);
-      while(!m_new_sectors.empty())
-      {
-        m_sectors.push_back(m_new_sectors.front());
-        m_new_sectors.pop_front();
-      }
-    }
-    while(!m_sectors.empty() && m_sectors.front().timestamp + ros::Duration(persistance) < now)
-    {
-      if(m_sectors.front().sectorImage)
-        delete m_sectors.front().sectorImage;
-      if(m_sectors.front().sectorTexture)
-        delete m_sectors.front().sectorTexture;
-      m_sectors.pop_front();
-    }
-    {
-      QMutexLocker range_lock(&m_range_mutex);
-      if(m_sectors.empty())
-        m_range = 0.0;
-      else
-        m_range = m_sectors.back().range;
-    }
-    for(Sector &s: m_sectors)
-    {
-      if(s.sectorImage && !s.rendered)
       {
-        float fade = 1.0-((now-s.timestamp).toSec()/persistance);
-        if(!s.sectorTexture)
+        QMutexLocker lock(&source->mutex);
+        while(!source->new_sectors.empty())
         {
-          s.sectorTexture = new QOpenGLTexture(*s.sectorImage);
+          source->sectors.push_back(source->new_sectors.front());
+          source->new_sectors.pop_front();
         }
+        settings.push_back(source->settings);
+      }
+      auto& sectors = source->sectors;
+      while(!sectors.empty() && sectors.front().timestamp + ros::Duration(persistance) < now)
+      {
+        if(sectors.front().sectorImage)
+          delete sectors.front().sectorImage;
+        if(sectors.front().sectorTexture)
+          delete sectors.front().sectorTexture;
+        sectors.pop_front();
+      }
+      for(Sector &s: sectors)
         if(!s.have_yaw)
         {
-          // std::cerr << "tf buffer? " << m_tf_buffer << std::endl;
-          // std::cerr << "map frame: " << m_mapFrame << " timestamp: " << s.timestamp << " frame_id: " << s.frame_id.toStdString();
-          // if(m_tf_buffer && !m_mapFrame.empty())
-          //    std::cerr << " can transform? " << m_tf_buffer->canTransform(m_mapFrame, s.frame_id.toStdString(), s.timestamp, ros::Duration(1.0)) << std::endl;
-          // std::cerr << std::endl;
-          if(m_mapFrame.empty())
+          // Served from the pose history when possible, so sectors sharing
+          // a stamp only cost one TF query between them.
+          RadarPose pose;
+          if(m_transforms.lookup(s.frame_id.toStdString(), s.timestamp, pose))
           {
-            if(m_tf_buffer)
-            {
-              std::map<std::string, std::string> parents;
-              auto frames = YAML::Load(m_tf_buffer->allFramesAsYAML());
-              for(auto f: frames)
-                parents[f.first.as<std::string>()] = f.second["parent"].as<std::string>();
-              for(auto p:parents)
-                ROS_INFO_STREAM(p.first << " child of " << p.second);
-              auto cursor = parents.find(s.frame_id.toStdString());
-              while(cursor != parents.end())
-              {
-                QString parent = cursor->second.c_str();
-                if(parent.endsWith("/map"))
-                {
-                  m_mapFrame = cursor->second;
-                  break;
-                }
-                cursor = parents.find(cursor->second);
-              }
-            }
+            double yaw = pose.yaw;
+            while (yaw < 0.0)
+                yaw += (2.0*M_PI);
+            s.yaw = yaw;
+            s.position = pose.position;
+            s.angle1 = std::fmod(s.angle1+yaw,M_PI*2);
+            if(s.angle1 < 0)
+              s.angle1 += M_PI*2;
+            s.angle2 = std::fmod(s.angle2+yaw,M_PI*2);
+            if(s.angle2 < 0)
+              s.angle2 += M_PI*2;
+
+            s.have_yaw = true;
           }
-          ros::Time now = ros::Time::now();
-          if(m_tf_buffer && !m_mapFrame.empty())
-              try
-              {
-                  geometry_msgs::TransformStamped t = m_tf_buffer->lookupTransform(m_mapFrame, s.frame_id.toStdString(), s.timestamp, ros::Duration(1.0));
-                  double yaw = tf2::getYaw(t.transform.rotation);
-                  while (yaw < 0.0)
-                      yaw += (2.0*M_PI);
-                  s.yaw = yaw;
-                  s.angle1 = std::fmod(s.angle1+yaw,M_PI*2);
-                  if(s.angle1 < 0)
-                    s.angle1 += M_PI*2;
-                  s.angle2 = std::fmod(s.angle2+yaw,M_PI*2);
-                  if(s.angle2 < 0)
-                    s.angle2 += M_PI*2;
-
-                  s.have_yaw = true;
-                  //std::cerr << "radar sector yaw: " << s.yaw << " map frame: " << m_mapFrame << std::endl;
-
-              }
-              catch (tf2::TransformException &ex)
-              {
-                ROS_WARN_STREAM_THROTTLE(2.0,"Unable to find transform to generate display: " << ex.what() << " lookup call time: " << now << " now: " << ros::Time::now());
-              }
         }
+    }
+
+    // The surface is centered on the latest position of the first radar
+    // with data, and sized to fit every source around it.
+    QPointF reference;
+    bool have_reference = false;
+    for(auto source: current_sources)
+    {
+      for(auto s = source->sectors.rbegin(); s != source->sectors.rend(); s++)
+        if(s->have_yaw)
+        {
+          reference = s->position;
+          have_reference = true;
+          QMutexLocker lock(&m_radar_frame_mutex);
+          m_radar_frame = s->frame_id.toStdString();
+          break;
+        }
+      if(have_reference)
+        break;
+    }
+    double extent = 0.0;
+    for(auto source: current_sources)
+      for(const Sector &s: source->sectors)
         if(s.have_yaw)
         {
+          QPointF offset = s.position - reference;
+          extent = std::max(extent, sqrt(QPointF::dotProduct(offset, offset)) + s.range);
+        }
+    if(have_reference)
+      m_targets_display->setOrigin(reference);
+
+    for(int i = 0; extent > 0.0 && i < current_sources.size(); i++)
+    {
+      switch(settings[i].blend)
+      {
+        case RadarSourceSettings::Replace:
+          glDisable(GL_BLEND);
+          break;
+        case RadarSourceSettings::Additive:
+          glEnable(GL_BLEND);
+          glBlendEquation(GL_FUNC_ADD);
+          glBlendFunc(GL_ONE, GL_ONE);
+          break;
+        case RadarSourceSettings::Maximum:
+          glEnable(GL_BLEND);
+          glBlendEquation(GL_MAX);
+          glBlendFunc(GL_ONE, GL_ONE);
+          break;
+      }
+      m_program->setUniformValue("color", settings[i].color);
+      m_program->setUniformValue("usePalette", settings[i].use_palette);
+      if(settings[i].use_palette)
+        paletteTexture(settings[i].palette)->bind(1, QOpenGLTexture::ResetTextureUnit);
+      m_program->setUniformValue("gain", GLfloat(settings[i].gain));
+
+      for(Sector &s: current_sources[i]->sectors)
+      {
+        if(s.sectorImage && !s.rendered && s.have_yaw)
+        {
+          float fade = 1.0-((now-s.timestamp).toSec()/persistance);
+          if(!s.sectorTexture)
+          {
+            s.sectorTexture = new QOpenGLTexture(*s.sectorImage);
+          }
+
+          // Place the sector's unit quad at its radar's position on the surface.
+          QPointF offset = (s.position - reference)/extent;
+          QMatrix4x4 matrix = map_matrix;
+          matrix.translate(offset.x(), offset.y());
+          matrix.scale(s.range/extent, s.range/extent);
+          m_program->setUniformValue("matrix", matrix);
+
           m_program->setUniformValue("minAngle", GLfloat(s.angle2-s.half_scanline_angle*1.1));
           m_program->setUniformValue("maxAngle", GLfloat(s.angle1+s.half_scanline_angle*1.1));
           m_program->setUniformValue("fade", GLfloat(fade));
-          m_program->setUniformValue("color", m_color);
           
           s.sectorTexture->bind();
-          glDisable(GL_BLEND);
           glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
           //s.rendered = true;
         }
       }
     }
+    glDisable(GL_BLEND);
 
     {
       QMutexLocker lock(&m_radar_image_mutex);
+      QMutexLocker range_lock(&m_range_mutex);
+      m_range = extent;
       m_radar_image = m_fbo->toImage();
     }
     update();
@@ -364,21 +550,79 @@ void RadarDisplay::updateRadarImage()
 
 } 
 
-void RadarDisplay::showRadar(bool show)
+void RadarDisplay::queueDetection(RadarPolarSector sector)
 {
-    m_show_radar = show;
-    update();
+  QMutexLocker lock(&m_pending_sectors_mutex);
+  m_pending_sectors.push_back(std::move(sector));
+  if(m_pending_sectors.size() > max_pending_sectors)
+  {
+    ROS_WARN_STREAM_THROTTLE(2.0, "Radar target detection is falling behind, dropping sectors");
+    m_pending_sectors.pop_front();
+  }
+  if(m_detection_workers < m_detection_pool.maxThreadCount())
+  {
+    m_detection_workers++;
+    QtConcurrent::run(&m_detection_pool, this, &RadarDisplay::detectPending);
+  }
 }
 
-const QColor& RadarDisplay::getColor() const
+void RadarDisplay::detectPending()
 {
-    return m_color;
+  QMutexLocker lock(&m_pending_sectors_mutex);
+  while(!m_pending_sectors.empty())
+  {
+    RadarPolarSector sector = std::move(m_pending_sectors.front());
+    m_pending_sectors.pop_front();
+    lock.unlock();
+    detectTargets(sector);
+    lock.relock();
+  }
+  m_detection_workers--;
 }
 
-void RadarDisplay::setColor(QColor color)
+void RadarDisplay::detectTargets(const RadarPolarSector& sector)
 {
-    QMutexLocker lock(&m_color_mutex);
-    m_color = color;
+  auto plots = detectRadarTargets(sector, m_detection_parameters);
+  if(plots.empty())
+  {
+    // still lets the tracker age out tracks
+    m_tracker.update(sector.stamp, {});
+    return;
+  }
+
+  RadarPose pose;
+  if(!m_transforms.lookup(sector.frame_id, sector.stamp, pose, ros::Duration(0.5)))
+    return;
+
+  double c = cos(pose.yaw);
+  double s = sin(pose.yaw);
+  std::vector<QPointF> map_plots;
+  for(const auto& p: plots)
+    map_plots.push_back(pose.position + QPointF(c*p.position.x() - s*p.position.y(), s*p.position.x() + c*p.position.y()));
+  m_tracker.update(sector.stamp, map_plots);
+
+  // Lets targets be placed when no sectors are drawn.
+  QMutexLocker lock(&m_radar_frame_mutex);
+  if(sector.frame_id == m_radar_frame)
+    m_targets_display->setOrigin(pose.position);
+}
+
+void RadarDisplay::updateTargets()
+{
+  if(m_show_targets)
+    m_targets_display->updateTracks(m_tracker.tracks());
+}
+
+void RadarDisplay::showTargets(bool show)
+{
+  m_show_targets = show;
+  m_targets_display->setVisible(show);
+}
+
+void RadarDisplay::showRadar(bool show)
+{
+    m_show_radar = show;
+    update();
 }
 
 void RadarDisplay::updatePosition()
@@ -388,9 +632,11 @@ void RadarDisplay::updatePosition()
 
   std::string radar_frame;
   {
-    QMutexLocker lock(&m_new_sectors_mutex);
+    QMutexLocker lock(&m_radar_frame_mutex);
     radar_frame = m_radar_frame;
   }
+  if(radar_frame.empty())
+    return;
 
   try
   {
@@ -408,6 +654,13 @@ void RadarDisplay::updatePosition()
       setPos(geoToPixel(location, bg));
       update();
     }
+
+    std::string map_frame = m_transforms.mapFrame(radar_frame);
+    if(!map_frame.empty())
+    {
+      auto radar_to_map = m_tf_buffer->lookupTransform(map_frame, radar_frame, ros::Time());
+      m_tools_display->setHeading(tf2::getYaw(radar_to_map.transform.rotation));
+    }
   }
   catch (tf2::TransformException &ex)
   {
@@ -8,10 +8,16 @@
 #include <QOpenGLBuffer>
 #include <QOpenGLDebugLogger>
 #include <QMutex>
+#include <QThreadPool>
+#include <atomic>
 #include <deque>
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
 #include "marine_sensor_msgs/RadarSector.h"
+#include "colormap/colormap.h"
+#include "guard_zone.h"
+#include "radar_targets.h"
+#include "radar_transform_cache.h"
 
 Q_DECLARE_METATYPE(QImage*)
 Q_DECLARE_METATYPE(ros::Time)
@@ -20,40 +26,79 @@ class QOffscreenSurface;
 class QOpenGLContext;
 class QOpenGLFramebufferObject;
 class QOpenGLShaderProgram;
+class QTimer;
+class RadarTargetsDisplay;
+class RadarToolsDisplay;
+struct RadarTools;
 
 namespace tf2_ros
 {
     class Buffer;
 }
 
+// Display settings applied to one radar source when compositing.
+struct RadarSourceSettings
+{
+    enum Blend
+    {
+        // Newer sweeps overwrite what is under them.
+        Replace,
+        // Echoes of overlapping sources add up.
+        Additive,
+        // Strongest echo wins.
+        Maximum
+    };
+
+    QColor color = {0,255,0,255};
+    float gain = 1.0;
+    Blend blend = Replace;
+
+    // Colors echoes by intensity with a palette instead of the single color.
+    bool use_palette = false;
+    colormap::Palette palette = colormap::Palette::Turbo;
+};
+
+// Composites any number of radar sources into a single offscreen surface
+// aligned with the map frame, so additional radars share the GL context and
+// framebuffer instead of each needing their own.
 class RadarDisplay : public QObject, public GeoGraphicsItem,  protected QOpenGLFunctions
 {
     Q_OBJECT
     Q_INTERFACES(QGraphicsItem)
 public:
     RadarDisplay(QObject* parent = nullptr, QGraphicsItem *parentItem = nullptr);
+    ~RadarDisplay();
 
     QRectF boundingRect() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
     int type() const override {return RadarDisplayType;}
     void setTF2Buffer(tf2_ros::Buffer *buffer);
     void setMapFrame(std::string mapFrame);
-    const QColor& getColor() const;
     void setPixelSize(double s);
-    
+
+    RadarSourceSettings sourceSettings(QString topic) const;
+    void setSourceSettings(QString topic, const RadarSourceSettings& settings);
+
+    // Range rings, EBLs, VRMs and guard zones. Guard zones are checked
+    // against every source, even when the radar is hidden.
+    void setTools(const RadarTools& tools);
+    const RadarTools& tools() const;
+
+signals:
+    // Emitted from a ROS thread when a guard zone's alarm starts or stops.
+    void guardZoneAlarm(QString topic, int zone, bool active);
+
 public slots:
     void showRadar(bool show);
-    void setColor(QColor color);
+    void showTargets(bool show);
     void sectorAdded();
-    void subscribe(QString topic);
+    void addSource(QString topic);
     void updatePosition();
 
-private:
-    void initializeGL();
-    void radarCallback(const marine_sensor_msgs::RadarSector::ConstPtr &message);
-    void updateRadarImage();
+private slots:
+    void updateTargets();
 
-    
+private:
     struct Sector
     {
         Sector():angle1(0),angle2(0),range(0),yaw(-1.0),sectorImage(nullptr),sectorTexture(nullptr)
@@ -63,19 +108,51 @@ private:
         QString frame_id;
         double angle1, angle2, range, half_scanline_angle;
         double yaw;
+        // Meters, map frame.
+        QPointF position;
         double have_yaw = false;
         double rendered = false;
         QImage *sectorImage;
         QOpenGLTexture *sectorTexture;
     };
-    
-    double m_pixel_size = 1.0;
 
-    std::deque<Sector> m_sectors;
+    struct Source
+    {
+        std::string topic;
+        ros::Subscriber subscriber;
+
+        // Only accessed by the render thread.
+        std::deque<Sector> sectors;
+
+        std::deque<Sector> new_sectors;
+        std::string frame_id;
+        RadarSourceSettings settings;
+        // Protects new_sectors, frame_id and settings.
+        QMutex mutex;
+
+        GuardZoneMonitor guard_zones;
+    };
+
+    void initializeGL();
+    // Created on first use by the render thread.
+    QOpenGLTexture* paletteTexture(colormap::Palette palette);
+    // Called by the render thread as it stops, since it owns the context.
+    void releaseGL();
+    void radarCallback(Source* source, const marine_sensor_msgs::RadarSector::ConstPtr &message);
+    void updateRadarImage();
+    // Queues a sector for detection, dropping the oldest if detection lags.
+    void queueDetection(RadarPolarSector sector);
+    void detectPending();
+    void detectTargets(const RadarPolarSector& sector);
+    std::vector<std::shared_ptr<Source> > sources() const;
+    std::shared_ptr<Source> source(const QString& topic) const;
+
+    double m_pixel_size = 1.0;
 
-    std::deque<Sector> m_new_sectors;
-    QMutex m_new_sectors_mutex;
+    std::vector<std::shared_ptr<Source> > m_sources;
+    mutable QMutex m_sources_mutex;
 
+    // Half the width of the area covered by the composited image, in meters.
     double m_range = 0.0;
     QMutex m_range_mutex;
 
@@ -84,6 +161,7 @@ private:
     QOpenGLContext* m_context = nullptr;
     QOpenGLFramebufferObject* m_fbo = nullptr;
     QOpenGLBuffer m_vbo;
+    std::map<int, QOpenGLTexture*> m_palette_textures;
 
     QImage m_radar_image;
     QMutex m_radar_image_mutex;
@@ -92,19 +170,34 @@ private:
     
     bool m_show_radar = true;
 
-    QColor m_color ={0,255,0,255};
-    QMutex m_color_mutex;
-
     tf2_ros::Buffer* m_tf_buffer = nullptr;
-    std::string m_mapFrame;
+    RadarTransformCache m_transforms;
+
+    // Frame the display is centered on, from the first source with data.
     std::string m_radar_frame;
+    QMutex m_radar_frame_mutex;
 
     ros::CallbackQueue m_ros_queue;
     std::shared_ptr<ros::AsyncSpinner> m_spinner;
-    ros::Subscriber m_subscriber;
 
     QThread* m_radarImageThread;
+
+    std::atomic<bool> m_show_targets {false};
+    RadarDetectionParameters m_detection_parameters;
+    RadarTracker m_tracker;
+    RadarTargetsDisplay* m_targets_display = nullptr;
+    QTimer* m_targets_timer = nullptr;
+
+    RadarToolsDisplay* m_tools_display = nullptr;
+
+    static constexpr std::size_t max_pending_sectors = 16;
+    std::deque<RadarPolarSector> m_pending_sectors;
+    int m_detection_workers = 0;
+    // Protects m_pending_sectors and m_detection_workers.
+    QMutex m_pending_sectors_mutex;
+
+    // Declared last so pending detections finish before other members are destroyed.
+    QThreadPool m_detection_pool;
 };
 
 #endif
-
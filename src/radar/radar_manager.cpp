@@ -1,6 +1,7 @@
 #include "radar_manager.h"
 #include "backgroundraster.h"
 #include "radar_display.h"
+#include "radar_tools_display.h"
 #include <QTimer>
 #include <QColorDialog>
 
@@ -8,6 +9,22 @@ RadarManager::RadarManager(QWidget* parent):
   QWidget(parent)
 {
   ui_.setupUi(this);
+  connect(ui_.targetsCheckBox, &QCheckBox::toggled, this, &RadarManager::showTargets);
+  connect(ui_.sourcesListWidget, &QListWidget::itemSelectionChanged, this, &RadarManager::sourceSelected);
+  connect(ui_.colorPushButton, &QPushButton::clicked, this, &RadarManager::selectRadarColor);
+  connect(ui_.gainSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &RadarManager::gainChanged);
+  connect(ui_.blendComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &RadarManager::blendChanged);
+
+  ui_.paletteComboBox->addItem("Source color", -1);
+  for(auto palette: colormap::palettes())
+    ui_.paletteComboBox->addItem(colormap::paletteName(palette), int(palette));
+  connect(ui_.paletteComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &RadarManager::paletteChanged);
+
+  for(auto spin_box: ui_.toolsGroupBox->findChildren<QDoubleSpinBox*>())
+    connect(spin_box, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &RadarManager::updateTools);
+  connect(ui_.ringCountSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &RadarManager::updateTools);
+  for(auto check_box: ui_.toolsGroupBox->findChildren<QCheckBox*>())
+    connect(check_box, &QCheckBox::toggled, this, &RadarManager::updateTools);
 
   scan_timer_ = new QTimer(this);
   connect(scan_timer_, &QTimer::timeout, this, &RadarManager::scanForSources);
@@ -20,6 +37,20 @@ RadarManager::~RadarManager()
 
 }
 
+void RadarManager::createDisplay()
+{
+  if(radar_display_)
+    return;
+  radar_display_ = new RadarDisplay(this, background_);
+  radar_display_->setTF2Buffer(tf_buffer_);
+  radar_display_->showRadar(show_radar_);
+  radar_display_->showTargets(show_targets_);
+  if(background_)
+    radar_display_->setPixelSize(background_->pixelSize());
+  connect(radar_display_, &RadarDisplay::guardZoneAlarm, this, &RadarManager::updateGuardZoneAlarm);
+  updateTools();
+}
+
 void RadarManager::scanForSources()
 {
   ros::NodeHandle nh;
@@ -29,53 +60,177 @@ void RadarManager::scanForSources()
 
   for(const auto t: topic_info)
     if (t.datatype == "marine_sensor_msgs/RadarSector")
-      if (radar_displays_.find(t.name) == radar_displays_.end())
+      if (sources_.find(t.name) == sources_.end())
       {
-        radar_displays_[t.name] = new RadarDisplay(this, background_);
-        radar_displays_[t.name]->setTF2Buffer(tf_buffer_);
-        radar_displays_[t.name]->subscribe(t.name.c_str());
-        radar_displays_[t.name]->showRadar(show_radar_);
-        if(background_)
-          radar_displays_[t.name]->setPixelSize(background_->pixelSize());
+        createDisplay();
+        radar_display_->addSource(t.name.c_str());
+        sources_.insert(t.name);
 
         ui_.sourcesListWidget->addItem(t.name.c_str());
       }
 
-  for(auto rd: radar_displays_)
-    rd.second->updatePosition();
+  if(radar_display_)
+    radar_display_->updatePosition();
 }
 
-void RadarManager::showRadar(bool show)
+QString RadarManager::selectedSource() const
 {
-  show_radar_ = show;
-  for(auto rd: radar_displays_)
+  auto items = ui_.sourcesListWidget->selectedItems();
+  if(items.empty())
+    return QString();
+  return items.front()->text();
+}
+
+void RadarManager::sourceSelected()
+{
+  QString topic = selectedSource();
+  ui_.sourceGroupBox->setEnabled(radar_display_ && !topic.isEmpty());
+  if(!radar_display_ || topic.isEmpty())
+    return;
+
+  auto settings = radar_display_->sourceSettings(topic);
+  QSignalBlocker gain_blocker(ui_.gainSpinBox);
+  QSignalBlocker blend_blocker(ui_.blendComboBox);
+  QSignalBlocker palette_blocker(ui_.paletteComboBox);
+  ui_.gainSpinBox->setValue(settings.gain);
+  ui_.blendComboBox->setCurrentIndex(settings.blend);
+  ui_.paletteComboBox->setCurrentIndex(ui_.paletteComboBox->findData(settings.use_palette ? int(settings.palette) : -1));
+}
+
+void RadarManager::gainChanged(double gain)
+{
+  QString topic = selectedSource();
+  if(!radar_display_ || topic.isEmpty())
+    return;
+  auto settings = radar_display_->sourceSettings(topic);
+  settings.gain = gain;
+  radar_display_->setSourceSettings(topic, settings);
+}
+
+void RadarManager::blendChanged(int blend)
+{
+  QString topic = selectedSource();
+  if(!radar_display_ || topic.isEmpty())
+    return;
+  auto settings = radar_display_->sourceSettings(topic);
+  settings.blend = RadarSourceSettings::Blend(blend);
+  radar_display_->setSourceSettings(topic, settings);
+}
+
+void RadarManager::paletteChanged(int index)
+{
+  QString topic = selectedSource();
+  if(!radar_display_ || topic.isEmpty())
+    return;
+  auto settings = radar_display_->sourceSettings(topic);
+  int palette = ui_.paletteComboBox->itemData(index).toInt();
+  settings.use_palette = palette >= 0;
+  if(settings.use_palette)
+    settings.palette = colormap::Palette(palette);
+  radar_display_->setSourceSettings(topic, settings);
+}
+
+void RadarManager::updateTools()
+{
+  if(!radar_display_)
+    return;
+
+  RadarTools tools;
+  tools.ring_spacing = ui_.ringSpacingSpinBox->value();
+  tools.ring_count = ui_.ringCountSpinBox->value();
+  if(ui_.eblCheckBox->isChecked())
+    tools.ebl_bearings.push_back(ui_.eblSpinBox->value()*M_PI/180.0);
+  if(ui_.vrmCheckBox->isChecked())
+    tools.vrm_ranges.push_back(ui_.vrmSpinBox->value());
+  if(ui_.guardZoneCheckBox->isChecked())
   {
-    rd.second->showRadar(show);
+    GuardZone zone;
+    zone.bearing_start = ui_.guardBearingStartSpinBox->value()*M_PI/180.0;
+    zone.bearing_end = ui_.guardBearingEndSpinBox->value()*M_PI/180.0;
+    zone.range_min = ui_.guardRangeMinSpinBox->value();
+    zone.range_max = ui_.guardRangeMaxSpinBox->value();
+    zone.threshold = ui_.guardThresholdSpinBox->value();
+    tools.guard_zones.push_back(zone);
   }
+  radar_display_->setTools(tools);
+
+  // Zones were reset, so are their alarms.
+  alarms_.clear();
+  ui_.alarmLabel->clear();
+}
+
+void RadarManager::updateGuardZoneAlarm(QString topic, int zone, bool active)
+{
+  if(active)
+    alarms_.insert({topic, zone});
+  else
+    alarms_.erase({topic, zone});
+  QStringList topics;
+  for(const auto& alarm: alarms_)
+    if(topics.empty() || topics.back() != alarm.first)
+      topics.append(alarm.first);
+  if(topics.empty())
+    ui_.alarmLabel->clear();
+  else
+    ui_.alarmLabel->setText("<font color=\"red\">Guard zone alarm: "+topics.join(", ")+"</font>");
+  emit guardZoneAlarm(topic, zone, active);
+}
+
+void RadarManager::showRadar(bool show)
+{
+  show_radar_ = show;
+  if(radar_display_)
+    radar_display_->showRadar(show);
+}
+
+void RadarManager::showTargets(bool show)
+{
+  show_targets_ = show;
+  if(radar_display_)
+    radar_display_->showTargets(show);
 }
 
 void RadarManager::selectRadarColor()
 {
-  for(auto rd: radar_displays_)
+  if(!radar_display_)
+    return;
+
+  // Applies to the selected source, or to all of them if none is selected.
+  std::vector<QString> topics;
+  QString topic = selectedSource();
+  if(topic.isEmpty())
+    for(const auto& s: sources_)
+      topics.push_back(s.c_str());
+  else
+    topics.push_back(topic);
+  if(topics.empty())
+    return;
+
+  QColor color = QColorDialog::getColor(radar_display_->sourceSettings(topics.front()).color, nullptr, "Select Color", QColorDialog::DontUseNativeDialog);
+  if(!color.isValid())
+    return;
+  for(const auto& t: topics)
   {
-    rd.second->setColor(QColorDialog::getColor(rd.second->getColor() , nullptr, "Select Color", QColorDialog::DontUseNativeDialog));
+    auto settings = radar_display_->sourceSettings(t);
+    settings.color = color;
+    radar_display_->setSourceSettings(t, settings);
   }
 }
 
 void RadarManager::setTFBuffer(tf2_ros::Buffer* buffer)
 {
   tf_buffer_ = buffer;
-  for(auto rd: radar_displays_)
-    rd.second->setTF2Buffer(buffer);
+  if(radar_display_)
+    radar_display_->setTF2Buffer(buffer);
 }
 
 void RadarManager::updateBackground(BackgroundRaster * bg)
 {
   background_ = bg;
-  for(auto rd: radar_displays_)
+  if(radar_display_)
   {
-    rd.second->setParentItem(bg);
+    radar_display_->setParentItem(bg);
     if(bg)
-      rd.second->setPixelSize(bg->pixelSize());
+      radar_display_->setPixelSize(bg->pixelSize());
   }
 }
@@ -4,6 +4,8 @@
 #include <QWidget>
 #include "ui_radar_manager.h"
 #include <tf2_ros/transform_listener.h>
+#include <set>
+#include <utility>
 
 class BackgroundRaster;
 class RadarDisplay;
@@ -20,23 +22,41 @@ public:
 public slots:
   void updateBackground(BackgroundRaster * bg);
   void showRadar(bool show);
+  void showTargets(bool show);
   void selectRadarColor();
 
+signals:
+  void guardZoneAlarm(QString topic, int zone, bool active);
+
 private slots:
   void scanForSources();
-
+  void sourceSelected();
+  void gainChanged(double gain);
+  void blendChanged(int blend);
+  void paletteChanged(int index);
+  void updateTools();
+  void updateGuardZoneAlarm(QString topic, int zone, bool active);
 
 private:
+  QString selectedSource() const;
+  void createDisplay();
+
   Ui::RadarManager ui_;
 
   QTimer* scan_timer_;
   BackgroundRaster* background_ = nullptr;
 
-  std::map<std::string, RadarDisplay*> radar_displays_;
+  // All sources are composited by a single display.
+  RadarDisplay* radar_display_ = nullptr;
+  std::set<std::string> sources_;
+
+  // Source topic and zone of each active guard zone alarm.
+  std::set<std::pair<QString, int> > alarms_;
 
   tf2_ros::Buffer* tf_buffer_ = nullptr;
 
   bool show_radar_ = true;
+  bool show_targets_ = false;
 };
 
 #endif
\ No newline at end of file
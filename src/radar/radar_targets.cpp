@@ -0,0 +1,210 @@
+#include "radar_targets.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Union-find with path halving, used to merge blob labels.
+int findRoot(std::vector<int>& parents, int label)
+{
+  while(parents[label] != label)
+  {
+    parents[label] = parents[parents[label]];
+    label = parents[label];
+  }
+  return label;
+}
+
+} // namespace
+
+std::vector<RadarPlot> detectRadarTargets(const RadarPolarSector& sector, const RadarDetectionParameters& parameters)
+{
+  std::vector<RadarPlot> ret;
+  const int spokes = sector.spokes;
+  const int samples = sector.samples;
+  if(spokes <= 0 || samples <= 0 || sector.intensities.size() < std::size_t(spokes*samples))
+    return ret;
+
+  // CFAR along each spoke, using a running sum so the cost does not depend
+  // on the size of the training window.
+  std::vector<int> labels(spokes*samples, -1);
+  std::vector<double> prefix(samples+1);
+  std::vector<int> parents;
+  for(int i = 0; i < spokes; i++)
+  {
+    const float* spoke = &sector.intensities[i*samples];
+    prefix[0] = 0.0;
+    for(int j = 0; j < samples; j++)
+      prefix[j+1] = prefix[j] + spoke[j];
+
+    for(int j = 0; j < samples; j++)
+    {
+      if(spoke[j] < parameters.minimum_intensity)
+        continue;
+      int lead_begin = std::max(0, j-parameters.guard_cells-parameters.training_cells);
+      int lead_end = std::max(0, j-parameters.guard_cells);
+      int lag_begin = std::min(samples, j+parameters.guard_cells+1);
+      int lag_end = std::min(samples, j+parameters.guard_cells+1+parameters.training_cells);
+      int count = (lead_end-lead_begin) + (lag_end-lag_begin);
+      if(count == 0)
+        continue;
+      double noise = (prefix[lead_end]-prefix[lead_begin] + prefix[lag_end]-prefix[lag_begin])/count;
+      if(spoke[j] <= noise*parameters.threshold_factor)
+        continue;
+
+      // First pass of the connected component labelling, 4-connected over
+      // range (previous sample) and azimuth (previous spoke).
+      int index = i*samples+j;
+      int left = j > 0 ? labels[index-1] : -1;
+      int up = i > 0 ? labels[index-samples] : -1;
+      if(left < 0 && up < 0)
+      {
+        labels[index] = parents.size();
+        parents.push_back(parents.size());
+      }
+      else if(left >= 0 && up >= 0)
+      {
+        int left_root = findRoot(parents, left);
+        int up_root = findRoot(parents, up);
+        labels[index] = std::min(left_root, up_root);
+        parents[std::max(left_root, up_root)] = labels[index];
+      }
+      else
+        labels[index] = std::max(left, up);
+    }
+  }
+
+  if(parents.empty())
+    return ret;
+
+  // Second pass accumulates each blob in cartesian coordinates so the
+  // centroid does not suffer from averaging angles.
+  struct Blob
+  {
+    double weight = 0.0;
+    double x = 0.0;
+    double y = 0.0;
+    float peak = 0.0;
+    int cells = 0;
+  };
+  std::vector<Blob> blobs(parents.size());
+  double sample_size = sector.range_max/samples;
+  for(int i = 0; i < spokes; i++)
+  {
+    double angle = sector.angle_start + i*sector.angle_increment;
+    double c = cos(angle);
+    double s = sin(angle);
+    for(int j = 0; j < samples; j++)
+    {
+      int label = labels[i*samples+j];
+      if(label < 0)
+        continue;
+      Blob& blob = blobs[findRoot(parents, label)];
+      float intensity = sector.intensities[i*samples+j];
+      double range = (j+0.5)*sample_size;
+      blob.weight += intensity;
+      blob.x += intensity*range*c;
+      blob.y += intensity*range*s;
+      blob.peak = std::max(blob.peak, intensity);
+      blob.cells++;
+    }
+  }
+
+  for(const auto& blob: blobs)
+    if(blob.cells >= parameters.minimum_cells && blob.weight > 0.0)
+    {
+      RadarPlot plot;
+      plot.position = QPointF(blob.x/blob.weight, blob.y/blob.weight);
+      plot.peak_intensity = blob.peak;
+      plot.cells = blob.cells;
+      ret.push_back(plot);
+    }
+  return ret;
+}
+
+void RadarTracker::setParameters(const RadarTrackerParameters& parameters)
+{
+  QMutexLocker lock(&m_mutex);
+  m_parameters = parameters;
+}
+
+void RadarTracker::update(const ros::Time& stamp, const std::vector<QPointF>& plots)
+{
+  QMutexLocker lock(&m_mutex);
+
+  std::vector<QPointF> predictions(m_tracks.size());
+  for(int i = 0; i < m_tracks.size(); i++)
+  {
+    double dt = std::max(0.0, (stamp - m_tracks[i].last_update).toSec());
+    predictions[i] = m_tracks[i].position + m_tracks[i].velocity*dt;
+  }
+
+  // Greedy nearest neighbour association within the gate.
+  struct Candidate
+  {
+    double distance;
+    int track;
+    int plot;
+  };
+  std::vector<Candidate> candidates;
+  double gate2 = m_parameters.gate_distance*m_parameters.gate_distance;
+  for(int i = 0; i < predictions.size(); i++)
+    for(int j = 0; j < plots.size(); j++)
+    {
+      QPointF d = plots[j]-predictions[i];
+      double distance2 = QPointF::dotProduct(d, d);
+      if(distance2 < gate2)
+        candidates.push_back({distance2, i, j});
+    }
+  std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b){return a.distance < b.distance;});
+
+  std::vector<bool> track_used(m_tracks.size(), false);
+  std::vector<bool> plot_used(plots.size(), false);
+  for(const auto& c: candidates)
+  {
+    if(track_used[c.track] || plot_used[c.plot])
+      continue;
+    track_used[c.track] = true;
+    plot_used[c.plot] = true;
+
+    RadarTrack& track = m_tracks[c.track];
+    double dt = (stamp - track.last_update).toSec();
+    QPointF residual = plots[c.plot] - predictions[c.track];
+    track.position = predictions[c.track] + residual*m_parameters.alpha;
+    // Echoes of the same target split across adjacent sectors arrive almost
+    // together and carry no velocity information.
+    if(dt > 0.5)
+      track.velocity += residual*(m_parameters.beta/dt);
+    if(stamp > track.last_update)
+      track.last_update = stamp;
+    track.hits++;
+    if(track.hits >= m_parameters.confirmation_hits)
+      track.confirmed = true;
+  }
+
+  for(int j = 0; j < plots.size(); j++)
+    if(!plot_used[j])
+    {
+      RadarTrack track;
+      track.id = m_next_id++;
+      track.position = plots[j];
+      track.last_update = stamp;
+      track.hits = 1;
+      m_tracks.push_back(track);
+    }
+
+  m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [&](const RadarTrack& track)
+    {
+      double age = (stamp - track.last_update).toSec();
+      if(track.confirmed)
+        return age > m_parameters.confirmed_timeout;
+      return age > m_parameters.tentative_timeout;
+    }), m_tracks.end());
+}
+
+std::vector<RadarTrack> RadarTracker::tracks() const
+{
+  QMutexLocker lock(&m_mutex);
+  return m_tracks;
+}
@@ -0,0 +1,114 @@
+#ifndef CAMP_RADAR_TARGETS_H
+#define CAMP_RADAR_TARGETS_H
+
+#include <QMutex>
+#include <QPointF>
+#include <string>
+#include <vector>
+#include <ros/time.h>
+
+// Echo extraction and tracking on raw radar spokes.
+//
+// Detection runs on the polar data of a single sector, before scan
+// conversion: a cell averaging CFAR threshold along each spoke, connected
+// component labelling over range/azimuth, then an intensity weighted
+// centroid per blob. Plots are then associated to tracks in the map frame
+// by a nearest neighbour alpha-beta tracker.
+
+// Copy of a sector's intensities, spoke major, independent of the ROS message.
+struct RadarPolarSector
+{
+  ros::Time stamp;
+  std::string frame_id;
+
+  // Radians, radar frame.
+  double angle_start = 0.0;
+  double angle_increment = 0.0;
+
+  // Meters, range of the last sample.
+  double range_max = 0.0;
+
+  int spokes = 0;
+  int samples = 0;
+  std::vector<float> intensities;
+};
+
+struct RadarDetectionParameters
+{
+  // Cells on each side of the cell under test excluded from the noise estimate.
+  int guard_cells = 2;
+
+  // Cells on each side used to estimate the noise level.
+  int training_cells = 16;
+
+  // A cell is an echo if it exceeds the noise estimate by this factor...
+  float threshold_factor = 3.0;
+
+  // ...and this absolute intensity.
+  float minimum_intensity = 0.1;
+
+  // Blobs smaller than this are discarded as clutter.
+  int minimum_cells = 3;
+};
+
+// Centroid of a blob of echoes, in the radar frame.
+struct RadarPlot
+{
+  // Meters, radar frame.
+  QPointF position;
+  float peak_intensity = 0.0;
+  int cells = 0;
+};
+
+std::vector<RadarPlot> detectRadarTargets(const RadarPolarSector& sector, const RadarDetectionParameters& parameters);
+
+struct RadarTrack
+{
+  uint32_t id = 0;
+
+  // Meters, map frame.
+  QPointF position;
+
+  // Meters per second, map frame.
+  QPointF velocity;
+
+  ros::Time last_update;
+  int hits = 0;
+  bool confirmed = false;
+};
+
+struct RadarTrackerParameters
+{
+  // Meters, maximum distance between a predicted track and a plot.
+  double gate_distance = 50.0;
+
+  double alpha = 0.5;
+  double beta = 0.2;
+
+  // Hits needed before a track is reported as confirmed.
+  int confirmation_hits = 3;
+
+  // Seconds without an update before a track is dropped.
+  double confirmed_timeout = 10.0;
+  double tentative_timeout = 4.0;
+};
+
+// Thread safe, so sectors processed in parallel can all update it.
+class RadarTracker
+{
+public:
+  void setParameters(const RadarTrackerParameters& parameters);
+
+  // Plots are in meters in the map frame.
+  void update(const ros::Time& stamp, const std::vector<QPointF>& plots);
+
+  std::vector<RadarTrack> tracks() const;
+
+private:
+  RadarTrackerParameters m_parameters;
+  std::vector<RadarTrack> m_tracks;
+  uint32_t m_next_id = 1;
+  mutable QMutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "radar_targets_display.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+RadarTargetsDisplay::RadarTargetsDisplay(QGraphicsItem *parentItem): GeoGraphicsItem(parentItem)
+{
+  setZValue(1.0);
+}
+
+void RadarTargetsDisplay::setPixelSize(double s)
+{
+  prepareGeometryChange();
+  m_pixel_size = s;
+}
+
+void RadarTargetsDisplay::setOrigin(const QPointF& origin)
+{
+  QMutexLocker lock(&m_origin_mutex);
+  m_origin = origin;
+}
+
+QPointF RadarTargetsDisplay::toLocal(const QPointF& map_position) const
+{
+  // map frame is ENU, pixels are y down
+  QPointF d = map_position - m_display_origin;
+  return QPointF(d.x()/m_pixel_size, -d.y()/m_pixel_size);
+}
+
+void RadarTargetsDisplay::updateTracks(const std::vector<RadarTrack>& tracks)
+{
+  prepareGeometryChange();
+  {
+    QMutexLocker lock(&m_origin_mutex);
+    m_display_origin = m_origin;
+  }
+  m_tracks = tracks;
+  m_bounds = QRectF();
+  for(const auto& t: m_tracks)
+  {
+    QPointF p = toLocal(t.position);
+    QPointF v = toLocal(t.position + t.velocity*m_vector_duration);
+    m_bounds |= QRectF(p, v).normalized();
+  }
+  update();
+}
+
+QRectF RadarTargetsDisplay::boundingRect() const
+{
+  if(m_tracks.empty())
+    return QRectF();
+  // leave room for the symbols which are drawn with a fixed screen size
+  return m_bounds.marginsAdded(QMarginsF(50, 50, 50, 50));
+}
+
+void RadarTargetsDisplay::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  if(m_tracks.empty())
+    return;
+
+  painter->save();
+  auto lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  double radius = 6.0/lod;
+
+  QPen p;
+  p.setCosmetic(true);
+  p.setWidth(2);
+  for(const auto& t: m_tracks)
+  {
+    if(t.confirmed)
+      p.setColor(QColor(255, 165, 0, 255));
+    else
+      p.setColor(QColor(255, 165, 0, 96));
+    painter->setPen(p);
+    QPointF position = toLocal(t.position);
+    painter->drawEllipse(position, radius, radius);
+    if(t.confirmed)
+      painter->drawLine(position, toLocal(t.position + t.velocity*m_vector_duration));
+  }
+  painter->restore();
+}
@@ -0,0 +1,44 @@
+#ifndef CAMP_RADAR_TARGETS_DISPLAY_H
+#define CAMP_RADAR_TARGETS_DISPLAY_H
+
+#include "geographicsitem.h"
+#include "radar_targets.h"
+#include <QMutex>
+
+// Overlay drawing tracked radar echoes and their velocity vectors.
+// Meant to be a child of the RadarDisplay so it is centered on the radar.
+class RadarTargetsDisplay: public GeoGraphicsItem
+{
+public:
+  RadarTargetsDisplay(QGraphicsItem *parentItem = nullptr);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+  int type() const override {return RadarTargetsDisplayType;}
+
+  void setPixelSize(double s);
+
+  // Position of the radar in the map frame, tracks are drawn relative to it.
+  // May be called from any thread.
+  void setOrigin(const QPointF& origin);
+
+  // Copies the current tracks for drawing. Must be called from the GUI thread.
+  void updateTracks(const std::vector<RadarTrack>& tracks);
+
+private:
+  QPointF toLocal(const QPointF& map_position) const;
+
+  std::vector<RadarTrack> m_tracks;
+  QPointF m_display_origin;
+  QRectF m_bounds;
+
+  QPointF m_origin;
+  QMutex m_origin_mutex;
+
+  double m_pixel_size = 1.0;
+
+  // Seconds of motion represented by the velocity vectors.
+  double m_vector_duration = 60.0;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "radar_tools_display.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+RadarToolsDisplay::RadarToolsDisplay(QGraphicsItem *parentItem): GeoGraphicsItem(parentItem)
+{
+  setZValue(1.0);
+}
+
+void RadarToolsDisplay::setPixelSize(double s)
+{
+  prepareGeometryChange();
+  m_pixel_size = s;
+}
+
+void RadarToolsDisplay::setTools(const RadarTools& tools)
+{
+  prepareGeometryChange();
+  m_tools = tools;
+  m_zone_alarms.assign(tools.guard_zones.size(), {});
+  update();
+}
+
+const RadarTools& RadarToolsDisplay::tools() const
+{
+  return m_tools;
+}
+
+void RadarToolsDisplay::setHeading(double yaw)
+{
+  if(yaw == m_heading)
+    return;
+  m_heading = yaw;
+  update();
+}
+
+void RadarToolsDisplay::setGuardZoneActive(QString topic, int zone, bool active)
+{
+  if(zone < 0 || zone >= m_zone_alarms.size())
+    return;
+  if(active)
+    m_zone_alarms[zone].insert(topic);
+  else
+    m_zone_alarms[zone].erase(topic);
+  update();
+}
+
+QPointF RadarToolsDisplay::toLocal(double bearing, double range) const
+{
+  // map frame is ENU, pixels are y down
+  double angle = m_heading - bearing;
+  return QPointF(range*cos(angle)/m_pixel_size, -range*sin(angle)/m_pixel_size);
+}
+
+double RadarToolsDisplay::extent() const
+{
+  double ret = m_tools.ring_spacing*m_tools.ring_count;
+  for(auto r: m_tools.vrm_ranges)
+    ret = std::max(ret, r);
+  for(const auto& z: m_tools.guard_zones)
+    ret = std::max(ret, z.range_max);
+  return ret;
+}
+
+double RadarToolsDisplay::eblLength() const
+{
+  double r = extent();
+  return r > 0.0 ? r : 12000.0;
+}
+
+QRectF RadarToolsDisplay::boundingRect() const
+{
+  double r = extent();
+  if(!m_tools.ebl_bearings.empty())
+    r = std::max(r, eblLength());
+  r /= m_pixel_size;
+  // leave room for the labels which are drawn with a fixed screen size
+  return QRectF(-r, -r, 2*r, 2*r).marginsAdded(QMarginsF(50, 50, 50, 50));
+}
+
+void RadarToolsDisplay::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  double r = extent();
+  if(r <= 0.0 && m_tools.ebl_bearings.empty())
+    return;
+
+  painter->save();
+  QPen p;
+  p.setCosmetic(true);
+  p.setWidth(1);
+
+  p.setColor(QColor(0, 200, 200, 160));
+  painter->setPen(p);
+  for(int i = 1; m_tools.ring_spacing > 0.0 && i <= m_tools.ring_count; i++)
+  {
+    double ring = i*m_tools.ring_spacing/m_pixel_size;
+    painter->drawEllipse(QPointF(), ring, ring);
+  }
+
+  p.setColor(QColor(255, 255, 0, 200));
+  p.setStyle(Qt::DashLine);
+  painter->setPen(p);
+  for(auto range: m_tools.vrm_ranges)
+    painter->drawEllipse(QPointF(), range/m_pixel_size, range/m_pixel_size);
+  double ebl_length = eblLength();
+  for(auto bearing: m_tools.ebl_bearings)
+    painter->drawLine(QPointF(), toLocal(bearing, ebl_length));
+
+  p.setStyle(Qt::SolidLine);
+  p.setWidth(2);
+  for(int i = 0; i < m_tools.guard_zones.size(); i++)
+  {
+    const auto& z = m_tools.guard_zones[i];
+    if(!m_zone_alarms[i].empty())
+      p.setColor(QColor(255, 0, 0, 255));
+    else
+      p.setColor(QColor(255, 128, 0, 200));
+    painter->setPen(p);
+
+    double width = std::fmod(z.bearing_end - z.bearing_start, 2.0*M_PI);
+    if(width <= 0.0)
+      width += 2.0*M_PI;
+    // QPainterPath angles are in degrees, counterclockwise from east.
+    double start = (m_heading - z.bearing_start)*180.0/M_PI;
+    double span = -width*180.0/M_PI;
+    QRectF outer(-z.range_max/m_pixel_size, -z.range_max/m_pixel_size, 2*z.range_max/m_pixel_size, 2*z.range_max/m_pixel_size);
+    QRectF inner(-z.range_min/m_pixel_size, -z.range_min/m_pixel_size, 2*z.range_min/m_pixel_size, 2*z.range_min/m_pixel_size);
+    QPainterPath path;
+    path.arcMoveTo(inner, start);
+    path.arcTo(outer, start, 0.0);
+    path.arcTo(outer, start, span);
+    path.arcTo(inner, start+span, 0.0);
+    path.arcTo(inner, start+span, -span);
+    path.closeSubpath();
+    painter->drawPath(path);
+  }
+  painter->restore();
+}
@@ -0,0 +1,64 @@
+#ifndef CAMP_RADAR_TOOLS_DISPLAY_H
+#define CAMP_RADAR_TOOLS_DISPLAY_H
+
+#include "geographicsitem.h"
+#include "guard_zone.h"
+#include <QString>
+#include <set>
+
+// Navigation aids drawn around the radar.
+struct RadarTools
+{
+  // Meters between range rings, none are drawn if zero.
+  double ring_spacing = 0.0;
+  int ring_count = 0;
+
+  // Electronic bearing lines, radians clockwise from the bow.
+  std::vector<double> ebl_bearings;
+
+  // Variable range markers, meters.
+  std::vector<double> vrm_ranges;
+
+  std::vector<GuardZone> guard_zones;
+};
+
+// Overlay drawing range rings, EBLs, VRMs and guard zones. Meant to be a
+// child of the RadarDisplay so it is centered on the radar.
+class RadarToolsDisplay: public GeoGraphicsItem
+{
+public:
+  RadarToolsDisplay(QGraphicsItem *parentItem = nullptr);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+  int type() const override {return RadarToolsDisplayType;}
+
+  void setPixelSize(double s);
+  void setTools(const RadarTools& tools);
+  const RadarTools& tools() const;
+
+  // Radians, counterclockwise from east, so relative bearings can be drawn.
+  void setHeading(double yaw);
+
+  // A zone is highlighted while any source has it in alarm.
+  void setGuardZoneActive(QString topic, int zone, bool active);
+
+private:
+  // Pixel position of a point at a relative bearing and range from the radar.
+  QPointF toLocal(double bearing, double range) const;
+
+  // Meters, furthest extent of the tools.
+  double extent() const;
+
+  // Meters, EBLs run to the edge of the tools, or a fixed length if there
+  // are none.
+  double eblLength() const;
+
+  RadarTools m_tools;
+  // Sources in alarm, per zone.
+  std::vector<std::set<QString> > m_zone_alarms;
+  double m_heading = M_PI/2.0;
+  double m_pixel_size = 1.0;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "radar_transform_cache.h"
+#include <QString>
+#include <algorithm>
+#include <cmath>
+#include <ros/console.h>
+#include <tf2/utils.h>
+#include <tf2_ros/buffer.h>
+#include <yaml-cpp/yaml.h>
+
+void RadarTransformCache::setTF2Buffer(tf2_ros::Buffer* buffer)
+{
+  QMutexLocker lock(&m_mutex);
+  m_tf_buffer = buffer;
+  m_frames.clear();
+}
+
+void RadarTransformCache::setMapFrame(const std::string& map_frame)
+{
+  QMutexLocker lock(&m_mutex);
+  m_map_frame_override = map_frame;
+  m_frames.clear();
+}
+
+std::string RadarTransformCache::mapFrame(const std::string& frame)
+{
+  QMutexLocker lock(&m_mutex);
+  auto& history = m_frames[frame];
+  resolveMapFrame(frame, history);
+  return history.map_frame;
+}
+
+bool RadarTransformCache::resolveMapFrame(const std::string& frame, FrameHistory& history)
+{
+  if(!m_map_frame_override.empty())
+  {
+    history.map_frame = m_map_frame_override;
+    return true;
+  }
+  if(!history.map_frame.empty())
+    return true;
+  if(!m_tf_buffer)
+    return false;
+
+  auto now = ros::WallTime::now();
+  if(now - history.last_resolve_attempt < ros::WallDuration(1.0))
+    return false;
+  history.last_resolve_attempt = now;
+
+  std::map<std::string, std::string> parents;
+  try
+  {
+    auto frames = YAML::Load(m_tf_buffer->allFramesAsYAML());
+    for(auto f: frames)
+      parents[f.first.as<std::string>()] = f.second["parent"].as<std::string>();
+  }
+  catch(YAML::Exception &ex)
+  {
+    ROS_WARN_STREAM_THROTTLE(2.0, "Unable to parse TF frames: " << ex.what());
+    return false;
+  }
+
+  auto cursor = parents.find(frame);
+  // depth limit guards against loops while the tree is being rebuilt
+  for(int depth = 0; depth < 64 && cursor != parents.end(); depth++)
+  {
+    const std::string& parent = cursor->second;
+    if(QString(parent.c_str()).endsWith("/map"))
+    {
+      if(!m_tf_buffer->canTransform(parent, frame, ros::Time()))
+        return false;
+      ROS_INFO_STREAM("Radar frame " << frame << " resolved to map frame " << parent);
+      history.map_frame = parent;
+      return true;
+    }
+    cursor = parents.find(parent);
+  }
+  return false;
+}
+
+bool RadarTransformCache::interpolate(const FrameHistory& history, const ros::Time& stamp, RadarPose& pose) const
+{
+  const auto& poses = history.poses;
+  if(poses.empty() || stamp < poses.front().stamp || stamp > poses.back().stamp)
+    return false;
+
+  auto after = std::lower_bound(poses.begin(), poses.end(), stamp, [](const RadarPose& p, const ros::Time& t){return p.stamp < t;});
+  if(after->stamp == stamp)
+  {
+    pose = *after;
+    return true;
+  }
+  auto before = after-1;
+  double gap = (after->stamp - before->stamp).toSec();
+  // Don't bridge holes left by TF dropouts.
+  if(gap > 1.0)
+    return false;
+
+  double f = (stamp - before->stamp).toSec()/gap;
+  pose.stamp = stamp;
+  pose.position = before->position + (after->position - before->position)*f;
+  pose.yaw = before->yaw + std::remainder(after->yaw - before->yaw, 2.0*M_PI)*f;
+  return true;
+}
+
+void RadarTransformCache::insert(FrameHistory& history, const RadarPose& pose)
+{
+  auto& poses = history.poses;
+  auto i = std::lower_bound(poses.begin(), poses.end(), pose.stamp, [](const RadarPose& p, const ros::Time& t){return p.stamp < t;});
+  if(i != poses.end() && i->stamp == pose.stamp)
+    return;
+  poses.insert(i, pose);
+  while(poses.size() > m_history_size)
+    poses.pop_front();
+}
+
+bool RadarTransformCache::lookupTransform(const std::string& map_frame, const std::string& frame, const ros::Time& stamp, RadarPose& pose, ros::Duration timeout)
+{
+  try
+  {
+    auto t = m_tf_buffer->lookupTransform(map_frame, frame, stamp, timeout);
+    pose.stamp = t.header.stamp;
+    pose.position = QPointF(t.transform.translation.x, t.transform.translation.y);
+    pose.yaw = tf2::getYaw(t.transform.rotation);
+    return true;
+  }
+  catch (tf2::ExtrapolationException &ex)
+  {
+    // Not available yet, or already dropped from the buffer.
+    ROS_DEBUG_STREAM_THROTTLE(2.0, "Radar transform not available: " << ex.what());
+  }
+  catch (tf2::TransformException &ex)
+  {
+    // The tree changed, so the map frame needs to be resolved again.
+    ROS_WARN_STREAM_THROTTLE(2.0, "Unable to find transform for radar: " << ex.what());
+    QMutexLocker lock(&m_mutex);
+    auto& history = m_frames[frame];
+    history.map_frame.clear();
+    history.poses.clear();
+    history.is_static = false;
+  }
+  return false;
+}
+
+bool RadarTransformCache::lookup(const std::string& frame, const ros::Time& stamp, RadarPose& pose, ros::Duration timeout)
+{
+  std::string map_frame;
+  bool newer_than_history = false;
+  {
+    QMutexLocker lock(&m_mutex);
+    if(!m_tf_buffer)
+      return false;
+    auto& history = m_frames[frame];
+    if(!resolveMapFrame(frame, history))
+      return false;
+    if(interpolate(history, stamp, pose))
+      return true;
+    // Static poses are refreshed from the latest transform once a second.
+    if(history.is_static && ros::WallTime::now() - history.last_latest_query < ros::WallDuration(1.0))
+    {
+      pose = history.static_pose;
+      pose.stamp = stamp;
+      return true;
+    }
+    map_frame = history.map_frame;
+    newer_than_history = history.poses.empty() || stamp > history.poses.back().stamp;
+    if(newer_than_history && timeout.isZero())
+    {
+      // Only poll TF once per batch of sectors, the rest wait for the next one.
+      auto now = ros::WallTime::now();
+      if(now - history.last_latest_query < ros::WallDuration(0.02))
+        return false;
+      history.last_latest_query = now;
+    }
+  }
+
+  RadarPose result;
+  if(newer_than_history && timeout.isZero())
+  {
+    // Extend the history with the latest available transform and
+    // interpolate from it if it's recent enough.
+    if(!lookupTransform(map_frame, frame, ros::Time(), result, timeout))
+      return false;
+    QMutexLocker lock(&m_mutex);
+    auto& history = m_frames[frame];
+    history.is_static = result.stamp.isZero();
+    if(history.is_static)
+    {
+      history.static_pose = result;
+      pose = result;
+      pose.stamp = stamp;
+      return true;
+    }
+    insert(history, result);
+    return interpolate(history, stamp, pose);
+  }
+
+  if(!lookupTransform(map_frame, frame, stamp, result, timeout))
+    return false;
+  QMutexLocker lock(&m_mutex);
+  insert(m_frames[frame], result);
+  pose = result;
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef CAMP_RADAR_TRANSFORM_CACHE_H
+#define CAMP_RADAR_TRANSFORM_CACHE_H
+
+#include <QMutex>
+#include <QPointF>
+#include <deque>
+#include <map>
+#include <string>
+#include <ros/time.h>
+#include <ros/duration.h>
+
+namespace tf2_ros
+{
+  class Buffer;
+}
+
+// Pose of a radar frame in the map frame, flattened to 2D.
+struct RadarPose
+{
+  ros::Time stamp;
+
+  // Meters, map frame.
+  QPointF position;
+
+  // Radians, counterclockwise from the map's x axis.
+  double yaw = 0.0;
+};
+
+// Resolves radar frames to a map frame and keeps a short pose history per
+// frame so each sector's pose can be interpolated locally instead of doing a
+// TF lookup per sector.
+//
+// The map frame is found by walking a frame's parents until one ending in
+// "/map" is found. The result is kept until a lookup fails, which happens
+// when the TF tree is rearranged, so resolution is not repeated per sector.
+//
+// Sectors sharing a stamp share a single TF lookup, later ones being served
+// from the history. A chain of static transforms, such as a shore radar's,
+// is kept as a single pose that holds at any time. Thread safe.
+class RadarTransformCache
+{
+public:
+  void setTF2Buffer(tf2_ros::Buffer *buffer);
+
+  // Overrides the map frame resolution when not empty.
+  void setMapFrame(const std::string& map_frame);
+
+  // Returns the map frame for a radar frame or an empty string if not found.
+  std::string mapFrame(const std::string& frame);
+
+  // Pose of frame in the map frame at stamp. Returns false if it isn't
+  // available yet. If timeout is not zero, waits for TF up to timeout when
+  // the stamp is newer than the history.
+  bool lookup(const std::string& frame, const ros::Time& stamp, RadarPose& pose, ros::Duration timeout = ros::Duration());
+
+private:
+  struct FrameHistory
+  {
+    std::string map_frame;
+    std::deque<RadarPose> poses;
+
+    // Set when the latest transform has a zero stamp, meaning the whole
+    // chain is static, so the pose holds at any time.
+    bool is_static = false;
+    RadarPose static_pose;
+
+    // Wall time of the last attempt at resolving the map frame or fetching
+    // the latest transform, used to rate limit TF queries.
+    ros::WallTime last_resolve_attempt;
+    ros::WallTime last_latest_query;
+  };
+
+  // Called with m_mutex held.
+  bool resolveMapFrame(const std::string& frame, FrameHistory& history);
+  bool interpolate(const FrameHistory& history, const ros::Time& stamp, RadarPose& pose) const;
+  void insert(FrameHistory& history, const RadarPose& pose);
+
+  // Lookup done without holding m_mutex as it may block.
+  bool lookupTransform(const std::string& map_frame, const std::string& frame, const ros::Time& stamp, RadarPose& pose, ros::Duration timeout);
+
+  tf2_ros::Buffer* m_tf_buffer = nullptr;
+  std::string m_map_frame_override;
+  std::map<std::string, FrameHistory> m_frames;
+
+  // Poses kept per frame.
+  std::size_t m_history_size = 64;
+
+  QMutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "tile_pyramid.h"
+#include <QPainter>
+#include <QPaintDevice>
+#include <QStyleOptionGraphicsItem>
+#include <cmath>
+#include <cstring>
+
+namespace raster
+{
+
+TilePyramid::TilePyramid()
+{
+  setMemoryBudget(128*1024*1024);
+}
+
+void TilePyramid::setMemoryBudget(std::size_t bytes)
+{
+  // Costs are in KiB, a tile being 256 of them. Split between the tiles
+  // and their pixmaps.
+  images_.setMaxCost(bytes/2048);
+  pixmaps_.setMaxCost(bytes/2048);
+}
+
+QRect TilePyramid::rect() const
+{
+  return QRect(QPoint(), size_);
+}
+
+void TilePyramid::clear()
+{
+  base_tiles_.clear();
+  images_.clear();
+  pixmaps_.clear();
+  origin_ = QPoint();
+  size_ = QSize();
+  max_level_ = 0;
+}
+
+quint64 TilePyramid::key(int level, int x, int y)
+{
+  return (quint64(level) << 56) | (quint64(quint32(x) & 0xfffffff) << 28) | quint64(quint32(y) & 0xfffffff);
+}
+
+int TilePyramid::tileIndex(int p)
+{
+  return p >= 0 ? p/tile_size : -((-p+tile_size-1)/tile_size);
+}
+
+void TilePyramid::invalidate(int x, int y)
+{
+  pixmaps_.remove(key(0, x, y));
+  for(int level = 1; level <= max_level_; level++)
+  {
+    x = x >= 0 ? x/2 : -((-x+1)/2);
+    y = y >= 0 ? y/2 : -((-y+1)/2);
+    images_.remove(key(level, x, y));
+    pixmaps_.remove(key(level, x, y));
+  }
+}
+
+void TilePyramid::setImage(const QImage& image)
+{
+  if(image.size() != size_)
+  {
+    clear();
+    size_ = image.size();
+    int largest = std::max(size_.width(), size_.height());
+    while((tile_size << max_level_) < largest)
+      max_level_++;
+  }
+  update(image, QPoint());
+}
+
+void TilePyramid::update(const QImage& patch, const QPoint& position)
+{
+  QRect region = QRect(position, patch.size()).intersected(rect());
+  if(region.isEmpty())
+    return;
+  // Grid images are already ARGB32 so this is usually a shallow copy.
+  QImage source = patch.convertToFormat(QImage::Format_ARGB32);
+  QRect tile_space = region.translated(origin_);
+  for(int ty = tileIndex(tile_space.top()); ty <= tileIndex(tile_space.bottom()); ty++)
+    for(int tx = tileIndex(tile_space.left()); tx <= tileIndex(tile_space.right()); tx++)
+    {
+      QRect tile_rect(tx*tile_size, ty*tile_size, tile_size, tile_size);
+      QRect overlap = tile_rect.intersected(tile_space);
+
+      auto& tile = base_tiles_[key(0, tx, ty)];
+      bool changed = false;
+      if(tile.isNull())
+      {
+        tile = QImage(tile_size, tile_size, QImage::Format_ARGB32);
+        tile.fill(Qt::transparent);
+        changed = true;
+      }
+
+      int bytes = overlap.width()*4;
+      for(int y = overlap.top(); y <= overlap.bottom(); y++)
+      {
+        const uchar* from = source.constScanLine(y-origin_.y()-position.y()) + (overlap.left()-origin_.x()-position.x())*4;
+        uchar* to = tile.scanLine(y-tile_rect.top()) + (overlap.left()-tile_rect.left())*4;
+        if(changed || std::memcmp(from, to, bytes) != 0)
+        {
+          std::memcpy(to, from, bytes);
+          changed = true;
+        }
+      }
+      if(changed)
+        invalidate(tx, ty);
+    }
+}
+
+void TilePyramid::scroll(const QPoint& shift)
+{
+  if(shift.isNull())
+    return;
+  origin_ -= shift;
+  prune();
+}
+
+void TilePyramid::prune()
+{
+  QRect tile_space = rect().translated(origin_);
+  for(auto i = base_tiles_.begin(); i != base_tiles_.end();)
+  {
+    int tx = int(qint32(quint32(i->first >> 28) << 4) >> 4);
+    int ty = int(qint32(quint32(i->first) << 4) >> 4);
+    if(QRect(tx*tile_size, ty*tile_size, tile_size, tile_size).intersects(tile_space))
+      i++;
+    else
+    {
+      invalidate(tx, ty);
+      i = base_tiles_.erase(i);
+    }
+  }
+}
+
+const QImage* TilePyramid::baseTile(int x, int y) const
+{
+  auto tile = base_tiles_.find(key(0, x, y));
+  if(tile == base_tiles_.end())
+    return nullptr;
+  return &tile->second;
+}
+
+const QImage* TilePyramid::tileImage(int level, int x, int y)
+{
+  if(level == 0)
+    return baseTile(x, y);
+  auto cached = images_.object(key(level, x, y));
+  if(cached)
+    return cached;
+
+  auto image = new QImage(tile_size, tile_size, QImage::Format_ARGB32);
+  image->fill(Qt::transparent);
+  bool empty = true;
+  {
+    QPainter painter(image);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    for(int dy = 0; dy < 2; dy++)
+      for(int dx = 0; dx < 2; dx++)
+      {
+        auto child = tileImage(level-1, x*2+dx, y*2+dy);
+        if(child)
+        {
+          painter.drawImage(QRectF(dx*tile_size/2, dy*tile_size/2, tile_size/2, tile_size/2), *child);
+          empty = false;
+        }
+      }
+  }
+  if(empty)
+  {
+    delete image;
+    return nullptr;
+  }
+  images_.insert(key(level, x, y), image, tile_size);
+  return images_.object(key(level, x, y));
+}
+
+const QPixmap* TilePyramid::tilePixmap(int level, int x, int y)
+{
+  auto cached = pixmaps_.object(key(level, x, y));
+  if(cached)
+    return cached;
+  auto image = tileImage(level, x, y);
+  if(!image)
+    return nullptr;
+  auto pixmap = new QPixmap(QPixmap::fromImage(*image));
+  pixmaps_.insert(key(level, x, y), pixmap, tile_size);
+  return pixmaps_.object(key(level, x, y));
+}
+
+void TilePyramid::draw(QPainter* painter)
+{
+  if(size_.isEmpty())
+    return;
+
+  auto lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  int level = 0;
+  if(lod > 0.0)
+    level = std::max(0, std::min(max_level_, int(std::floor(std::log2(1.0/lod)))));
+  int level_size = tile_size << level;
+
+  // Visible part of the image, in tile space.
+  QRectF visible = rect();
+  auto device = painter->device();
+  if(device)
+  {
+    bool invertible;
+    auto inverse = painter->worldTransform().inverted(&invertible);
+    if(invertible)
+      visible &= inverse.mapRect(QRectF(0, 0, device->width(), device->height()));
+  }
+  if(visible.isEmpty())
+    return;
+  visible.translate(origin_);
+
+  painter->save();
+  // Tiles may hold stale pixels beyond the image's edges.
+  painter->setClipRect(rect(), Qt::IntersectClip);
+  painter->translate(-origin_);
+  if(level > 0)
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+  int x0 = std::floor(visible.left()/level_size);
+  int x1 = std::floor(visible.right()/level_size);
+  int y0 = std::floor(visible.top()/level_size);
+  int y1 = std::floor(visible.bottom()/level_size);
+  for(int y = y0; y <= y1; y++)
+    for(int x = x0; x <= x1; x++)
+    {
+      auto pixmap = tilePixmap(level, x, y);
+      if(pixmap)
+        painter->drawPixmap(QRectF(x*level_size, y*level_size, level_size, level_size), *pixmap, pixmap->rect());
+    }
+  painter->restore();
+}
+
+TilePyramidItem::TilePyramidItem(QGraphicsItem* parent):
+  QGraphicsItem(parent)
+{
+}
+
+QRectF TilePyramidItem::boundingRect() const
+{
+  return rect_;
+}
+
+void TilePyramidItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  if(pyramid_)
+    pyramid_->draw(painter);
+}
+
+void TilePyramidItem::setPyramid(TilePyramid* pyramid)
+{
+  pyramid_ = pyramid;
+  updateGeometry();
+}
+
+void TilePyramidItem::updateGeometry()
+{
+  QRectF rect;
+  if(pyramid_)
+    rect = pyramid_->rect();
+  if(rect != rect_)
+  {
+    prepareGeometryChange();
+    rect_ = rect;
+  }
+  update();
+}
+
+} // namespace raster
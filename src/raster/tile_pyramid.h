@@ -0,0 +1,117 @@
+#ifndef RASTER_TILE_PYRAMID_H
+#define RASTER_TILE_PYRAMID_H
+
+#include <QCache>
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPixmap>
+#include <unordered_map>
+#include "../map/item_types.h"
+
+namespace raster
+{
+
+// Large image stored as 256 pixel square tiles at full resolution, plus
+// lower resolution levels built on demand by halving the level below.
+//
+// Only tiles covering changed pixels are rebuilt, along with their lower
+// resolution ancestors the next time they are drawn. Drawing picks the level
+// matching the painter's scale and only draws visible tiles. Full resolution
+// tiles are the image's storage, while pixmaps and lower resolution tiles are
+// kept in a cache evicted under a memory budget.
+//
+// Tiles are addressed in a fixed pixel space, the image being a window in
+// it, so scrolling the image only moves the window.
+//
+// Not thread safe, meant to be used from the GUI thread.
+class TilePyramid
+{
+public:
+  static constexpr int tile_size = 256;
+
+  TilePyramid();
+
+  // Bytes used by cached pixmaps and lower resolution tiles.
+  void setMemoryBudget(std::size_t bytes);
+
+  // The image, in its own pixel coordinates.
+  QRect rect() const;
+
+  void clear();
+
+  // Replaces the whole image. If the size did not change, only tiles whose
+  // pixels differ are updated.
+  void setImage(const QImage& image);
+
+  // Copies patch into the image at position.
+  void update(const QImage& patch, const QPoint& position);
+
+  // Moves the content by shift pixels. Exposed pixels are undefined until
+  // updated.
+  void scroll(const QPoint& shift);
+
+  // Draws the image with its top left corner at the origin.
+  void draw(QPainter* painter);
+
+private:
+  // Key for a tile, packed as level, x and y.
+  static quint64 key(int level, int x, int y);
+
+  // Tile index covering pixel p at level 0.
+  static int tileIndex(int p);
+
+  // Marks a level 0 tile as changed, dropping what was derived from it.
+  void invalidate(int x, int y);
+
+  // Level 0 tiles are never evicted.
+  const QImage* baseTile(int x, int y) const;
+
+  // Builds or fetches a tile, recursively building its children.
+  const QImage* tileImage(int level, int x, int y);
+  const QPixmap* tilePixmap(int level, int x, int y);
+
+  // Drops level 0 tiles no longer touching the image.
+  void prune();
+
+  std::unordered_map<quint64, QImage> base_tiles_;
+  QCache<quint64, QImage> images_;
+  QCache<quint64, QPixmap> pixmaps_;
+
+  // Position of the image's top left corner in tile space.
+  QPoint origin_;
+  QSize size_;
+
+  // Lowest resolution level, at which the image fits in a few tiles.
+  int max_level_ = 0;
+};
+
+// Graphics item drawing a TilePyramid it does not own.
+class TilePyramidItem: public QGraphicsItem
+{
+public:
+  TilePyramidItem(QGraphicsItem* parent = nullptr);
+
+  enum { Type = map::TilePyramidType };
+
+  int type() const override
+  {
+    // Enable the use of qgraphicsitem_cast with this item.
+    return Type;
+  }
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  void setPyramid(TilePyramid* pyramid);
+
+  // To be called when the pyramid's size changed.
+  void updateGeometry();
+
+private:
+  TilePyramid* pyramid_ = nullptr;
+  QRectF rect_;
+};
+
+} // namespace raster
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CAMP_RING_BUFFER_H
+#define CAMP_RING_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Fixed capacity FIFO over a preallocated vector. Pushing to a full buffer
+// drops the oldest element unless the buffer is grown first.
+template<typename T> class RingBuffer
+{
+public:
+  explicit RingBuffer(std::size_t capacity = 1024)
+  {
+    data_.resize(std::max<std::size_t>(1, capacity));
+  }
+
+  std::size_t size() const {return size_;}
+  std::size_t capacity() const {return data_.size();}
+  bool empty() const {return size_ == 0;}
+  bool full() const {return size_ == data_.size();}
+
+  // 0 is the oldest element.
+  T& operator[](std::size_t i) {return data_[(begin_+i)%data_.size()];}
+  const T& operator[](std::size_t i) const {return data_[(begin_+i)%data_.size()];}
+
+  T& front() {return (*this)[0];}
+  const T& front() const {return (*this)[0];}
+  T& back() {return (*this)[size_-1];}
+  const T& back() const {return (*this)[size_-1];}
+
+  void push_back(T value)
+  {
+    if(full())
+      pop_front();
+    data_[(begin_+size_)%data_.size()] = std::move(value);
+    size_++;
+  }
+
+  void pop_front()
+  {
+    data_[begin_] = T();
+    begin_ = (begin_+1)%data_.size();
+    size_--;
+  }
+
+  void clear()
+  {
+    while(!empty())
+      pop_front();
+    begin_ = 0;
+  }
+
+  // Grows or shrinks the buffer, keeping the newest elements.
+  void setCapacity(std::size_t capacity)
+  {
+    capacity = std::max<std::size_t>(1, capacity);
+    while(size_ > capacity)
+      pop_front();
+    std::vector<T> data(capacity);
+    for(std::size_t i = 0; i < size_; i++)
+      data[i] = std::move((*this)[i]);
+    data_.swap(data);
+    begin_ = 0;
+  }
+
+private:
+  std::vector<T> data_;
+  std::size_t begin_ = 0;
+  std::size_t size_ = 0;
+};
+
+#endif
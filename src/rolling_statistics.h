@@ -0,0 +1,190 @@
+#ifndef CAMP_ROLLING_STATISTICS_H
+#define CAMP_ROLLING_STATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+
+// Statistics of the samples added over the last window seconds.
+//
+// Every update is O(1) amortized: the mean and variance are kept with
+// Welford's method, adding new samples and removing expired ones, and the
+// minimum and maximum come from the fronts of monotonic deques. The EWMA
+// weighs samples by their age with the given time constant so it doesn't
+// depend on the sample rate.
+//
+// Times are in seconds and must not decrease.
+class RollingStatistics
+{
+public:
+  explicit RollingStatistics(double window = 60.0, double ewma_time_constant = 10.0):
+    window_(window), ewma_time_constant_(ewma_time_constant)
+  {
+  }
+
+  void add(double time, double value)
+  {
+    if(std::isnan(value))
+      return;
+    expire(time);
+
+    samples_.push_back(Sample{time, value});
+    double delta = value - mean_;
+    mean_ += delta/samples_.size();
+    m2_ += delta*(value - mean_);
+
+    while(!minimums_.empty() && minimums_.back().value >= value)
+      minimums_.pop_back();
+    minimums_.push_back(Sample{time, value});
+    while(!maximums_.empty() && maximums_.back().value <= value)
+      maximums_.pop_back();
+    maximums_.push_back(Sample{time, value});
+
+    if(std::isnan(ewma_) || ewma_time_constant_ <= 0.0)
+      ewma_ = value;
+    else
+    {
+      double alpha = 1.0 - std::exp(-(time - last_.time)/ewma_time_constant_);
+      ewma_ += alpha*(value - ewma_);
+    }
+    last_ = samples_.back();
+  }
+
+  // Drops samples older than window before now. Called by add, readers
+  // only need it when samples may have stopped coming.
+  void expire(double now)
+  {
+    double start = now - window_;
+    while(!samples_.empty() && samples_.front().time < start)
+    {
+      double value = samples_.front().value;
+      samples_.pop_front();
+      if(samples_.empty())
+      {
+        mean_ = 0.0;
+        m2_ = 0.0;
+      }
+      else
+      {
+        double delta = value - mean_;
+        mean_ -= delta/samples_.size();
+        m2_ -= delta*(value - mean_);
+      }
+    }
+    while(!minimums_.empty() && minimums_.front().time < start)
+      minimums_.pop_front();
+    while(!maximums_.empty() && maximums_.front().time < start)
+      maximums_.pop_front();
+  }
+
+  void clear()
+  {
+    samples_.clear();
+    minimums_.clear();
+    maximums_.clear();
+    mean_ = 0.0;
+    m2_ = 0.0;
+    ewma_ = std::numeric_limits<double>::quiet_NaN();
+    last_ = Sample();
+  }
+
+  void setWindow(double window) {window_ = window;}
+  double window() const {return window_;}
+
+  std::size_t count() const {return samples_.size();}
+  bool empty() const {return samples_.empty();}
+
+  // NaN when empty.
+  double mean() const {return empty() ? nan() : mean_;}
+  double variance() const {return samples_.size() < 2 ? nan() : std::max(0.0, m2_/(samples_.size()-1));}
+  double standardDeviation() const {return std::sqrt(variance());}
+  double minimum() const {return minimums_.empty() ? nan() : minimums_.front().value;}
+  double maximum() const {return maximums_.empty() ? nan() : maximums_.front().value;}
+
+  // Kept across expiry, NaN until the first sample.
+  double ewma() const {return ewma_;}
+  double last() const {return last_.value;}
+  double lastTime() const {return last_.time;}
+
+private:
+  struct Sample
+  {
+    double time = std::numeric_limits<double>::quiet_NaN();
+    double value = std::numeric_limits<double>::quiet_NaN();
+  };
+
+  static double nan() {return std::numeric_limits<double>::quiet_NaN();}
+
+  double window_;
+  double ewma_time_constant_;
+
+  std::deque<Sample> samples_;
+  // Increasing and decreasing values, the fronts being the extremes.
+  std::deque<Sample> minimums_;
+  std::deque<Sample> maximums_;
+
+  double mean_ = 0.0;
+  // Sum of squared differences from the mean.
+  double m2_ = 0.0;
+
+  double ewma_ = std::numeric_limits<double>::quiet_NaN();
+  Sample last_;
+};
+
+// RollingStatistics of angles in degrees, averaged as unit vectors so
+// 359 and 1 average to 0.
+class RollingAngleStatistics
+{
+public:
+  explicit RollingAngleStatistics(double window = 60.0, double ewma_time_constant = 10.0):
+    x_(window, ewma_time_constant), y_(window, ewma_time_constant)
+  {
+  }
+
+  void add(double time, double degrees)
+  {
+    double radians = degrees*M_PI/180.0;
+    x_.add(time, std::cos(radians));
+    y_.add(time, std::sin(radians));
+  }
+
+  void expire(double now)
+  {
+    x_.expire(now);
+    y_.expire(now);
+  }
+
+  void clear()
+  {
+    x_.clear();
+    y_.clear();
+  }
+
+  std::size_t count() const {return x_.count();}
+  bool empty() const {return x_.empty();}
+
+  // In [0, 360), NaN when empty.
+  double mean() const {return toDegrees(x_.mean(), y_.mean());}
+  double ewma() const {return toDegrees(x_.ewma(), y_.ewma());}
+
+  // 0 when all angles agree, 1 when they cancel out.
+  double circularVariance() const {return 1.0 - std::hypot(x_.mean(), y_.mean());}
+
+private:
+  static double toDegrees(double x, double y)
+  {
+    if(std::isnan(x) || std::isnan(y))
+      return std::numeric_limits<double>::quiet_NaN();
+    double degrees = std::atan2(y, x)*180.0/M_PI;
+    if(degrees < 0.0)
+      degrees += 360.0;
+    // Tiny negative angles round to 360.
+    return degrees >= 360.0 ? 0.0 : degrees;
+  }
+
+  RollingStatistics x_;
+  RollingStatistics y_;
+};
+
+#endif
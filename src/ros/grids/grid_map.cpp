@@ -1,10 +1,11 @@
 #include "grid_map.h"
-#include <grid_map_ros/grid_map_ros.hpp>
 #include "../../map_view/web_mercator.h"
 #include <geometry_msgs/PoseStamped.h>
 #include "../node_manager.h"
 #include "gz4d_geo.h"
 #include <tf2/utils.h>
+#include <QMenu>
+#include <algorithm>
 
 namespace camp_ros
 {
@@ -14,95 +15,289 @@ GridMap::GridMap(MapItem* parent, NodeManager* node_manager, QString topic):
 {
   qRegisterMetaType<GridMapLayerData>("GridMapLayerData");
 
-  connect(this, &GridMap::newLayerData, this, &GridMap::updateGridLayer);
+  connect(this, &GridMap::layerDataAvailable, this, &GridMap::readMailboxes, Qt::QueuedConnection);
 
-  subscriber_ = ros::NodeHandle().subscribe(topic_, 10, &GridMap::gridMapCallback, this);
+  // Older messages are of no use once a newer one arrived.
+  subscriber_ = ros::NodeHandle().subscribe(topic_, 1, &GridMap::gridMapCallback, this);
   setStatus("[grid_map_msgs/GridMap]");
 }
 
+bool GridMap::publishLayerData(GridMapLayerData&& data)
+{
+  bool notify;
+  bool bounded = true;
+  {
+    std::lock_guard<std::mutex> lock(mailboxes_mutex_);
+    notify = mailboxes_[data.layer].put(std::move(data), [&bounded](GridMapLayerData& pending, GridMapLayerData&& data)
+    {
+      bounded = mergeLayerUpdate(pending.update, std::move(data.update));
+      pending.center = data.center;
+      pending.meters_per_pixel = data.meters_per_pixel;
+      pending.layers = data.layers;
+    });
+  }
+  if(notify)
+    emit layerDataAvailable();
+  return bounded;
+}
+
+void GridMap::readMailboxes()
+{
+  std::vector<GridMapLayerData> updates;
+  uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(mailboxes_mutex_);
+    for(auto& mailbox: mailboxes_)
+    {
+      GridMapLayerData data;
+      if(mailbox.second.take(data))
+        updates.push_back(std::move(data));
+      dropped += mailbox.second.dropped();
+    }
+  }
+  for(const auto& data: updates)
+    updateGridLayer(data);
+  if(dropped > 0)
+    setStatus(QString("[grid_map_msgs/GridMap] dropped: %1").arg(dropped));
+}
+
 void GridMap::updateGridLayer(const GridMapLayerData& data)
 {
-  QGraphicsPixmapItem* pixmap = nullptr;
-  for(auto child: childItems())
+  layers_ = data.layers;
+
+  auto& layer = layer_tiles_[data.layer];
+  const auto& update = data.update;
+  if(update.full)
+  {
+    if(update.patches.size() != 1)
+      return;
+    layer.tiles.setImage(update.patches.front());
+  }
+  else
   {
-    pixmap = qgraphicsitem_cast<QGraphicsPixmapItem*>(child);
-    if(pixmap)
-      break;
+    if(layer.tiles.rect().size() != update.size)
+      return;
+    layer.tiles.scroll(update.shift);
+    for(int i = 0; i < update.dirty_rects.size() && i < update.patches.size(); i++)
+      layer.tiles.update(update.patches[i], update.dirty_rects[i].topLeft());
   }
-  if(!pixmap)
-    pixmap = new QGraphicsPixmapItem(this);
+  layer.center = data.center;
+  layer.meters_per_pixel = data.meters_per_pixel;
 
-  QPixmap pm;
-  pm.convertFromImage(data.grid_image);
-  pixmap->setPixmap(pm);
+  std::string active_layer;
+  {
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    active_layer = active_layer_;
+  }
+  if(data.layer == active_layer)
+    showLayer(data.layer);
+}
 
-  auto map_distortion = web_mercator::metersPerUnit(data.center);
-  double scale = data.meters_per_pixel/map_distortion;
+void GridMap::showLayer(const std::string& layer_name)
+{
+  if(!tiles_item_)
+    tiles_item_ = new raster::TilePyramidItem(this);
 
-  pixmap->setTransform(QTransform::fromScale(scale, -scale));
-  QPointF position(data.center.x() - scale * data.grid_image.size().width()/2.0, data.center.y() + scale * data.grid_image.size().height()/2.0);
-  pixmap->setPos(position);
+  auto layer = layer_tiles_.find(layer_name);
+  if(layer == layer_tiles_.end())
+  {
+    tiles_item_->setPyramid(nullptr);
+    return;
+  }
+
+  tiles_item_->setPyramid(&layer->second.tiles);
+
+  auto map_distortion = web_mercator::metersPerUnit(layer->second.center);
+  double scale = layer->second.meters_per_pixel/map_distortion;
 
+  auto size = layer->second.tiles.rect().size();
+  tiles_item_->setTransform(QTransform::fromScale(scale, -scale));
+  QPointF position(layer->second.center.x() - scale * size.width()/2.0, layer->second.center.y() + scale * size.height()/2.0);
+  tiles_item_->setPos(position);
 }
 
-void GridMap::gridMapCallback(const grid_map_msgs::GridMap::ConstPtr &data)
+void GridMap::selectLayer(QString layer)
+{
+  {
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    active_layer_ = layer.toStdString();
+  }
+  showLayer(layer.toStdString());
+}
+
+void GridMap::contextMenu(QMenu* menu)
+{
+  std::string active_layer;
+  {
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    active_layer = active_layer_;
+  }
+  auto layers_menu = menu->addMenu("Layer");
+  for(auto layer: layers_)
+  {
+    auto action = layers_menu->addAction(layer);
+    action->setCheckable(true);
+    action->setChecked(layer.toStdString() == active_layer);
+    connect(action, &QAction::triggered, this, [this, layer](){selectLayer(layer);});
+  }
+
+  ColormapSettings settings;
+  {
+    std::lock_guard<std::mutex> lock(colormap_settings_mutex_);
+    settings = colormap_settings_[active_layer];
+  }
+  auto colors_menu = menu->addMenu("Colors");
+  auto default_action = colors_menu->addAction("Default");
+  default_action->setCheckable(true);
+  default_action->setChecked(settings.use_default);
+  connect(default_action, &QAction::triggered, this, [this](){selectPalette(-1);});
+  for(auto palette: colormap::palettes())
+  {
+    auto action = colors_menu->addAction(colormap::paletteName(palette));
+    action->setCheckable(true);
+    action->setChecked(!settings.use_default && settings.palette == palette);
+    connect(action, &QAction::triggered, this, [this, palette](){selectPalette(int(palette));});
+  }
+
+  auto range_menu = menu->addMenu("Range");
+  std::vector<std::pair<colormap::AutoRange::Mode, QString> > modes = {{colormap::AutoRange::Fixed, "Fixed"}, {colormap::AutoRange::MinMax, "Min/max"}, {colormap::AutoRange::Running, "Running min/max"}, {colormap::AutoRange::Percentile, "2-98 percentile"}};
+  for(auto mode: modes)
+  {
+    auto action = range_menu->addAction(mode.second);
+    action->setCheckable(true);
+    action->setChecked(!settings.use_default && settings.range_mode == mode.first);
+    connect(action, &QAction::triggered, this, [this, mode](){selectRangeMode(mode.first);});
+  }
+}
+
+void GridMap::applyColormapSettings(const std::string& layer, const ColormapSettings& settings, colormap::Colormap& colormap)
 {
-  grid_map::GridMap grid_map;
-  if(!grid_map::GridMapRosConverter::fromMessage(*data, grid_map))
+  colormap = colormap::Colormap();
+  if(settings.use_default)
   {
-    ROS_WARN_STREAM_THROTTLE(2.0, "Unable to convert GridMap message");
+    if(layer == "speed")
+    {
+      colormap.setPalette(colormap::Palette::Speed);
+      colormap.setRange(0.0, 3.0);
+      colormap.setUnderColor(qRgba(255, 0, 0, 255));
+      // NaN speeds have always drawn as zero speed.
+      colormap.setNanColor(qRgba(255, 255, 0, 255));
+    }
+    else
+      colormap.setPalette(colormap::Palette::Intensity);
     return;
   }
-  if(grid_map.getLayers().empty())
+  colormap.setPalette(settings.palette);
+  colormap.autoRange().setMode(settings.range_mode);
+}
+
+void GridMap::selectPalette(int palette)
+{
+  std::string layer;
   {
-    ROS_WARN_STREAM_THROTTLE(2.0, "Got GridMap message with no layers");
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    layer = active_layer_;
+  }
+  std::lock_guard<std::mutex> lock(colormap_settings_mutex_);
+  auto& settings = colormap_settings_[layer];
+  settings.use_default = palette < 0;
+  if(palette >= 0)
+    settings.palette = colormap::Palette(palette);
+}
+
+void GridMap::selectRangeMode(int mode)
+{
+  std::string layer;
+  {
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    layer = active_layer_;
+  }
+  std::lock_guard<std::mutex> lock(colormap_settings_mutex_);
+  auto& settings = colormap_settings_[layer];
+  settings.range_mode = colormap::AutoRange::Mode(mode);
+  // a range only makes sense with a palette
+  if(settings.use_default)
+  {
+    settings.use_default = false;
+    settings.palette = colormap::Palette::Viridis;
+  }
+}
+
+QVariant GridMap::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+  if(change == ItemVisibleHasChanged)
+    visible_ = value.toBool();
+  return Layer::itemChange(change, value);
+}
+
+void GridMap::gridMapCallback(const grid_map_msgs::GridMap::ConstPtr &data)
+{
+  if(!visible_)
+    return;
+  if(data->layers.empty() || data->layers.size() != data->data.size())
+  {
+    ROS_WARN_STREAM_THROTTLE(2.0, "Got GridMap message with no layers or mismatched data");
     return;
   }
+
   std::string layer;
-  for(auto l: grid_map.getLayers())
-    if(l == "speed")
+  {
+    std::lock_guard<std::mutex> lock(active_layer_mutex_);
+    if(active_layer_.empty())
     {
-      layer = l;
-      break;
+      active_layer_ = data->layers.front();
+      for(auto l: data->layers)
+        if(l == "speed")
+        {
+          active_layer_ = l;
+          break;
+        }
     }
-  if(layer.empty())
-   layer = grid_map.getLayers().front(); 
+    layer = active_layer_;
+  }
+  auto layer_index = std::find(data->layers.begin(), data->layers.end(), layer) - data->layers.begin();
+  if(layer_index == data->layers.size())
+    return;
+
   GridMapLayerData grid_data;
-  auto size = grid_map.getSize();
-  grid_data.grid_image = QImage(size.x(), size.y(), QImage::Format_ARGB32);
+  grid_data.layer = layer;
   grid_data.meters_per_pixel = data->info.resolution;
+  for(const auto& l: data->layers)
+    grid_data.layers.append(l.c_str());
 
-  if(layer == "speed")
-    for(grid_map::GridMapIterator iterator(grid_map); !iterator.isPastEnd(); ++iterator)
-    {
-      double value = grid_map.at(layer, *iterator);
-      if(value < 0.0)
-        grid_data.grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(255, 0, 0, 255));
-      else
-      {
-        uint8_t ival = std::min(1.0,std::max(0.0, value/3.0))*255;
-        grid_data.grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(255-ival, 255, 0, 255));
-      }
-    }
-  else
-    for(grid_map::GridMapIterator iterator(grid_map); !iterator.isPastEnd(); ++iterator)
-    {
-      double value = grid_map.at(layer, *iterator);
-      uint8_t ival = std::min(1.0,std::max(0.0, value))*255;
-      grid_data.grid_image.setPixelColor(QPoint(size.x()-1-iterator.getUnwrappedIndex().x(), iterator.getUnwrappedIndex().y()), QColor(0, ival, 0, ival));
-    }
+  ColormapSettings settings;
+  {
+    std::lock_guard<std::mutex> lock(colormap_settings_mutex_);
+    settings = colormap_settings_[layer];
+  }
+  auto& state = layer_states_[layer];
+  if(!state.configured || settings != state.applied_settings)
+  {
+    applyColormapSettings(layer, settings, state.colormap);
+    state.applied_settings = settings;
+    state.configured = true;
+  }
+
+  if(!state.cache.update(*data, layer_index, state.colormap, grid_data.update))
+  {
+    ROS_WARN_STREAM_THROTTLE(2.0, "Unable to read layer " << layer << " of grid_map " << topic_);
+    layer_states_.erase(layer);
+    return;
+  }
 
   try
   {
     grid_data.center = transformToWebMercator(data->info.pose, data->info.header);
-    emit newLayerData(grid_data);
+    // A full update replaces the pending one rather than adding to it.
+    if(!publishLayerData(std::move(grid_data)))
+      state.cache.invalidate();
   }
   catch (tf2::TransformException &ex)
   {
     ROS_WARN_STREAM_THROTTLE(2.0, "Unable to find transform to earth for grid_map " << topic_ << " at lookup time: "<< data->info.header.stamp << " now: " << ros::Time::now() << " source frame: " << data->info.header.frame_id << " what: " << ex.what());
+    // The cache moved on without the display, start over with the next message.
+    layer_states_.erase(layer);
   }
-
-  
 }
 
 
@@ -3,17 +3,37 @@
 
 #include "../layer.h"
 #include "grid_map_msgs/GridMap.h"
+#include "grid_map_layer_cache.h"
+#include "../../raster/tile_pyramid.h"
+#include "colormap/colormap.h"
+#include "latest_mailbox.h"
+#include <atomic>
+#include <mutex>
 
 namespace camp_ros
 {
 
 struct GridMapLayerData
 {
-  QImage grid_image;
+  std::string layer;
   QPointF center;
   float meters_per_pixel = 1.0;
+  GridMapLayerUpdate update;
+
+  // All the layers in the message.
+  QStringList layers;
 };
 
+// Displays one layer of a grid_map at a time.
+//
+// Only the selected layer is converted, and only while the item is visible.
+// The ROS callback keeps a GridMapLayerCache per layer and sends the changed
+// regions, which are applied to a tile pyramid kept per layer so switching
+// back to a layer shows its last image right away.
+//
+// Updates are handed to the GUI through a latest-only mailbox per layer.
+// When the GUI falls behind, pending updates are merged instead of queued
+// and the number of dropped updates is shown in the status.
 class GridMap: public Layer
 {
   Q_OBJECT
@@ -26,16 +46,79 @@ public:
   //void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
   
 signals:
-  void newLayerData(GridMapLayerData data);
+  void layerDataAvailable();
 
 public slots:
+  void readMailboxes();
   void updateGridLayer(const GridMapLayerData& data);
+  void selectLayer(QString layer);
+  void selectPalette(int palette);
+  void selectRangeMode(int mode);
+
+protected:
+  void contextMenu(QMenu* menu) override;
+  QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
   void gridMapCallback(const grid_map_msgs::GridMap::ConstPtr &data);
+  void showLayer(const std::string& layer);
+  // Returns false if the update was merged into an unread one that grew
+  // past the size of a full update.
+  bool publishLayerData(GridMapLayerData&& data);
   
   std::string topic_;
 
+  struct ColormapSettings
+  {
+    // Speed layers have their legacy colors by default, other layers are
+    // green over [0,1].
+    bool use_default = true;
+    colormap::Palette palette = colormap::Palette::Viridis;
+    colormap::AutoRange::Mode range_mode = colormap::AutoRange::Fixed;
+
+    bool operator!=(const ColormapSettings& other) const
+    {
+      return use_default != other.use_default || palette != other.palette || range_mode != other.range_mode;
+    }
+  };
+
+  void applyColormapSettings(const std::string& layer, const ColormapSettings& settings, colormap::Colormap& colormap);
+
+  struct LayerState
+  {
+    GridMapLayerCache cache;
+    colormap::Colormap colormap;
+    ColormapSettings applied_settings;
+    bool configured = false;
+  };
+
+  // Used by the ROS callback.
+  std::map<std::string, LayerState> layer_states_;
+
+  // Per layer, set from the GUI.
+  std::map<std::string, ColormapSettings> colormap_settings_;
+  std::mutex colormap_settings_mutex_;
+
+  // Selected layer, empty until the first message picks a default.
+  std::string active_layer_;
+  std::mutex active_layer_mutex_;
+
+  std::atomic<bool> visible_ {true};
+
+  std::map<std::string, LatestMailbox<GridMapLayerData> > mailboxes_;
+  std::mutex mailboxes_mutex_;
+
+  struct LayerTiles
+  {
+    raster::TilePyramid tiles;
+    QPointF center;
+    float meters_per_pixel = 1.0;
+  };
+
+  // Used by the GUI thread.
+  std::map<std::string, LayerTiles> layer_tiles_;
+  QStringList layers_;
+  raster::TilePyramidItem* tiles_item_ = nullptr;
 };
 
 } // namespace camp_ros
@@ -0,0 +1,235 @@
+#include "grid_map_layer_cache.h"
+#include "colormap/colormap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <QPainter>
+
+namespace camp_ros
+{
+
+void GridMapLayerCache::unwrapLine(const float* data, int line)
+{
+  // Matrix rows go along decreasing x, the image's lines go left to right.
+  const float* column = data + std::size_t((line+start_col_)%cols_)*rows_;
+  std::copy(column+start_row_, column+rows_, line_.begin());
+  std::copy(column, column+start_row_, line_.begin()+rows_-start_row_);
+  std::reverse(line_.begin(), line_.end());
+}
+
+bool GridMapLayerCache::shift(const grid_map_msgs::GridMapInfo& info, QPoint& shift)
+{
+  // Moving the map by whole cells in +x moves the content left, and in +y
+  // moves it down as lines go along decreasing y.
+  double dx = (info.pose.position.x - x_)/resolution_;
+  double dy = (info.pose.position.y - y_)/resolution_;
+  int cx = std::round(dx);
+  int cy = std::round(dy);
+  if(std::abs(dx-cx) > 0.01 || std::abs(dy-cy) > 0.01)
+    return false;
+  if(std::abs(cx) >= rows_ || std::abs(cy) >= cols_)
+    return false;
+  shift = QPoint(-cx, cy);
+  if(shift.isNull())
+    return true;
+
+  auto bytes_per_line = image_.bytesPerLine();
+  uchar* bits = image_.bits();
+  auto move_line = [&](int from, int to)
+  {
+    int sx = std::max(0, -shift.x());
+    int dx = std::max(0, shift.x());
+    int count = rows_-std::abs(shift.x());
+    std::memmove(bits+to*bytes_per_line+dx*sizeof(QRgb), bits+from*bytes_per_line+sx*sizeof(QRgb), count*sizeof(QRgb));
+    std::memmove(&values_[to*rows_+dx], &values_[from*rows_+sx], count*sizeof(float));
+  };
+  if(shift.y() > 0)
+    for(int to = cols_-1; to >= shift.y(); to--)
+      move_line(to-shift.y(), to);
+  else
+    for(int to = 0; to < cols_+shift.y(); to++)
+      move_line(to-shift.y(), to);
+  return true;
+}
+
+bool GridMapLayerCache::update(const grid_map_msgs::GridMap& message, int layer_index, colormap::Colormap& colormap, GridMapLayerUpdate& update)
+{
+  const auto& array = message.data[layer_index];
+  if(array.layout.dim.size() < 2 || array.layout.dim[0].label != "column_index")
+    return false;
+  int cols = array.layout.dim[0].size;
+  int rows = array.layout.dim[1].size;
+  if(rows <= 0 || cols <= 0 || array.data.size() < array.layout.data_offset + std::size_t(rows)*cols)
+    return false;
+  const float* data = array.data.data() + array.layout.data_offset;
+  colormap.updateRange(data, std::size_t(rows)*cols);
+  const auto& lut = colormap.lut();
+
+  bool full = rows != rows_ || cols != cols_ || message.info.resolution != resolution_ || message.info.header.frame_id != frame_id_ || colormap.version() != colormap_version_;
+  QPoint shift;
+  if(!full)
+    full = !this->shift(message.info, shift);
+
+  rows_ = rows;
+  cols_ = cols;
+  start_row_ = message.outer_start_index;
+  start_col_ = message.inner_start_index;
+  if(start_row_ < 0 || start_row_ >= rows_ || start_col_ < 0 || start_col_ >= cols_)
+    start_row_ = start_col_ = 0;
+  resolution_ = message.info.resolution;
+  frame_id_ = message.info.header.frame_id;
+  x_ = message.info.pose.position.x;
+  y_ = message.info.pose.position.y;
+  colormap_version_ = colormap.version();
+  line_.resize(rows_);
+
+  update.size = QSize(rows_, cols_);
+  update.full = full;
+  update.shift = shift;
+  update.dirty_rects.clear();
+  update.patches.clear();
+
+  if(full)
+  {
+    image_ = QImage(rows_, cols_, QImage::Format_ARGB32);
+    values_.resize(std::size_t(rows_)*cols_);
+    for(int i = 0; i < cols_; i++)
+    {
+      unwrapLine(data, i);
+      std::copy(line_.begin(), line_.end(), values_.begin()+std::size_t(i)*rows_);
+      lut.colorize(line_.data(), reinterpret_cast<QRgb*>(image_.scanLine(i)), rows_);
+    }
+    update.dirty_rects.push_back(image_.rect());
+    update.patches.push_back(image_);
+    return true;
+  }
+
+  // Columns exposed on every line by a horizontal shift.
+  int exposed_begin = shift.x() > 0 ? 0 : rows_+shift.x();
+  int exposed_end = shift.x() > 0 ? shift.x() : rows_;
+
+  // Lines with the same dirty span are grouped in a rect.
+  QRect current;
+  for(int i = 0; i < cols_; i++)
+  {
+    unwrapLine(data, i);
+    float* cached = &values_[std::size_t(i)*rows_];
+    int begin = rows_;
+    int end = 0;
+    if(i < shift.y() || i >= cols_+shift.y())
+    {
+      begin = 0;
+      end = rows_;
+    }
+    else
+    {
+      if(exposed_begin < exposed_end)
+      {
+        begin = exposed_begin;
+        end = exposed_end;
+      }
+      if(std::memcmp(cached, line_.data(), rows_*sizeof(float)) != 0)
+      {
+        int first = 0;
+        while(std::memcmp(&cached[first], &line_[first], sizeof(float)) == 0)
+          first++;
+        int last = rows_-1;
+        while(std::memcmp(&cached[last], &line_[last], sizeof(float)) == 0)
+          last--;
+        begin = std::min(begin, first);
+        end = std::max(end, last+1);
+      }
+    }
+
+    if(begin < end)
+    {
+      std::copy(line_.begin()+begin, line_.begin()+end, cached+begin);
+      lut.colorize(&line_[begin], reinterpret_cast<QRgb*>(image_.scanLine(i))+begin, end-begin);
+    }
+
+    QRect span = begin < end ? QRect(begin, i, end-begin, 1) : QRect();
+    if(!current.isNull() && (span.isNull() || span.left() != current.left() || span.right() != current.right()))
+    {
+      update.dirty_rects.push_back(current);
+      current = QRect();
+    }
+    current = current.isNull() ? span : current.united(span);
+  }
+  if(!current.isNull())
+    update.dirty_rects.push_back(current);
+
+  // Many small rects cost more to apply than a bigger one.
+  if(update.dirty_rects.size() > 16)
+  {
+    QRect bounds;
+    for(const auto& r: update.dirty_rects)
+      bounds |= r;
+    update.dirty_rects = {bounds};
+  }
+  for(const auto& r: update.dirty_rects)
+    update.patches.push_back(image_.copy(r));
+  return true;
+}
+
+bool mergeLayerUpdate(GridMapLayerUpdate& pending, GridMapLayerUpdate&& update)
+{
+  if(update.full || pending.size != update.size)
+  {
+    pending = std::move(update);
+    return true;
+  }
+
+  QRect bounds(QPoint(), update.size);
+  if(pending.full)
+  {
+    // Apply the update to the pending image directly.
+    if(pending.patches.size() != 1)
+      return true;
+    QImage& image = pending.patches.front();
+    if(!update.shift.isNull())
+    {
+      QImage shifted(image.size(), image.format());
+      shifted.fill(Qt::transparent);
+      QPainter painter(&shifted);
+      painter.setCompositionMode(QPainter::CompositionMode_Source);
+      painter.drawImage(update.shift, image);
+      painter.end();
+      image = shifted;
+    }
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for(int i = 0; i < update.dirty_rects.size() && i < update.patches.size(); i++)
+      painter.drawImage(update.dirty_rects[i].topLeft(), update.patches[i]);
+    return true;
+  }
+
+  // Move the pending patches along with the image, cropping what scrolled out.
+  QVector<QRect> rects;
+  QVector<QImage> patches;
+  for(int i = 0; i < pending.dirty_rects.size() && i < pending.patches.size(); i++)
+  {
+    QRect moved = pending.dirty_rects[i].translated(update.shift);
+    QRect visible = moved & bounds;
+    if(visible.isEmpty())
+      continue;
+    if(std::any_of(update.dirty_rects.begin(), update.dirty_rects.end(), [&](const QRect& r){return r.contains(visible);}))
+      continue;
+    rects.append(visible);
+    if(visible == moved)
+      patches.append(pending.patches[i]);
+    else
+      patches.append(pending.patches[i].copy(visible.translated(-moved.topLeft())));
+  }
+  rects += update.dirty_rects;
+  patches += update.patches;
+  pending.shift += update.shift;
+  pending.dirty_rects = rects;
+  pending.patches = patches;
+
+  qint64 area = 0;
+  for(const auto& r: rects)
+    area += qint64(r.width())*r.height();
+  return area <= qint64(bounds.width())*bounds.height();
+}
+
+} // namespace camp_ros
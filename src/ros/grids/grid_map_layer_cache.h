@@ -0,0 +1,85 @@
+#ifndef CAMP_ROS_GRIDS_GRID_MAP_LAYER_CACHE_H
+#define CAMP_ROS_GRIDS_GRID_MAP_LAYER_CACHE_H
+
+#include <QImage>
+#include <QVector>
+#include "grid_map_msgs/GridMap.h"
+
+namespace colormap
+{
+  class Colormap;
+}
+
+namespace camp_ros
+{
+
+// Changes to apply to a layer's image since the previous update.
+struct GridMapLayerUpdate
+{
+  // Size of the whole layer image.
+  QSize size;
+
+  // When true, the single patch is the whole image. Otherwise the previous
+  // image is scrolled by shift, in pixels, then the patches are copied over.
+  bool full = true;
+  QPoint shift;
+  QVector<QRect> dirty_rects;
+  QVector<QImage> patches;
+};
+
+// Folds update, which follows pending, into pending so applying the result
+// gives the same image as applying both. Pending patches the update covers
+// are dropped. Returns false once the patches outgrow the whole image, in
+// which case the producer should make its next update a full one, which
+// replaces pending.
+bool mergeLayerUpdate(GridMapLayerUpdate& pending, GridMapLayerUpdate&& update);
+
+// Colorized image of a single grid_map layer along with the values it was
+// made from, so following messages only recolor what changed.
+//
+// A rolling map that moved by whole cells has its image scrolled, then the
+// newly exposed strips and the cells whose values differ, found by
+// comparing rows of values, are recolored. Layer data is read straight from
+// the message's Float32MultiArray, honoring the circular buffer start
+// indices, without converting the other layers.
+class GridMapLayerCache
+{
+public:
+  // Returns false if the layer's data is malformed. An update with no dirty
+  // rects means nothing changed. The colormap's auto range is updated from
+  // the layer, the whole layer being recolored if that changes it.
+  bool update(const grid_map_msgs::GridMap& message, int layer_index, colormap::Colormap& colormap, GridMapLayerUpdate& update);
+
+  // Makes the next update a full one.
+  void invalidate() {rows_ = 0;}
+
+private:
+  // Copies a column of the circular buffer as a line of the image, in image
+  // order, into line_.
+  void unwrapLine(const float* data, int line);
+
+  // Moves the cached image and values, leaving stale content where cells
+  // were exposed. Returns false if nothing would be left to reuse.
+  bool shift(const grid_map_msgs::GridMapInfo& info, QPoint& shift);
+
+  // Rows (x) and cols (y) of the grid_map, the image is rows wide.
+  int rows_ = 0;
+  int cols_ = 0;
+  int start_row_ = 0;
+  int start_col_ = 0;
+  double resolution_ = 0.0;
+  std::string frame_id_;
+  double x_ = 0.0;
+  double y_ = 0.0;
+  // Version of the colormap the image was made with.
+  quint64 colormap_version_ = 0;
+
+  QImage image_;
+  // Image order, line by line.
+  std::vector<float> values_;
+  std::vector<float> line_;
+};
+
+} // namespace camp_ros
+
+#endif
@@ -1,5 +1,6 @@
 #include "marker.h"
-#include <QTimer>
+#include "marker_item_pool.h"
+#include "marker_list_item.h"
 #include <QPainter>
 #include <QGraphicsScene>
 #include "../../map_view/web_mercator.h"
@@ -7,91 +8,120 @@
 namespace camp_ros
 {
 
-Marker::Marker(MapItem* parent, NodeManager* node_manager, uint32_t id):
-  Layer(parent, node_manager, QString::number(id)), id_(id)
+Marker::Marker(MapItem* parent, NodeManager* node_manager, uint32_t id, MarkerItemPool* item_pool):
+  Layer(parent, node_manager, QString::number(id)), id_(id), item_pool_(item_pool)
 {
-  QTimer* timer = new QTimer(this);
-  connect(timer, &QTimer::timeout, this, &Marker::checkExpired);
-  timer->start(1000);
 }
 
-void Marker::updateMarker(const MarkerData& data)
+template<typename T> T* Marker::item(std::size_t index)
 {
-  for(auto child: childItems())
+  if(index < items_.size())
   {
-    if(child->scene())
-      child->scene()->removeItem(child);
-    delete child;
+    auto existing = qgraphicsitem_cast<T*>(items_[index]);
+    if(existing)
+      return existing;
+    item_pool_->release(items_[index]);
   }
-  if(data.marker.action == visualization_msgs::Marker::ADD)
+  else
+    items_.resize(index+1);
+  auto ret = item_pool_->take<T>(this);
+  items_[index] = ret;
+  return ret;
+}
+
+void Marker::releaseItems(std::size_t index)
+{
+  for(auto i = index; i < items_.size(); i++)
+    item_pool_->release(items_[i]);
+  if(index < items_.size())
+    items_.resize(index);
+}
+
+void Marker::updateMarker(const MarkerData& data)
+{
+  if(data.marker.action != visualization_msgs::Marker::ADD)
   {
-    setPos(data.position);
-    auto map_distortion = web_mercator::metersPerUnit(data.position);
-    double scale = 1.0/map_distortion;
-    setTransform(QTransform::fromScale(scale, scale));
+    releaseItems(0);
+    data_ = data;
+    return;
+  }
 
-    setRotation(data.rotation*180.0/M_PI);
-    QPen p;
-    p.setColor(QColor::fromRgbF(data.marker.color.r, data.marker.color.g, data.marker.color.b, data.marker.color.a));
-    p.setCosmetic(true);
-    QBrush b;
-    b.setColor(QColor::fromRgbF(data.marker.color.r, data.marker.color.g, data.marker.color.b, data.marker.color.a));
-    b.setStyle(Qt::BrushStyle::SolidPattern);
+  setPos(data.position);
+  auto map_distortion = web_mercator::metersPerUnit(data.position);
+  double scale = 1.0/map_distortion;
+  setTransform(QTransform::fromScale(scale, scale));
 
-    switch(data.marker.type)
+  setRotation(data.rotation*180.0/M_PI);
+  QPen p;
+  p.setColor(QColor::fromRgbF(data.marker.color.r, data.marker.color.g, data.marker.color.b, data.marker.color.a));
+  p.setCosmetic(true);
+  QBrush b;
+  b.setColor(QColor::fromRgbF(data.marker.color.r, data.marker.color.g, data.marker.color.b, data.marker.color.a));
+  b.setStyle(Qt::BrushStyle::SolidPattern);
+
+  std::size_t used = 0;
+  switch(data.marker.type)
+  {
+    case visualization_msgs::Marker::CUBE:
     {
-      case visualization_msgs::Marker::CUBE:
-      {
-        auto cube = new QGraphicsRectItem(0, 0, data.marker.scale.x, data.marker.scale.y, this);
-        cube->setPen(p);
-        cube->setBrush(b);
-        break;
-      }
-      case visualization_msgs::Marker::SPHERE:
-      {
-        auto sphere = new QGraphicsEllipseItem(0,0,data.marker.scale.x, data.marker.scale.y, this);
-        sphere->setPen(p);
-        sphere->setBrush(b);
-        break;
-      }
-      case visualization_msgs::Marker::LINE_STRIP:
-      case visualization_msgs::Marker::LINE_LIST:
-      {
-        for(auto p1 = data.marker.points.begin(); p1 != data.marker.points.end(); ++p1)
-        {
-          auto p2 = p1;
-          p2++;
-          if(p2 != data.marker.points.end())
-          {
-            auto cosmetic_line = new QGraphicsLineItem(p1->x, p1->y, p2->x, p2->y, this);
-            p.setWidthF(2.0);
-            p.setCosmetic(true);
-            cosmetic_line->setPen(p);
-            auto line = new QGraphicsLineItem(p1->x, p1->y, p2->x, p2->y, this);
-            p.setWidthF(data.marker.scale.x);
-            p.setCosmetic(false);
-            line->setPen(p);
-            // \todo use colors field to add gradients for per vertex colors
-          }
-          if(data.marker.type == visualization_msgs::Marker::LINE_LIST)
-          {
-            p1++;
-            if(p1 == data.marker.points.end())
-              break;
-          }
-        }
-        break;
-      }
-      case visualization_msgs::Marker::TEXT_VIEW_FACING:
+      auto cube = item<QGraphicsRectItem>(used++);
+      cube->setRect(0, 0, data.marker.scale.x, data.marker.scale.y);
+      cube->setPen(p);
+      cube->setBrush(b);
+      break;
+    }
+    case visualization_msgs::Marker::SPHERE:
+    {
+      auto sphere = item<QGraphicsEllipseItem>(used++);
+      sphere->setRect(0, 0, data.marker.scale.x, data.marker.scale.y);
+      sphere->setPen(p);
+      sphere->setBrush(b);
+      break;
+    }
+    case visualization_msgs::Marker::LINE_STRIP:
+    case visualization_msgs::Marker::LINE_LIST:
+    {
+      // One path for all the segments, drawn with a thin cosmetic pen so it
+      // remains visible when zoomed out, then with the marker's width.
+      QPainterPath path;
+      bool list = data.marker.type == visualization_msgs::Marker::LINE_LIST;
+      const auto& points = data.marker.points;
+      for(std::size_t i = 0; i+1 < points.size(); i += list ? 2 : 1)
       {
-        auto text = new QGraphicsSimpleTextItem(data.marker.text.c_str(), this);
-        text->setBrush(b);
-        break;
+        if(list || i == 0)
+          path.moveTo(points[i].x, points[i].y);
+        path.lineTo(points[i+1].x, points[i+1].y);
+        // \todo use colors field to add gradients for per vertex colors
       }
-      default:
-        ROS_WARN_STREAM("marker type not handles: " << data_.marker.type);
+      auto cosmetic_line = item<QGraphicsPathItem>(used++);
+      p.setWidthF(2.0);
+      p.setCosmetic(true);
+      cosmetic_line->setPen(p);
+      cosmetic_line->setPath(path);
+      auto line = item<QGraphicsPathItem>(used++);
+      p.setWidthF(data.marker.scale.x);
+      p.setCosmetic(false);
+      line->setPen(p);
+      line->setPath(path);
+      break;
     }
+    case visualization_msgs::Marker::POINTS:
+    case visualization_msgs::Marker::CUBE_LIST:
+    case visualization_msgs::Marker::SPHERE_LIST:
+    case visualization_msgs::Marker::TRIANGLE_LIST:
+      item<MarkerListItem>(used++)->setMarker(data.marker);
+      break;
+    case visualization_msgs::Marker::TEXT_VIEW_FACING:
+    {
+      auto text = item<QGraphicsSimpleTextItem>(used++);
+      text->setText(data.marker.text.c_str());
+      text->setBrush(b);
+      break;
+    }
+    default:
+      ROS_WARN_STREAM("marker type not handles: " << data.marker.type);
   }
+  releaseItems(used);
   data_ = data;
 }
 
@@ -100,18 +130,4 @@ uint32_t Marker::id() const
   return id_;
 }
 
-void Marker::checkExpired()
-{
-  auto now = ros::Time::now();
-  bool expired = !data_.marker.header.stamp.isZero() && !data_.marker.lifetime.isZero()&& data_.marker.header.stamp + data_.marker.lifetime < now;
-  expired |= data_.marker.action != 0; // consider deleted as expired
-  if(expired)
-    for(auto child: childItems())
-    {
-      if(child->scene())
-        child->scene()->removeItem(child);
-      delete child;
-    }
-}
-
 } // namespace camp_ros
@@ -7,12 +7,18 @@
 namespace camp_ros
 {
 
+class MarkerItemPool;
+
+// A single visualization marker.
+//
+// Republishing a marker updates its child items in place when they are of
+// the right type, others are returned to the pool.
 class Marker: public Layer
 {
   Q_OBJECT
   Q_INTERFACES(QGraphicsItem)
 public:
-  Marker(MapItem* parent, NodeManager* node_manager, uint32_t id);
+  Marker(MapItem* parent, NodeManager* node_manager, uint32_t id, MarkerItemPool* item_pool);
 
   enum { Type =  map::MarkerType };
 
@@ -24,16 +30,21 @@ public:
 
   uint32_t id() const;
 
+  // Returns the child items starting at index to the pool.
+  void releaseItems(std::size_t index = 0);
+
 public slots:
   void updateMarker(const MarkerData& data);
 
-private slots:
-  void checkExpired();
-
 private:
+  // Returns the child item at index, taking one from the pool if there is
+  // none or if it's of another type.
+  template<typename T> T* item(std::size_t index);
+
   uint32_t id_ = 0;
+  MarkerItemPool* item_pool_ = nullptr;
+  std::vector<QGraphicsItem*> items_;
   MarkerData data_;
-  bool expired_ = false;
 
 };
 
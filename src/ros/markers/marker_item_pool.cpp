@@ -0,0 +1,31 @@
+#include "marker_item_pool.h"
+#include "marker_list_item.h"
+#include <QGraphicsScene>
+
+namespace camp_ros
+{
+
+MarkerItemPool::~MarkerItemPool()
+{
+  for(auto& items: items_)
+    for(auto item: items.second)
+      delete item;
+}
+
+void MarkerItemPool::release(QGraphicsItem* item)
+{
+  item->setParentItem(nullptr);
+  if(item->scene())
+    item->scene()->removeItem(item);
+  auto& items = items_[item->type()];
+  if(items.size() >= max_items_)
+  {
+    delete item;
+    return;
+  }
+  if(item->type() == MarkerListItem::Type)
+    static_cast<MarkerListItem*>(item)->clear();
+  items.push_back(item);
+}
+
+} // namespace camp_ros
@@ -0,0 +1,45 @@
+#ifndef CAMP_ROS_MARKERS_MARKER_ITEM_POOL_H
+#define CAMP_ROS_MARKERS_MARKER_ITEM_POOL_H
+
+#include <QGraphicsItem>
+#include <map>
+#include <vector>
+
+namespace camp_ros
+{
+
+// Graphics items no longer used by a marker, kept per item type so the
+// next marker needing one doesn't allocate it.
+//
+// Pooled items are out of the scene and have no parent.
+class MarkerItemPool
+{
+public:
+  ~MarkerItemPool();
+
+  // Returns an item of type T parented to parent, reused if possible.
+  template<typename T> T* take(QGraphicsItem* parent)
+  {
+    auto& items = items_[T::Type];
+    if(items.empty())
+      return new T(parent);
+    auto item = static_cast<T*>(items.back());
+    items.pop_back();
+    item->setParentItem(parent);
+    return item;
+  }
+
+  // Detaches item and keeps it for reuse, or deletes it if the pool for its
+  // type is full.
+  void release(QGraphicsItem* item);
+
+private:
+  std::map<int, std::vector<QGraphicsItem*> > items_;
+
+  // Items kept per type.
+  std::size_t max_items_ = 1024;
+};
+
+} // namespace camp_ros
+
+#endif
@@ -0,0 +1,159 @@
+#include "marker_list_item.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace camp_ros
+{
+
+namespace
+{
+
+// 5 bits per channel, enough for colormapped clouds.
+QRgb quantize(const std_msgs::ColorRGBA& color)
+{
+  auto q = [](float c)
+  {
+    int v = std::max(0, std::min(31, int(c*31.0f+0.5f)));
+    return (v << 3) | (v >> 2);
+  };
+  return qRgba(q(color.r), q(color.g), q(color.b), q(color.a));
+}
+
+} // namespace
+
+MarkerListItem::MarkerListItem(QGraphicsItem* parent):
+  QGraphicsItem(parent)
+{
+}
+
+QRectF MarkerListItem::boundingRect() const
+{
+  return bounds_;
+}
+
+void MarkerListItem::clear()
+{
+  prepareGeometryChange();
+  std::vector<Bucket>().swap(buckets_);
+  bounds_ = QRectF();
+}
+
+void MarkerListItem::setMarker(const visualization_msgs::Marker& marker)
+{
+  prepareGeometryChange();
+  type_ = marker.type;
+  element_size_ = QSizeF(marker.scale.x, marker.scale.y);
+  buckets_.clear();
+  bounds_ = QRectF();
+
+  const auto& points = marker.points;
+  bool per_point_colors = marker.colors.size() == points.size();
+  int stride = type_ == visualization_msgs::Marker::TRIANGLE_LIST ? 3 : 1;
+
+  std::unordered_map<QRgb, std::size_t> bucket_indexes;
+  QRgb marker_color = quantize(marker.color);
+  double min_x = std::numeric_limits<double>::max();
+  double min_y = min_x;
+  double max_x = std::numeric_limits<double>::lowest();
+  double max_y = max_x;
+  for(std::size_t i = 0; i+stride <= points.size(); i += stride)
+  {
+    QRgb color = per_point_colors ? quantize(marker.colors[i]) : marker_color;
+    auto index = bucket_indexes.find(color);
+    if(index == bucket_indexes.end())
+    {
+      index = bucket_indexes.emplace(color, buckets_.size()).first;
+      buckets_.emplace_back();
+      buckets_.back().color = QColor::fromRgba(color);
+    }
+    Bucket& bucket = buckets_[index->second];
+
+    for(int j = 0; j < stride; j++)
+    {
+      min_x = std::min(min_x, points[i+j].x);
+      max_x = std::max(max_x, points[i+j].x);
+      min_y = std::min(min_y, points[i+j].y);
+      max_y = std::max(max_y, points[i+j].y);
+    }
+
+    QPointF p(points[i].x, points[i].y);
+    QRectF element(p.x()-element_size_.width()/2.0, p.y()-element_size_.height()/2.0, element_size_.width(), element_size_.height());
+    switch(type_)
+    {
+      case visualization_msgs::Marker::POINTS:
+        bucket.points.append(p);
+        break;
+      case visualization_msgs::Marker::CUBE_LIST:
+        bucket.points.append(p);
+        bucket.rects.append(element);
+        break;
+      case visualization_msgs::Marker::SPHERE_LIST:
+        bucket.points.append(p);
+        bucket.path.addEllipse(element);
+        break;
+      case visualization_msgs::Marker::TRIANGLE_LIST:
+        bucket.path.moveTo(p);
+        bucket.path.lineTo(points[i+1].x, points[i+1].y);
+        bucket.path.lineTo(points[i+2].x, points[i+2].y);
+        bucket.path.closeSubpath();
+        break;
+    }
+  }
+
+  if(buckets_.empty())
+    return;
+  bounds_ = QRectF(QPointF(min_x, min_y), QPointF(max_x, max_y));
+  if(type_ != visualization_msgs::Marker::TRIANGLE_LIST)
+  {
+    double w = element_size_.width()/2.0;
+    double h = element_size_.height()/2.0;
+    bounds_.adjust(-w, -h, w, h);
+  }
+  update();
+}
+
+void MarkerListItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  if(buckets_.empty())
+    return;
+
+  painter->save();
+  auto lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  // Elements smaller than a couple of pixels are drawn as points so they
+  // remain visible.
+  bool as_points = type_ != visualization_msgs::Marker::TRIANGLE_LIST && std::max(element_size_.width(), element_size_.height())*lod < 2.0;
+
+  QPen pen;
+  pen.setCapStyle(Qt::SquareCap);
+  if(as_points)
+  {
+    pen.setCosmetic(true);
+    pen.setWidthF(2.0);
+  }
+  else
+    pen.setWidthF(element_size_.width());
+  for(const auto& bucket: buckets_)
+  {
+    if(as_points || type_ == visualization_msgs::Marker::POINTS)
+    {
+      pen.setColor(bucket.color);
+      painter->setPen(pen);
+      painter->drawPoints(bucket.points.data(), bucket.points.size());
+    }
+    else
+    {
+      painter->setPen(Qt::NoPen);
+      painter->setBrush(bucket.color);
+      if(type_ == visualization_msgs::Marker::CUBE_LIST)
+        painter->drawRects(bucket.rects.data(), bucket.rects.size());
+      else
+        painter->drawPath(bucket.path);
+    }
+  }
+  painter->restore();
+}
+
+} // namespace camp_ros
@@ -0,0 +1,60 @@
+#ifndef CAMP_ROS_MARKERS_MARKER_LIST_ITEM_H
+#define CAMP_ROS_MARKERS_MARKER_LIST_ITEM_H
+
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <visualization_msgs/Marker.h>
+#include "../../map/item_types.h"
+
+namespace camp_ros
+{
+
+// Draws the elements of a POINTS, CUBE_LIST, SPHERE_LIST or TRIANGLE_LIST
+// marker without an item per element.
+//
+// Elements are bucketed by color, per point colors being quantized to keep
+// the number of buckets small, and each bucket is drawn with a single
+// painter call.
+class MarkerListItem: public QGraphicsItem
+{
+public:
+  MarkerListItem(QGraphicsItem* parent = nullptr);
+
+  enum { Type = map::MarkerListType };
+
+  int type() const override
+  {
+    // Enable the use of qgraphicsitem_cast with this item.
+    return Type;
+  }
+
+  QRectF boundingRect() const override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+  // Rebuilds the buckets from a list type marker, in the marker's frame.
+  void setMarker(const visualization_msgs::Marker& marker);
+
+  // Frees the buckets, so a pooled item doesn't hold on to a large cloud.
+  void clear();
+
+private:
+  struct Bucket
+  {
+    QColor color;
+    // Element centers, used when drawn as points.
+    QVector<QPointF> points;
+    // Cubes.
+    QVector<QRectF> rects;
+    // Spheres and triangles.
+    QPainterPath path;
+  };
+
+  int32_t type_ = visualization_msgs::Marker::POINTS;
+  QSizeF element_size_;
+  std::vector<Bucket> buckets_;
+  QRectF bounds_;
+};
+
+} // namespace camp_ros
+
+#endif
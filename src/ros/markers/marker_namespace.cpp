@@ -1,42 +1,91 @@
 #include "marker_namespace.h"
 #include "marker.h"
+#include "timing_wheel.h"
+#include "../../map/map.h"
 
 namespace camp_ros
 {
 
-MarkerNamespace::MarkerNamespace(MapItem* parent, NodeManager* node_manager, QString marker_namespace):
-  Layer(parent, node_manager, marker_namespace)
+MarkerNamespace::MarkerNamespace(MapItem* parent, NodeManager* node_manager, QString marker_namespace, MarkerItemPool* item_pool, TimingWheel* expiry_wheel):
+  Layer(parent, node_manager, marker_namespace), item_pool_(item_pool), expiry_wheel_(expiry_wheel)
 {
 }
 
 void MarkerNamespace::updateMarker(const MarkerData& data)
 {
-  auto markers_map = markers();
-  if(data.marker.action == visualization_msgs::Marker::DELETEALL)
+  switch(data.marker.action)
   {
-    for(auto m: markers_map)
-      m.second->updateMarker(data);
-    return;
+    case visualization_msgs::Marker::DELETEALL:
+      clear();
+      return;
+    case visualization_msgs::Marker::DELETE:
+    {
+      auto marker = markers_.find(data.marker.id);
+      if(marker != markers_.end())
+        removeMarker(marker);
+      return;
+    }
   }
 
-  Marker* marker = nullptr;
-  if(markers_map.find(data.marker.id) == markers_map.end())
-    marker = new Marker(this, node_manager_, data.marker.id);
-  else
-    marker = markers_map[data.marker.id];
-  marker->updateMarker(data);
+  auto id = data.marker.id;
+  auto& entry = markers_[id];
+  if(!entry.marker)
+    entry.marker = new Marker(this, node_manager_, id, item_pool_);
+  entry.marker->updateMarker(data);
+
+  expiry_wheel_->cancel(entry.expiry);
+  entry.expiry = 0;
+  if(!data.marker.header.stamp.isZero() && !data.marker.lifetime.isZero())
+    entry.expiry = expiry_wheel_->schedule(data.marker.header.stamp + data.marker.lifetime, [this, id]()
+    {
+      expireMarker(id);
+    });
+}
+
+void MarkerNamespace::expireMarker(uint32_t id)
+{
+  auto marker = markers_.find(id);
+  if(marker != markers_.end())
+  {
+    marker->second.expiry = 0;
+    removeMarker(marker);
+  }
 }
 
-std::map<uint32_t, Marker*> MarkerNamespace::markers() const
+void MarkerNamespace::clear()
 {
-  std::map<uint32_t, Marker*> markers;
-  for(auto item: childItems())
+  for(auto marker: markers_)
   {
-    auto marker = qgraphicsitem_cast<Marker*>(item);
-    if(marker)
-      markers[marker->id()] = marker;
+    expiry_wheel_->cancel(marker.second.expiry);
+    marker.second.marker->releaseItems();
   }
-  return markers;
+  // Removed from the model all at once, as DELETEALL is usually followed by
+  // a full republish.
+  auto map = parentMap();
+  if(map)
+    map->deleteChildMapItems(this);
+  else
+    for(auto marker: markers_)
+      delete marker.second.marker;
+  markers_.clear();
+}
+
+void MarkerNamespace::removeMarker(std::unordered_map<uint32_t, MarkerEntry>::iterator marker)
+{
+  expiry_wheel_->cancel(marker->second.expiry);
+  auto deleted = marker->second.marker;
+  markers_.erase(marker);
+  deleteMarker(deleted);
+}
+
+void MarkerNamespace::deleteMarker(Marker* marker)
+{
+  marker->releaseItems();
+  auto map = parentMap();
+  if(map)
+    map->deleteMapItem(marker);
+  else
+    delete marker;
 }
 
 } // namespace camp_ros
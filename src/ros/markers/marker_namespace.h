@@ -2,19 +2,23 @@
 #define CAMP_ROS_MARKERS_MARKER_NAMESPACE_H
 
 #include "../layer.h"
+#include "timing_wheel.h"
+#include <unordered_map>
 
 namespace camp_ros
 {
 
 class Marker;
 class MarkerData;
+class MarkerItemPool;
 
+// Markers sharing a namespace, indexed by id.
 class MarkerNamespace: public Layer
 {
   Q_OBJECT
   Q_INTERFACES(QGraphicsItem)
 public:
-  MarkerNamespace(MapItem* parent, NodeManager* node_manager, QString marker_namespace);
+  MarkerNamespace(MapItem* parent, NodeManager* node_manager, QString marker_namespace, MarkerItemPool* item_pool, TimingWheel* expiry_wheel);
 
   enum { Type =  map::MarkerNamespaceType };
 
@@ -25,11 +29,32 @@ public:
   }
 
 
-public slots:
+  // Adds, updates or deletes a marker. DELETEALL removes all of them.
   void updateMarker(const MarkerData& data);
 
+  void clear();
+
 private:
-  std::map<uint32_t, Marker*> markers() const;  
+  struct MarkerEntry
+  {
+    Marker* marker = nullptr;
+    TimingWheel::Handle expiry = 0;
+  };
+
+  // Called by the expiry wheel once a marker's lifetime is over. Removes it
+  // like a DELETE would.
+  void expireMarker(uint32_t id);
+
+  void removeMarker(std::unordered_map<uint32_t, MarkerEntry>::iterator marker);
+
+  // Returns the marker's items to the pool and removes it from the map
+  // model before deleting it.
+  void deleteMarker(Marker* marker);
+
+  std::unordered_map<uint32_t, MarkerEntry> markers_;
+
+  MarkerItemPool* item_pool_ = nullptr;
+  TimingWheel* expiry_wheel_ = nullptr;
 
 };
 
@@ -9,8 +9,11 @@ Markers::Markers(MapItem* parent, NodeManager* node_manager, QString topic, QStr
   Layer(parent, node_manager, topic), topic_(topic.toStdString())
 {
   qRegisterMetaType<MarkerData>("MarkerData");
+  qRegisterMetaType<MarkerDataList>("MarkerDataList");
 
-  connect(this, &Markers::newMarkerData, this, &Markers::updateMarker);
+  connect(this, &Markers::newMarkerData, this, &Markers::updateMarkers);
+
+  expiry_wheel_ = new TimingWheel(this);
 
   if(topic_type == "visualization_msgs/MarkerArray")
   {
@@ -40,7 +43,9 @@ void Markers::markerCallback(const visualization_msgs::MarkerConstPtr &data)
 
 void Markers::addMarkers(const std::vector<visualization_msgs::Marker> &markers)
 {
-  for(auto m: markers)
+  MarkerDataList marker_data_list;
+  marker_data_list.reserve(markers.size());
+  for(const auto& m: markers)
   {
     try
     {
@@ -51,32 +56,39 @@ void Markers::addMarkers(const std::vector<visualization_msgs::Marker> &markers)
         marker_data.position = transformToWebMercator(m.pose, m.header);
         marker_data.rotation = tf2::getYaw(m.pose.orientation);
       }
-      emit newMarkerData(marker_data);
+      marker_data_list.push_back(std::move(marker_data));
     }
     catch (tf2::TransformException &ex)
     {
       ROS_WARN_STREAM_THROTTLE(2.0, "Unable to find transform to earth for marker " << m.ns << ": " << m.id << " at lookup time: " << m.header.stamp << " now: " << ros::Time::now() << " source frame: " << m.header.frame_id << " what: " << ex.what());
     }
   }
+  if(!marker_data_list.empty())
+    emit newMarkerData(marker_data_list);
 }
 
-MarkerNamespace* Markers::markerNamespace(const QString& marker_namespace) const
+void Markers::updateMarkers(const MarkerDataList& data)
 {
-  for(auto item: childItems())
+  auto marker_namespace = namespaces_.end();
+  for(const auto& marker: data)
   {
-    auto ns = qgraphicsitem_cast<MarkerNamespace*>(item);
-    if(ns && ns->objectName() == marker_namespace)
-      return ns;
-  }
-  return nullptr;
-}
+    // A DELETEALL without a namespace clears all of them.
+    if(marker.marker.action == visualization_msgs::Marker::DELETEALL && marker.marker.ns.empty())
+    {
+      for(auto ns: namespaces_)
+        ns.second->clear();
+      continue;
+    }
 
-void Markers::updateMarker(const MarkerData& data)
-{
-  auto marker_namespace = markerNamespace(data.marker.ns.c_str());
-  if(!marker_namespace)
-    marker_namespace = new MarkerNamespace(this, node_manager_, data.marker.ns.c_str());
-  marker_namespace->updateMarker(data);
+    // Arrays usually come grouped by namespace.
+    if(marker_namespace == namespaces_.end() || marker_namespace->first != marker.marker.ns)
+    {
+      marker_namespace = namespaces_.find(marker.marker.ns);
+      if(marker_namespace == namespaces_.end())
+        marker_namespace = namespaces_.emplace(marker.marker.ns, new MarkerNamespace(this, node_manager_, marker.marker.ns.c_str(), &item_pool_, expiry_wheel_)).first;
+    }
+    marker_namespace->second->updateMarker(marker);
+  }
 }
 
 } // namespace camp_ros
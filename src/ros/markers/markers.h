@@ -4,6 +4,9 @@
 #include "../layer.h"
 #include <visualization_msgs/MarkerArray.h>
 #include <QGeoCoordinate>
+#include <unordered_map>
+#include "marker_item_pool.h"
+#include "timing_wheel.h"
 
 namespace camp_ros
 {
@@ -15,6 +18,8 @@ struct MarkerData
   double rotation = 0.0;
 };
 
+typedef std::vector<MarkerData> MarkerDataList;
+
 class MarkerNamespace;
 
 class Markers: public Layer
@@ -27,7 +32,7 @@ public:
 
 
 signals:
-  void newMarkerData(MarkerData data);
+  void newMarkerData(MarkerDataList data);
 
 private:
   void markerArrayCallback(const visualization_msgs::MarkerArrayConstPtr &data);
@@ -35,18 +40,24 @@ private:
   void addMarkers(const std::vector<visualization_msgs::Marker> &markers);
 
 
-  MarkerNamespace * markerNamespace(const QString& marker_namepsace) const;
-
 private slots:
-  void updateMarker(const MarkerData& data);
+  // Applies a whole MarkerArray, or a single Marker, in order.
+  void updateMarkers(const MarkerDataList& data);
 
 private:
   std::string topic_;
 
+  std::unordered_map<std::string, MarkerNamespace*> namespaces_;
+
+  // Shared by the markers of all namespaces.
+  MarkerItemPool item_pool_;
+  TimingWheel* expiry_wheel_ = nullptr;
+
 };
 
 } // namespace camp_ros
 
 Q_DECLARE_METATYPE(camp_ros::MarkerData);
+Q_DECLARE_METATYPE(camp_ros::MarkerDataList);
 
 #endif
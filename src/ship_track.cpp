@@ -1,4 +1,5 @@
 #include "ship_track.h"
+#include "backgroundraster.h"
 #include <cmath>
 #include <QDebug>
 
@@ -8,68 +9,85 @@ ShipTrack::ShipTrack(QGraphicsItem *parentItem):GeoGraphicsItem(parentItem)
 
 }
 
+void ShipTrack::updateFrame(BackgroundRaster* bg, const QGeoCoordinate& location) const
+{
+  if(bg == m_frame_background && bg->mapScale() == m_frame_map_scale)
+    return;
+  QPointF center = geoToPixel(location, bg);
+  m_east = (geoToPixel(location.atDistanceAndAzimuth(100, 90), bg) - center)/100.0;
+  m_north = (geoToPixel(location.atDistanceAndAzimuth(100, 0), bg) - center)/100.0;
+  m_frame_background = bg;
+  m_frame_map_scale = bg->mapScale();
+}
+
+QTransform ShipTrack::symbolTransform(const QPointF& position, double heading_degrees) const
+{
+  double heading = heading_degrees*M_PI/180.0;
+  QPointF forward = m_east*sin(heading) + m_north*cos(heading);
+  QPointF starboard = m_east*cos(heading) - m_north*sin(heading);
+  return QTransform(starboard.x(), starboard.y(), forward.x(), forward.y(), position.x(), position.y());
+}
+
+void ShipTrack::addCircle(QPainterPath& path, const QPointF& position, double radius) const
+{
+  double radius_pixel = radius*sqrt(m_north.x()*m_north.x()+m_north.y()*m_north.y());
+  path.addEllipse(position, radius_pixel, radius_pixel);
+}
+
 void ShipTrack::drawTriangle(QPainterPath& path, BackgroundRaster* bg, const QGeoCoordinate& location, double heading_degrees, double scale) const
+{
+  updateFrame(bg, location);
+  drawTriangle(path, geoToPixel(location, bg), heading_degrees, scale);
+}
+
+void ShipTrack::drawShipOutline(QPainterPath& path, BackgroundRaster* bg, const QGeoCoordinate& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
+{
+  updateFrame(bg, location);
+  drawShipOutline(path, geoToPixel(location, bg), heading_degrees, dimension_to_bow, dimension_to_port, dimension_to_stbd, dimension_to_stern);
+}
+
+void ShipTrack::drawTriangle(QPainterPath& path, const QPointF& position, double heading_degrees, double scale) const
 {
   if(std::isnan(heading_degrees))
   {
-    QPointF center = geoToPixel(location, bg);
-    QGeoCoordinate radius_away = location.atDistanceAndAzimuth(15, 0);
-    QPointF radius_away_local = geoToPixel(radius_away, bg);
-    QPointF radius_local = center-radius_away_local;
-    float radius_pixel = sqrt(radius_local.rx()*radius_local.rx()+radius_local.ry()*radius_local.ry());
-    path.addEllipse(center, radius_pixel, radius_pixel);
-    //path.addEllipse(center, 15*scale, 15*scale);
+    addCircle(path, position, 15);
     return;
   }
-  QGeoCoordinate tip = location.atDistanceAndAzimuth(15*scale,heading_degrees);
-  QGeoCoordinate llcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees-150);
-  QGeoCoordinate lrcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees+150);
 
-  QPointF ltip = geoToPixel(tip, bg);
-  QPointF lllocal = geoToPixel(llcorner, bg);
-  QPointF lrlocal = geoToPixel(lrcorner, bg);
-
-  path.moveTo(ltip);
-  path.lineTo(lllocal);
-  path.lineTo(lrlocal);
-  path.lineTo(ltip);
+  // Tip and corners 15m from the location, corners at 150 degrees from the
+  // tip.
+  static const QPolygonF triangle = QPolygonF() << QPointF(0.0, 15.0) << QPointF(-7.5, -15.0*sqrt(3.0)/2.0) << QPointF(7.5, -15.0*sqrt(3.0)/2.0) << QPointF(0.0, 15.0);
+  QTransform transform = QTransform::fromScale(scale, scale)*symbolTransform(position, heading_degrees);
+  path.addPolygon(transform.map(triangle));
 }
 
-void ShipTrack::drawShipOutline(QPainterPath& path, BackgroundRaster* bg, const QGeoCoordinate& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
+void ShipTrack::drawShipOutline(QPainterPath& path, const QPointF& position, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
 {
   if(std::isnan(heading_degrees))
   {
-    QPointF center = geoToPixel(location, bg);
     float radius = std::max(dimension_to_bow, dimension_to_stern);
     radius = std::max(radius, dimension_to_port);
     radius = std::max(radius, dimension_to_stbd);
-    QGeoCoordinate radius_away = location.atDistanceAndAzimuth(radius,0);
-    QPointF radius_away_local = geoToPixel(radius_away, bg);
-    QPointF radius_local = center-radius_away_local;
-    float radius_pixel = sqrt(radius_local.rx()*radius_local.rx()+radius_local.ry()*radius_local.ry());
-    path.addEllipse(center, radius_pixel, radius_pixel);
+    addCircle(path, position, radius);
     return;
   }
 
-  float length = dimension_to_bow+dimension_to_stern;
-  float width = dimension_to_port+dimension_to_stbd;
-  QGeoCoordinate llcorner = location.atDistanceAndAzimuth(dimension_to_port,270+heading_degrees).atDistanceAndAzimuth(dimension_to_stern,180+heading_degrees);
-  QGeoCoordinate lrcorner = llcorner.atDistanceAndAzimuth(width,90+heading_degrees);
-  QGeoCoordinate urcorner = lrcorner.atDistanceAndAzimuth(length,heading_degrees);
-  QGeoCoordinate ulcorner = urcorner.atDistanceAndAzimuth(width,270+heading_degrees);
-  QGeoCoordinate rkink = lrcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-  QGeoCoordinate lkink = llcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-  QGeoCoordinate bow = ulcorner.atDistanceAndAzimuth(width/2.0,90+heading_degrees);
-  QPointF lllocal = geoToPixel(llcorner, bg);
-  QPointF lrlocal = geoToPixel(lrcorner, bg);
-  QPointF lkinkl = geoToPixel(lkink, bg);
-  QPointF rkinkl = geoToPixel(rkink, bg);
-  QPointF bowl = geoToPixel(bow, bg);
-  
-  path.moveTo(lllocal);
-  path.lineTo(lrlocal);
-  path.lineTo(rkinkl);
-  path.lineTo(bowl);
-  path.lineTo(lkinkl);
-  path.lineTo(lllocal);
+  if(m_outline.isEmpty() || dimension_to_bow != m_outline_dimensions[0] || dimension_to_port != m_outline_dimensions[1] || dimension_to_stbd != m_outline_dimensions[2] || dimension_to_stern != m_outline_dimensions[3])
+  {
+    float length = dimension_to_bow+dimension_to_stern;
+    float kink = -dimension_to_stern + length*.8;
+    m_outline = QPolygonF()
+      << QPointF(-dimension_to_port, -dimension_to_stern)
+      << QPointF(dimension_to_stbd, -dimension_to_stern)
+      << QPointF(dimension_to_stbd, kink)
+      << QPointF((dimension_to_stbd-dimension_to_port)/2.0, dimension_to_bow)
+      << QPointF(-dimension_to_port, kink)
+      << QPointF(-dimension_to_port, -dimension_to_stern);
+    m_outline_dimensions[0] = dimension_to_bow;
+    m_outline_dimensions[1] = dimension_to_port;
+    m_outline_dimensions[2] = dimension_to_stbd;
+    m_outline_dimensions[3] = dimension_to_stern;
+  }
+
+  path.addPolygon(symbolTransform(position, heading_degrees).map(m_outline));
 }
@@ -2,7 +2,14 @@
 #define CAMP_SHIP_TRACK_H
 
 #include "geographicsitem.h"
+#include <QPolygonF>
+#include <QTransform>
 
+// Draws ship symbols from polygons in meters relative to the reference
+// point, x to starboard and y forward. Each draw projects the location once
+// and places the polygon with an affine transform. The pixels per meter
+// east and north are measured near the ship and kept until the background
+// or its zoom changes.
 class ShipTrack: public GeoGraphicsItem
 {
 public:
@@ -12,6 +19,27 @@ protected:
   void drawTriangle(QPainterPath &path, BackgroundRaster* bg, QGeoCoordinate const &location, double heading_degrees, double scale=1.0) const;
   void drawShipOutline(QPainterPath &path, BackgroundRaster* bg, QGeoCoordinate const &location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const;
 
+  // Measures the frame near location unless it is current, as the above
+  // do. Once measured, symbols can be placed at already projected positions
+  // with the following.
+  void updateFrame(BackgroundRaster* bg, QGeoCoordinate const &location) const;
+  void drawTriangle(QPainterPath &path, QPointF const &position, double heading_degrees, double scale=1.0) const;
+  void drawShipOutline(QPainterPath &path, QPointF const &position, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const;
+
+private:
+  // Maps meters starboard and forward to background pixels.
+  QTransform symbolTransform(QPointF const &position, double heading_degrees) const;
+  void addCircle(QPainterPath &path, QPointF const &position, double radius) const;
+
+  // Pixels per meter east and north.
+  mutable QPointF m_east;
+  mutable QPointF m_north;
+  mutable BackgroundRaster* m_frame_background = nullptr;
+  mutable qreal m_frame_map_scale = 0.0;
+
+  // Outline for the dimensions it was built from.
+  mutable QPolygonF m_outline;
+  mutable float m_outline_dimensions[4] = {0.0, 0.0, 0.0, 0.0};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -20,3 +20,9 @@ void SpeechAlerts::updatePilotingMode(QString piloting_mode)
 }
 
 
+
+void SpeechAlerts::guardZoneAlarm(QString topic, int zone, bool active)
+{
+  if(active)
+    emit tell("Guard zone alarm");
+}
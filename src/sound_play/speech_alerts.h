@@ -15,6 +15,7 @@ signals:
 
 public slots:
   void updatePilotingMode(QString piloting_mode);
+  void guardZoneAlarm(QString topic, int zone, bool active);
 
 private:
   QString m_piloting_mode;
@@ -0,0 +1,82 @@
+#ifndef CAMP_SPSC_QUEUE_H
+#define CAMP_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free FIFO between exactly one producer thread and one
+// consumer thread.
+//
+// Slots are preallocated, values being moved in and out of them. Each side
+// caches the other's index and only reloads it when the queue looks full or
+// empty. Each index shares its cache line only with the cache kept by the
+// same side, so neither side writes to a line the other keeps reading.
+template<typename T> class SPSCQueue
+{
+public:
+  // Rounded up to a power of two.
+  explicit SPSCQueue(std::size_t capacity = 4096)
+  {
+    std::size_t size = 2;
+    while(size < capacity)
+      size *= 2;
+    data_.resize(size);
+    mask_ = size-1;
+  }
+
+  std::size_t capacity() const {return data_.size();}
+
+  // Producer only. Returns false, leaving value unused, when full.
+  bool push(T&& value)
+  {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail - cached_head_ == data_.size())
+    {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if(tail - cached_head_ == data_.size())
+        return false;
+    }
+    data_[tail & mask_] = std::move(value);
+    tail_.store(tail+1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only.
+  bool empty() const
+  {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+  }
+
+  // Consumer only. Returns false when empty.
+  bool pop(T& value)
+  {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if(head == cached_tail_)
+    {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if(head == cached_tail_)
+        return false;
+    }
+    value = std::move(data_[head & mask_]);
+    head_.store(head+1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> data_;
+  std::size_t mask_;
+
+  // Next slot to pop, written by the consumer.
+  alignas(64) std::atomic<std::size_t> head_{0};
+  // Consumer's copy of tail_.
+  std::size_t cached_tail_ = 0;
+
+  // Next slot to push, written by the producer.
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  // Producer's copy of head_.
+  std::size_t cached_head_ = 0;
+};
+
+#endif
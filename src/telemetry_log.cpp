@@ -0,0 +1,204 @@
+#include "telemetry_log.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+const char telemetry_magic[8] = {'C','A','M','P','T','L','M','1'};
+
+} // namespace
+
+TelemetryLog::~TelemetryLog()
+{
+  close();
+}
+
+bool TelemetryLog::open(const QString& path)
+{
+  close();
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  file_.setFileName(path);
+  if(!file_.open(QIODevice::ReadWrite))
+  {
+    qWarning() << "Unable to open telemetry log" << path << file_.errorString();
+    return false;
+  }
+
+  bool created = file_.size() == 0;
+  if(!created && file_.size() < qint64(sizeof(Header)))
+  {
+    qWarning() << "Telemetry log too small:" << path;
+    close();
+    return false;
+  }
+  uint64_t capacity = created ? block_records_ : (file_.size()-sizeof(Header))/sizeof(TelemetryRecord);
+  if(!map(capacity))
+  {
+    close();
+    return false;
+  }
+
+  auto h = header();
+  if(created)
+  {
+    memcpy(h->magic, telemetry_magic, sizeof(h->magic));
+    h->version = 1;
+    h->record_size = sizeof(TelemetryRecord);
+    h->count = 0;
+    h->reserved = 0;
+  }
+  else if(memcmp(h->magic, telemetry_magic, sizeof(h->magic)) != 0 || h->record_size != sizeof(TelemetryRecord) || h->count > capacity_)
+  {
+    qWarning() << "Not a telemetry log:" << path;
+    close();
+    return false;
+  }
+
+  index_.clear();
+  for(uint64_t i = 0; i < h->count; i += index_stride_)
+    index_.push_back(records()[i].time);
+  return true;
+}
+
+void TelemetryLog::close()
+{
+  if(data_)
+    file_.unmap(data_);
+  data_ = nullptr;
+  capacity_ = 0;
+  index_.clear();
+  if(file_.isOpen())
+    file_.close();
+}
+
+bool TelemetryLog::isOpen() const
+{
+  return data_ != nullptr;
+}
+
+bool TelemetryLog::rotate()
+{
+  if(!isOpen())
+    return false;
+  QString path = file_.fileName();
+  QFileInfo info(path);
+  QString base = info.dir().filePath(info.completeBaseName()+"-"+QString::number(qint64(startTime())));
+  QString archive = base+"."+info.suffix();
+  for(int i = 1; QFileInfo::exists(archive); i++)
+    archive = base+"-"+QString::number(i)+"."+info.suffix();
+  close();
+  if(!QFile::rename(path, archive))
+  {
+    qWarning() << "Unable to move telemetry log" << path << "to" << archive;
+    return false;
+  }
+  return open(path);
+}
+
+QString TelemetryLog::path() const
+{
+  return file_.fileName();
+}
+
+bool TelemetryLog::map(uint64_t capacity)
+{
+  if(data_)
+    file_.unmap(data_);
+  data_ = nullptr;
+  qint64 size = sizeof(Header) + capacity*sizeof(TelemetryRecord);
+  if(file_.size() < size && !file_.resize(size))
+  {
+    qWarning() << "Unable to grow telemetry log" << file_.fileName() << file_.errorString();
+    return false;
+  }
+  data_ = file_.map(0, size);
+  if(!data_)
+  {
+    qWarning() << "Unable to map telemetry log" << file_.fileName() << file_.errorString();
+    return false;
+  }
+  capacity_ = capacity;
+  return true;
+}
+
+TelemetryLog::Header* TelemetryLog::header() const
+{
+  return reinterpret_cast<Header*>(data_);
+}
+
+TelemetryRecord* TelemetryLog::records() const
+{
+  return reinterpret_cast<TelemetryRecord*>(data_+sizeof(Header));
+}
+
+bool TelemetryLog::append(const TelemetryRecord& record)
+{
+  if(!data_)
+    return false;
+  auto count = header()->count;
+  if(count > 0 && record.time < records()[count-1].time)
+    return false;
+  if(count == capacity_ && !map(capacity_+block_records_))
+    return false;
+  records()[count] = record;
+  // Counted once written, so a crash leaves no partial record.
+  header()->count = count+1;
+  if(count % index_stride_ == 0)
+    index_.push_back(record.time);
+  return true;
+}
+
+uint64_t TelemetryLog::size() const
+{
+  if(!data_)
+    return 0;
+  // Another instance may be appending to the same file past our mapping.
+  return std::min(header()->count, capacity_);
+}
+
+const TelemetryRecord& TelemetryLog::at(uint64_t index) const
+{
+  return records()[index];
+}
+
+uint64_t TelemetryLog::lowerBound(double time) const
+{
+  auto count = size();
+  if(count == 0)
+    return 0;
+  // Last indexed record before time, the answer is in the following stride.
+  auto stride = std::lower_bound(index_.begin(), index_.end(), time) - index_.begin();
+  uint64_t begin = stride > 0 ? (stride-1)*index_stride_ : 0;
+  uint64_t end = std::min(count, uint64_t(stride)*index_stride_+1);
+  auto first = records()+begin;
+  auto last = records()+end;
+  return std::lower_bound(first, last, time, [](const TelemetryRecord& r, double t){return r.time < t;}) - records();
+}
+
+std::vector<TelemetryRecord> TelemetryLog::read(double start, double end) const
+{
+  std::vector<TelemetryRecord> ret;
+  auto count = size();
+  for(auto i = lowerBound(start); i < count && records()[i].time < end; i++)
+    ret.push_back(records()[i]);
+  return ret;
+}
+
+double TelemetryLog::startTime() const
+{
+  if(size() == 0)
+    return 0.0;
+  return records()[0].time;
+}
+
+double TelemetryLog::endTime() const
+{
+  auto count = size();
+  if(count == 0)
+    return 0.0;
+  return records()[count-1].time;
+}
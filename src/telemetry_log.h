@@ -0,0 +1,89 @@
+#ifndef CAMP_TELEMETRY_LOG_H
+#define CAMP_TELEMETRY_LOG_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+// Fixed size record of a platform's position.
+struct TelemetryRecord
+{
+  // Seconds since 1970.
+  double time;
+  double latitude;
+  double longitude;
+  float altitude;
+  // Degrees, NaN if unknown.
+  float heading;
+};
+
+static_assert(sizeof(TelemetryRecord) == 32, "TelemetryRecord must stay 32 bytes, it is written as is");
+
+// Append-only log of TelemetryRecords in a memory mapped file.
+//
+// The file is grown and mapped in blocks so appending is a copy to memory.
+// Records must be appended in time order, which lets reads locate a time
+// with a sparse index of every index_stride_th record and a binary search
+// within one stride.
+class TelemetryLog
+{
+public:
+  ~TelemetryLog();
+
+  // Opens or creates the log, creating missing directories. Returns false
+  // if the file can't be used.
+  bool open(const QString& path);
+  void close();
+  bool isOpen() const;
+
+  // Moves the current file aside, named after its start time, and starts
+  // an empty log at the same path. Used when time goes backwards, as
+  // records must be appended in time order.
+  bool rotate();
+
+  QString path() const;
+
+  // Returns false if the record is older than the last one or if the file
+  // couldn't be grown.
+  bool append(const TelemetryRecord& record);
+
+  uint64_t size() const;
+  const TelemetryRecord& at(uint64_t index) const;
+
+  // Index of the first record at or after time.
+  uint64_t lowerBound(double time) const;
+
+  // Records with start <= time < end.
+  std::vector<TelemetryRecord> read(double start, double end) const;
+
+  double startTime() const;
+  double endTime() const;
+
+private:
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t reserved;
+  };
+
+  bool map(uint64_t capacity);
+  Header* header() const;
+  TelemetryRecord* records() const;
+
+  QFile file_;
+  uchar* data_ = nullptr;
+  // Records the mapped file can hold.
+  uint64_t capacity_ = 0;
+
+  // Time of every index_stride_th record.
+  std::vector<double> index_;
+
+  static constexpr uint64_t index_stride_ = 1024;
+  static constexpr uint64_t block_records_ = 32768;
+};
+
+#endif
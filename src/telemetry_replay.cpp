@@ -0,0 +1,58 @@
+#include "telemetry_replay.h"
+#include <algorithm>
+
+TelemetryReplay::TelemetryReplay(QObject* parent): QObject(parent)
+{
+  connect(&timer_, &QTimer::timeout, this, &TelemetryReplay::play);
+}
+
+bool TelemetryReplay::open(const QString& path)
+{
+  stop();
+  return log_.open(path);
+}
+
+void TelemetryReplay::setRange(double start, double end)
+{
+  start_time_ = start;
+  end_time_ = end;
+}
+
+void TelemetryReplay::setSpeed(double speed)
+{
+  speed_ = std::max(0.0, speed);
+}
+
+void TelemetryReplay::start()
+{
+  next_ = log_.lowerBound(start_time_);
+  if(next_ < log_.size())
+    start_time_ = std::max(start_time_, log_.at(next_).time);
+  clock_.start();
+  timer_.start(speed_ > 0.0 ? 20 : 0);
+}
+
+void TelemetryReplay::stop()
+{
+  timer_.stop();
+}
+
+void TelemetryReplay::play()
+{
+  double end_time = end_time_ > 0.0 ? end_time_ : log_.endTime();
+  double replay_time = start_time_ + clock_.elapsed()*speed_/1000.0;
+  int sent = 0;
+  while(next_ < log_.size())
+  {
+    const auto& record = log_.at(next_);
+    if(record.time > end_time)
+      break;
+    if(speed_ > 0.0 ? record.time > replay_time : sent >= batch_size_)
+      return;
+    emit location(QGeoCoordinate(record.latitude, record.longitude, record.altitude), record.heading, record.time);
+    next_++;
+    sent++;
+  }
+  stop();
+  emit finished();
+}
@@ -0,0 +1,51 @@
+#ifndef CAMP_TELEMETRY_REPLAY_H
+#define CAMP_TELEMETRY_REPLAY_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QGeoCoordinate>
+#include "telemetry_log.h"
+
+// Plays a TelemetryLog back as location updates, suitable for
+// NavSource::updateLocation.
+class TelemetryReplay: public QObject
+{
+  Q_OBJECT
+public:
+  TelemetryReplay(QObject* parent = nullptr);
+
+  bool open(const QString& path);
+
+  // Times in seconds since 1970, end of 0 plays to the end of the log.
+  void setRange(double start, double end = 0.0);
+
+  // Multiple of real time, 0 to play as fast as possible.
+  void setSpeed(double speed);
+
+signals:
+  void location(QGeoCoordinate const &location, float heading, double time);
+  void finished();
+
+public slots:
+  void start();
+  void stop();
+
+private slots:
+  void play();
+
+private:
+  TelemetryLog log_;
+  double start_time_ = 0.0;
+  double end_time_ = 0.0;
+  double speed_ = 1.0;
+
+  uint64_t next_ = 0;
+  QElapsedTimer clock_;
+  QTimer timer_;
+
+  // Records sent per timer tick when playing as fast as possible.
+  static constexpr int batch_size_ = 1000;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "timing_wheel.h"
+#include <algorithm>
+#include <cmath>
+
+TimingWheel::TimingWheel(QObject* parent, double resolution):
+  QObject(parent), resolution_(resolution)
+{
+  timer_.setInterval(std::max(1, int(resolution*1000)));
+  connect(&timer_, &QTimer::timeout, this, &TimingWheel::tick);
+}
+
+TimingWheel::Handle TimingWheel::schedule(const ros::Time& expiry, std::function<void()> callback)
+{
+  if(entries_.empty())
+  {
+    // Idle wheels don't tick, so start over from now.
+    for(auto& level: slots_)
+      for(auto& slot: level)
+        slot.clear();
+    origin_ = ros::Time::now();
+    last_time_ = origin_;
+    current_tick_ = 0;
+    timer_.start();
+  }
+
+  Handle handle = next_handle_++;
+  auto& entry = entries_[handle];
+  entry.expiry = expiry;
+  // Rounded up so entries never expire early.
+  entry.expiry_tick = std::ceil((expiry - origin_).toSec()/resolution_);
+  entry.callback = std::move(callback);
+  insert(handle, entry.expiry_tick);
+  return handle;
+}
+
+void TimingWheel::cancel(Handle handle)
+{
+  entries_.erase(handle);
+}
+
+std::size_t TimingWheel::size() const
+{
+  return entries_.size();
+}
+
+int64_t TimingWheel::toTick(const ros::Time& time) const
+{
+  return std::floor((time - origin_).toSec()/resolution_);
+}
+
+void TimingWheel::insert(Handle handle, int64_t expiry_tick, bool current_slot)
+{
+  // The current slot is only still to be processed while cascading.
+  int64_t tick = std::max(expiry_tick, current_slot ? current_tick_ : current_tick_+1);
+  for(int level = 0; level < level_count; level++)
+    if(tick - current_tick_ < int64_t(1) << (slot_bits*(level+1)))
+    {
+      slots_[level][(tick >> (slot_bits*level)) & (slot_count-1)].push_back(handle);
+      return;
+    }
+  // Beyond the top level, parked in its farthest slot and put back when it
+  // comes up.
+  tick = current_tick_ + (int64_t(1) << (slot_bits*level_count)) - 1;
+  slots_[level_count-1][(tick >> (slot_bits*(level_count-1))) & (slot_count-1)].push_back(handle);
+}
+
+void TimingWheel::cascade(int level)
+{
+  int index = (current_tick_ >> (slot_bits*level)) & (slot_count-1);
+  std::vector<Handle> handles;
+  handles.swap(slots_[level][index]);
+  for(auto handle: handles)
+  {
+    auto entry = entries_.find(handle);
+    if(entry != entries_.end())
+      insert(handle, entry->second.expiry_tick, true);
+  }
+  if(index == 0 && level+1 < level_count)
+    cascade(level+1);
+}
+
+void TimingWheel::rebuild(const ros::Time& now)
+{
+  for(auto& level: slots_)
+    for(auto& slot: level)
+      slot.clear();
+  origin_ = now;
+  current_tick_ = 0;
+  for(auto& entry: entries_)
+  {
+    entry.second.expiry_tick = std::ceil((entry.second.expiry - origin_).toSec()/resolution_);
+    insert(entry.first, entry.second.expiry_tick);
+  }
+}
+
+void TimingWheel::tick()
+{
+  auto now = ros::Time::now();
+  int64_t target = toTick(now);
+  // Time went backwards or jumped further than the cost of stepping there.
+  bool rebuilt = now < last_time_ || target - current_tick_ > slot_count*slot_count;
+  if(rebuilt)
+  {
+    rebuild(now);
+    target = 0;
+  }
+  last_time_ = now;
+
+  std::vector<std::function<void()> > expired;
+  auto expire = [&](Handle handle)
+  {
+    auto entry = entries_.find(handle);
+    if(entry == entries_.end())
+      return;
+    if(entry->second.expiry <= now)
+    {
+      expired.push_back(std::move(entry->second.callback));
+      entries_.erase(entry);
+    }
+    else
+      insert(handle, entry->second.expiry_tick);
+  };
+
+  if(rebuilt)
+  {
+    // After a rebuild, entries already past are in the next slot.
+    std::vector<Handle> handles;
+    handles.swap(slots_[0][1]);
+    for(auto handle: handles)
+      expire(handle);
+  }
+
+  while(current_tick_ < target)
+  {
+    current_tick_++;
+    int index = current_tick_ & (slot_count-1);
+    if(index == 0)
+      cascade(1);
+    std::vector<Handle> handles;
+    handles.swap(slots_[0][index]);
+    for(auto handle: handles)
+      expire(handle);
+  }
+
+  if(entries_.empty())
+    timer_.stop();
+
+  for(auto& callback: expired)
+    callback();
+}
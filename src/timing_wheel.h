@@ -0,0 +1,82 @@
+#ifndef CAMP_TIMING_WHEEL_H
+#define CAMP_TIMING_WHEEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <ros/time.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Calls callbacks once ROS time passes their expiry, driven by a single
+// timer however many are scheduled.
+//
+// Expiries are kept in a hierarchical timing wheel: levels of 64 slots, each
+// slot of a level spanning a whole turn of the level below, so scheduling,
+// cancelling and expiring are O(1) amortized. Entries far in the future are
+// moved down a level as their time gets closer.
+//
+// Time comes from ros::Time::now() so it follows simulated time during
+// playback. If time goes backwards, as when a bag is restarted, entries are
+// rescheduled relative to the new time.
+//
+// Callbacks run on the thread owning the wheel and may schedule or cancel
+// entries.
+class TimingWheel: public QObject
+{
+  Q_OBJECT
+public:
+  typedef uint64_t Handle;
+
+  // Resolution is the duration of a tick, in seconds.
+  explicit TimingWheel(QObject* parent = nullptr, double resolution = 0.1);
+
+  // Returns a handle for cancel, never 0.
+  Handle schedule(const ros::Time& expiry, std::function<void()> callback);
+
+  // Does nothing if handle already expired or is 0.
+  void cancel(Handle handle);
+
+  std::size_t size() const;
+
+private slots:
+  void tick();
+
+private:
+  static constexpr int slot_bits = 6;
+  static constexpr int slot_count = 1 << slot_bits;
+  static constexpr int level_count = 4;
+
+  struct Entry
+  {
+    ros::Time expiry;
+    int64_t expiry_tick;
+    std::function<void()> callback;
+  };
+
+  int64_t toTick(const ros::Time& time) const;
+  void insert(Handle handle, int64_t expiry_tick, bool current_slot = false);
+
+  // Moves the entries of the current slot of level down a level.
+  void cascade(int level);
+
+  // Puts all the entries back in the wheel relative to now.
+  void rebuild(const ros::Time& now);
+
+  // Slots hold handles, cancelled entries are only removed from entries_
+  // and skipped when their slot comes up.
+  std::array<std::array<std::vector<Handle>, slot_count>, level_count> slots_;
+  std::unordered_map<Handle, Entry> entries_;
+  Handle next_handle_ = 1;
+
+  double resolution_;
+  ros::Time origin_;
+  int64_t current_tick_ = 0;
+  ros::Time last_time_;
+
+  QTimer timer_;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "track_path.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+double distanceToSegment(const QPointF& p, const QPointF& a, const QPointF& b)
+{
+  QPointF ab = b-a;
+  QPointF ap = p-a;
+  double length2 = QPointF::dotProduct(ab, ab);
+  if(length2 == 0.0)
+    return std::hypot(ap.x(), ap.y());
+  double t = std::max(0.0, std::min(1.0, QPointF::dotProduct(ap, ab)/length2));
+  QPointF d = ap - ab*t;
+  return std::hypot(d.x(), d.y());
+}
+
+// Douglas-Peucker over the whole range, recording for each split point
+// the error it fixes. Capped by the parent's so that a point kept at a
+// tolerance implies its parents are too, making the levels nested.
+void significance(const std::vector<QPointF>& points, std::size_t first, std::size_t last, float cap, std::vector<float>& out)
+{
+  if(last <= first+1)
+    return;
+  double max_distance = -1.0;
+  std::size_t split = first;
+  for(std::size_t i = first+1; i < last; i++)
+  {
+    double d = distanceToSegment(points[i], points[first], points[last]);
+    if(d > max_distance)
+    {
+      max_distance = d;
+      split = i;
+    }
+  }
+  float s = std::min(cap, float(max_distance));
+  out[split] = s;
+  significance(points, first, split, s, out);
+  significance(points, split, last, s, out);
+}
+
+} // namespace
+
+void TrackPath::setBaseTolerance(double tolerance)
+{
+  base_tolerance_ = tolerance;
+  for(auto& chunk: chunks_)
+    chunk.built_levels = 0;
+}
+
+double TrackPath::tolerance(int level) const
+{
+  return base_tolerance_*std::pow(4.0, level);
+}
+
+void TrackPath::append(const QPointF& point)
+{
+  if(chunks_.empty() || chunks_.back().points.size() >= chunk_size_)
+  {
+    Chunk chunk;
+    chunk.points.reserve(chunk_size_+1);
+    if(!chunks_.empty())
+    {
+      chunk.points.push_back(chunks_.back().points.back());
+      chunk.shared_start = true;
+    }
+    chunks_.push_back(std::move(chunk));
+  }
+  chunks_.back().points.push_back(point);
+  chunks_.back().dirty = true;
+  size_++;
+}
+
+void TrackPath::popFront(std::size_t count)
+{
+  count = std::min(count, size_);
+  size_ -= count;
+  while(count > 0)
+  {
+    auto& chunk = chunks_.front();
+    std::size_t own = chunk.points.size() - (chunk.shared_start ? 1 : 0);
+    if(count >= own)
+    {
+      count -= own;
+      chunks_.pop_front();
+      continue;
+    }
+    chunk.points.erase(chunk.points.begin(), chunk.points.begin()+count+(chunk.shared_start ? 1 : 0));
+    chunk.shared_start = false;
+    chunk.dirty = true;
+    count = 0;
+  }
+  // A shared start point belongs to a dropped chunk.
+  if(!chunks_.empty() && chunks_.front().shared_start)
+  {
+    auto& chunk = chunks_.front();
+    chunk.points.erase(chunk.points.begin());
+    chunk.shared_start = false;
+    chunk.dirty = true;
+  }
+}
+
+void TrackPath::clear()
+{
+  chunks_.clear();
+  size_ = 0;
+}
+
+std::size_t TrackPath::size() const
+{
+  return size_;
+}
+
+bool TrackPath::empty() const
+{
+  return size_ == 0;
+}
+
+QPointF TrackPath::front() const
+{
+  if(chunks_.empty())
+    return QPointF();
+  return chunks_.front().points.front();
+}
+
+void TrackPath::update(const Chunk& chunk) const
+{
+  if(!chunk.dirty)
+    return;
+  chunk.path = QPainterPath();
+  if(!chunk.points.empty())
+  {
+    chunk.path.moveTo(chunk.points.front());
+    for(std::size_t i = 1; i < chunk.points.size(); i++)
+      chunk.path.lineTo(chunk.points[i]);
+  }
+  chunk.bounds = chunk.path.boundingRect();
+
+  chunk.significance.assign(chunk.points.size(), std::numeric_limits<float>::max());
+  if(chunk.points.size() > 2)
+    significance(chunk.points, 0, chunk.points.size()-1, std::numeric_limits<float>::max(), chunk.significance);
+  chunk.built_levels = 0;
+  chunk.dirty = false;
+}
+
+const QPainterPath& TrackPath::levelPath(const Chunk& chunk, int level) const
+{
+  auto& path = chunk.levels[level];
+  if(chunk.built_levels & (1u << level))
+    return path;
+  path = QPainterPath();
+  float t = tolerance(level);
+  bool first = true;
+  for(std::size_t i = 0; i < chunk.points.size(); i++)
+    if(chunk.significance[i] >= t)
+    {
+      if(first)
+        path.moveTo(chunk.points[i]);
+      else
+        path.lineTo(chunk.points[i]);
+      first = false;
+    }
+  chunk.built_levels |= 1u << level;
+  return path;
+}
+
+QRectF TrackPath::boundingRect() const
+{
+  QRectF ret;
+  for(const auto& chunk: chunks_)
+  {
+    update(chunk);
+    ret |= chunk.bounds;
+  }
+  return ret;
+}
+
+QPainterPath TrackPath::path() const
+{
+  QPainterPath ret;
+  for(const auto& chunk: chunks_)
+  {
+    update(chunk);
+    ret.addPath(chunk.path);
+  }
+  return ret;
+}
+
+void TrackPath::draw(QPainter* painter, const QRectF& exposed) const
+{
+  // Coarsest level with an error under half a pixel, -1 for all points.
+  auto lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  double max_error = lod > 0.0 ? 0.5/lod : 0.0;
+  int level = -1;
+  while(level+1 < level_count_ && tolerance(level+1) <= max_error)
+    level++;
+
+  for(const auto& chunk: chunks_)
+  {
+    update(chunk);
+    // Bounds of straight lines can have no area.
+    if(exposed.isNull() || exposed.intersects(chunk.bounds.adjusted(-1, -1, 1, 1)))
+    {
+      if(level < 0)
+        painter->drawPath(chunk.path);
+      else
+        painter->drawPath(levelPath(chunk, level));
+    }
+  }
+}
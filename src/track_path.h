@@ -0,0 +1,81 @@
+#ifndef CAMP_TRACK_PATH_H
+#define CAMP_TRACK_PATH_H
+
+#include <QPainterPath>
+#include <deque>
+#include <vector>
+
+class QPainter;
+
+// Polyline that grows at one end and shrinks at the other, as a vehicle's
+// track does.
+//
+// Points are kept in chunks, each with its own path and bounds, so
+// appending or dropping a point only rebuilds the chunk at that end and
+// drawing skips chunks outside the exposed area. Each chunk starts with a
+// copy of the previous chunk's last point so the line is continuous.
+//
+// Each chunk is also simplified at several tolerances using a progressive
+// Douglas-Peucker pass, which ranks points by the error their removal
+// causes. draw picks the coarsest level whose tolerance is under half a
+// pixel at the painter's scale, so the number of vertices drawn stays
+// bounded by the screen resolution rather than the length of the track.
+class TrackPath
+{
+public:
+  // Tolerance of the finest simplified level, in scene units. Each
+  // following level is 4 times coarser.
+  void setBaseTolerance(double tolerance);
+
+  void append(const QPointF& point);
+
+  // Drops the count oldest points.
+  void popFront(std::size_t count = 1);
+
+  void clear();
+  std::size_t size() const;
+  bool empty() const;
+
+  // Oldest point.
+  QPointF front() const;
+
+  QRectF boundingRect() const;
+  QPainterPath path() const;
+
+  // Draws the chunks intersecting exposed with the painter's pen,
+  // simplified according to the painter's scale.
+  void draw(QPainter* painter, const QRectF& exposed) const;
+
+private:
+  static constexpr int level_count_ = 8;
+
+  struct Chunk
+  {
+    std::vector<QPointF> points;
+    // The first point is a copy of the previous chunk's last one.
+    bool shared_start = false;
+    mutable QPainterPath path;
+    mutable QRectF bounds;
+    mutable bool dirty = true;
+
+    // Largest tolerance at which each point is kept, end points are always
+    // kept.
+    mutable std::vector<float> significance;
+    // Simplified paths, built when first drawn.
+    mutable QPainterPath levels[level_count_];
+    mutable unsigned built_levels = 0;
+  };
+
+  void update(const Chunk& chunk) const;
+  const QPainterPath& levelPath(const Chunk& chunk, int level) const;
+  double tolerance(int level) const;
+
+  double base_tolerance_ = 0.25;
+
+  std::deque<Chunk> chunks_;
+  std::size_t size_ = 0;
+
+  static constexpr std::size_t chunk_size_ = 64;
+};
+
+#endif
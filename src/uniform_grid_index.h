@@ -0,0 +1,146 @@
+#ifndef CAMP_UNIFORM_GRID_INDEX_H
+#define CAMP_UNIFORM_GRID_INDEX_H
+
+#include <QRectF>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Spatial index bucketing items by the square cells their bounds touch.
+//
+// Meant for many small items that move or change often: inserting or
+// removing one only touches the cells it covers. Items covering more than
+// max_cells cells are kept in a separate list checked by every query.
+template<typename Key> class UniformGridIndex
+{
+public:
+  explicit UniformGridIndex(double cell_size = 256.0, int max_cells = 64):
+    cell_size_(cell_size), max_cells_(max_cells)
+  {
+  }
+
+  // Inserts or moves key.
+  void insert(const Key& key, const QRectF& bounds)
+  {
+    remove(key);
+    Item item;
+    item.cells = cellRange(bounds);
+    item.large = !item.cells.isValid() || std::int64_t(item.cells.width())*item.cells.height() > max_cells_;
+    if(item.large)
+      large_.push_back(key);
+    else
+      for(int y = item.cells.top(); y <= item.cells.bottom(); y++)
+        for(int x = item.cells.left(); x <= item.cells.right(); x++)
+          cells_[cellKey(x, y)].push_back(key);
+    items_[key] = item;
+  }
+
+  void remove(const Key& key)
+  {
+    auto item = items_.find(key);
+    if(item == items_.end())
+      return;
+    if(item->second.large)
+      erase(large_, key);
+    else
+      for(int y = item->second.cells.top(); y <= item->second.cells.bottom(); y++)
+        for(int x = item->second.cells.left(); x <= item->second.cells.right(); x++)
+        {
+          auto cell = cells_.find(cellKey(x, y));
+          if(cell == cells_.end())
+            continue;
+          erase(cell->second, key);
+          if(cell->second.empty())
+            cells_.erase(cell);
+        }
+    items_.erase(item);
+  }
+
+  void clear()
+  {
+    cells_.clear();
+    items_.clear();
+    large_.clear();
+  }
+
+  std::size_t size() const
+  {
+    return items_.size();
+  }
+
+  // Calls f(key) once for each item whose cells touch rect. Items may not
+  // actually intersect rect, their bounds are only known to the cell.
+  template<typename F> void query(const QRectF& rect, F f) const
+  {
+    for(const auto& key: large_)
+      f(key);
+    QRect range = cellRange(rect);
+    if(!range.isValid())
+    {
+      for(const auto& item: items_)
+        if(!item.second.large)
+          f(item.first);
+      return;
+    }
+    for(int y = range.top(); y <= range.bottom(); y++)
+      for(int x = range.left(); x <= range.right(); x++)
+      {
+        auto cell = cells_.find(cellKey(x, y));
+        if(cell == cells_.end())
+          continue;
+        for(const auto& key: cell->second)
+        {
+          // Only report an item from the first cell it shares with rect.
+          const QRect& cells = items_.at(key).cells;
+          if(x == std::max(cells.left(), range.left()) && y == std::max(cells.top(), range.top()))
+            f(key);
+        }
+      }
+  }
+
+private:
+  struct Item
+  {
+    QRect cells;
+    bool large = false;
+  };
+
+  // Inclusive range of cells, invalid if rect can't be bucketed.
+  QRect cellRange(const QRectF& rect) const
+  {
+    QRectF r = rect.normalized();
+    double limit = double(1 << 30);
+    double x1 = std::floor(r.left()/cell_size_);
+    double y1 = std::floor(r.top()/cell_size_);
+    double x2 = std::floor(r.right()/cell_size_);
+    double y2 = std::floor(r.bottom()/cell_size_);
+    // also rejects NaN
+    if(!(std::abs(x1) < limit && std::abs(y1) < limit && std::abs(x2) < limit && std::abs(y2) < limit))
+      return QRect();
+    return QRect(QPoint(int(x1), int(y1)), QPoint(int(x2), int(y2)));
+  }
+
+  static std::uint64_t cellKey(int x, int y)
+  {
+    return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+  }
+
+  static void erase(std::vector<Key>& keys, const Key& key)
+  {
+    auto i = std::find(keys.begin(), keys.end(), key);
+    if(i == keys.end())
+      return;
+    *i = keys.back();
+    keys.pop_back();
+  }
+
+  double cell_size_;
+  int max_cells_;
+  std::unordered_map<std::uint64_t, std::vector<Key> > cells_;
+  std::unordered_map<Key, Item> items_;
+  std::vector<Key> large_;
+};
+
+#endif